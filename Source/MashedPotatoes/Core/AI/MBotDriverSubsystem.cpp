@@ -0,0 +1,327 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MBotDriverSubsystem.h"
+#include "Components/SplineComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "Core/AI/MBotSettings.h"
+#include "Core/Characters/MVehicleBase.h"
+#include "Core/Debug/MVehicleStats.h"
+#include "Core/Race/MRaceProgressComponent.h"
+#include "Core/Spatial/MVehicleSpatialSubsystem.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMPBots, Log, All);
+
+static FAutoConsoleCommandWithWorldAndArgs CmdBotsSpawn(
+    TEXT("mp.Bots.Spawn"),
+    TEXT("Spawn bot drivers on the starting grid. Argument: number of bots (default 1)."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+    {
+        if (UMBotDriverSubsystem* BotSubsystem = World ? World->GetSubsystem<UMBotDriverSubsystem>() : nullptr)
+        {
+            BotSubsystem->SpawnBots(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1);
+        }
+    }));
+
+static FAutoConsoleCommandWithWorld CmdBotsClear(
+    TEXT("mp.Bots.Clear"),
+    TEXT("Remove every bot driver and the cars they were spawned with."),
+    FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+    {
+        if (UMBotDriverSubsystem* BotSubsystem = World ? World->GetSubsystem<UMBotDriverSubsystem>() : nullptr)
+        {
+            BotSubsystem->ClearBots();
+        }
+    }));
+
+namespace MBotDriver
+{
+    // Arc length between samples when the subsystem bakes the spline itself
+    constexpr float TrackSampleSpacing = 100.0f;
+    // Throttle is eased off over this much speed (cm/s) below the target
+    constexpr float ThrottleRange = 500.0f;
+    // The brake only comes on this far (cm/s) above the target, coasting handles the rest
+    constexpr float BrakeMargin = 300.0f;
+    // Slower than this (cm/s) at full throttle counts as stuck
+    constexpr float StuckSpeed = 100.0f;
+    // Never follow slower than this (cm/s), a car stopped or reversing ahead must not stop the bot for good
+    constexpr float CrawlSpeed = 200.0f;
+    // Half a car's width plus some room, cars further to the side than this do not cap the speed
+    constexpr float PathHalfWidth = 250.0f;
+}
+
+void UMBotDriverSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+    Super::Initialize(Collection);
+    Collection.InitializeDependency<UMVehicleSpatialSubsystem>();
+}
+
+void UMBotDriverSubsystem::Deinitialize()
+{
+    Bots.Reset();
+    OwnTrack.Reset();
+    RaceProgress.Reset();
+
+    Super::Deinitialize();
+}
+
+bool UMBotDriverSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+    return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UMBotDriverSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UMBotDriverSubsystem, STATGROUP_Tickables);
+}
+
+void UMBotDriverSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+    Super::OnWorldBeginPlay(InWorld);
+
+    FParse::Value(FCommandLine::Get(), TEXT("MPBots="), NumPendingBots);
+}
+
+const FMTrackSampleTable* UMBotDriverSubsystem::GetTrack()
+{
+    if (const UMRaceProgressComponent* Race = RaceProgress.Get())
+    {
+        return &Race->GetTrack();
+    }
+    if (UMRaceProgressComponent* Race = UMRaceProgressComponent::GetRaceProgress(GetWorld()); Race && Race->GetTrack().IsValid())
+    {
+        RaceProgress = Race;
+        return &Race->GetTrack();
+    }
+
+    // No race progress, bake the track spline actor's spline ourselves
+    if (!bSearchedTrack)
+    {
+        bSearchedTrack = true;
+        for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+        {
+            const USplineComponent* Spline = It->GetClass()->GetName().Contains(TEXT("TrackSpline")) ? It->FindComponentByClass<USplineComponent>() : nullptr;
+            if (Spline)
+            {
+                OwnTrack.Build(*Spline, MBotDriver::TrackSampleSpacing);
+                break;
+            }
+        }
+    }
+    return OwnTrack.IsValid() ? &OwnTrack : nullptr;
+}
+
+TArray<AMVehicleBase*> UMBotDriverSubsystem::SpawnBots(int32 Count)
+{
+    TArray<AMVehicleBase*> Spawned;
+    if (Count <= 0 || GetWorld()->GetNetMode() == NM_Client)
+    {
+        return Spawned;
+    }
+
+    const FMTrackSampleTable* Track = GetTrack();
+    if (Track == nullptr)
+    {
+        UE_LOG(LogMPBots, Warning, TEXT("%s has no track spline to drive bots on"), *GetWorld()->GetMapName());
+        return Spawned;
+    }
+
+    const UMBotSettings* Settings = GetDefault<UMBotSettings>();
+    // Already in memory after the main menu preload (UMAssetManager)
+    UClass* VehicleClass = Settings->VehicleClass.LoadSynchronous();
+    if (VehicleClass == nullptr)
+    {
+        VehicleClass = AMVehicleBase::StaticClass();
+    }
+
+    // Rows of two behind the start line, facing along the track
+    const float StartDistance = RaceProgress.IsValid() ? RaceProgress->GetStartDistance() : 0.0f;
+    FActorSpawnParameters SpawnParams;
+    SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+    for (int32 BotIndex = 0; BotIndex < Count; BotIndex++)
+    {
+        const int32 GridSlot = NumGridSlots++;
+        const float Distance = Track->WrapDistance(StartDistance - Settings->GridSpacing * (1 + GridSlot / 2));
+        const FVector Direction = Track->GetDirectionAtDistance(Distance);
+        const FVector Right = FVector::CrossProduct(FVector::UpVector, Direction).GetSafeNormal();
+        const float Side = (GridSlot % 2 == 0 ? -0.5f : 0.5f) * Settings->LaneHalfWidth;
+        const FVector Location = Track->GetLocationAtDistance(Distance) + Right * Side + FVector(0.0f, 0.0f, Settings->SpawnHeight);
+
+        AMVehicleBase* Vehicle = GetWorld()->SpawnActor<AMVehicleBase>(VehicleClass, Location, Direction.Rotation(), SpawnParams);
+        if (Vehicle == nullptr)
+        {
+            continue;
+        }
+        // The native class has no physics settings of its own, the blueprint does
+        if (!Vehicle->BodyMeshC->IsSimulatingPhysics())
+        {
+            Vehicle->BodyMeshC->SetSimulatePhysics(true);
+        }
+        AddBot(Vehicle);
+        Bots.Last().bSpawned = true;
+        Spawned.Add(Vehicle);
+    }
+
+    UE_LOG(LogMPBots, Display, TEXT("Spawned %d bots, %d driving"), Spawned.Num(), Bots.Num());
+    return Spawned;
+}
+
+void UMBotDriverSubsystem::AddBot(AMVehicleBase* Vehicle)
+{
+    if (Vehicle == nullptr || Bots.ContainsByPredicate([Vehicle](const FBot& Bot) { return Bot.Vehicle == Vehicle; }))
+    {
+        return;
+    }
+
+    const UMBotSettings* Settings = GetDefault<UMBotSettings>();
+    // Seeded by the bot's index so runs with the same bots behave the same, e.g. for benchmarks
+    FRandomStream Random(Bots.Num() + 1);
+    FBot& Bot = Bots.AddDefaulted_GetRef();
+    Bot.Vehicle = Vehicle;
+    Bot.LaneOffset = Random.FRandRange(-0.5f, 0.5f) * Settings->LaneHalfWidth;
+    Bot.SpeedScale = 1.0f + Random.FRandRange(-1.0f, 1.0f) * Settings->SpeedVariation;
+}
+
+void UMBotDriverSubsystem::RemoveBot(AMVehicleBase* Vehicle)
+{
+    const int32 BotIndex = Bots.IndexOfByPredicate([Vehicle](const FBot& Bot) { return Bot.Vehicle == Vehicle; });
+    if (BotIndex == INDEX_NONE)
+    {
+        return;
+    }
+    Vehicle->SetDriverInput(0.0f, 0.0f, true);
+    Bots.RemoveAtSwap(BotIndex);
+}
+
+void UMBotDriverSubsystem::ClearBots()
+{
+    for (const FBot& Bot : Bots)
+    {
+        if (AMVehicleBase* Vehicle = Bot.Vehicle.Get())
+        {
+            if (Bot.bSpawned)
+            {
+                Vehicle->Destroy();
+            }
+            else
+            {
+                Vehicle->SetDriverInput(0.0f, 0.0f, true);
+            }
+        }
+    }
+    Bots.Reset();
+    NumGridSlots = 0;
+}
+
+void UMBotDriverSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    SCOPE_CYCLE_COUNTER(STAT_MPBots);
+
+    if (NumPendingBots > 0)
+    {
+        SpawnBots(NumPendingBots);
+        NumPendingBots = 0;
+    }
+
+    // Destroyed cars (respawns, kill planes) just stop being driven
+    Bots.RemoveAllSwap([](const FBot& Bot) { return !Bot.Vehicle.IsValid(); });
+
+    const FMTrackSampleTable* Track = GetTrack();
+    UMVehicleSpatialSubsystem* Spatial = GetWorld()->GetSubsystem<UMVehicleSpatialSubsystem>();
+    if (Track == nullptr || Spatial == nullptr)
+    {
+        return;
+    }
+
+    Spatial->Refresh();
+    for (FBot& Bot : Bots)
+    {
+        DriveBot(Bot, *Track, Spatial, DeltaTime);
+    }
+    INC_DWORD_STAT_BY(STAT_MPBotCount, Bots.Num());
+}
+
+void UMBotDriverSubsystem::DriveBot(FBot& Bot, const FMTrackSampleTable& Track, const UMVehicleSpatialSubsystem* Spatial, float DeltaTime) const
+{
+    AMVehicleBase* Vehicle = Bot.Vehicle.Get();
+    const UMBotSettings* Settings = GetDefault<UMBotSettings>();
+
+    const FTransform VehicleTransform = Vehicle->GetActorTransform();
+    const FVector Location = VehicleTransform.GetLocation();
+    const FVector Forward = VehicleTransform.GetUnitAxis(EAxis::X);
+    const FVector Right = VehicleTransform.GetUnitAxis(EAxis::Y);
+    const float Speed = FVector::DotProduct(Vehicle->GetVelocity(), Forward);
+
+    // --- Where to aim: a point ahead on the track, further ahead the faster we go ---
+    const float Distance = Track.Project(Location, Bot.HintSample);
+    const float TargetDistance = Distance + Settings->LookaheadDistance + FMath::Abs(Speed) * Settings->LookaheadTime;
+    const FVector TargetDirection = Track.GetDirectionAtDistance(TargetDistance);
+    const FVector TrackRight = FVector::CrossProduct(FVector::UpVector, TargetDirection).GetSafeNormal();
+
+    // Slow down by how much the track turns between here and there
+    const float TurnDegrees = FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(FVector::DotProduct(Track.GetDirectionAtDistance(Distance), TargetDirection), -1.0f, 1.0f)));
+    float TargetSpeed = FMath::Lerp(Settings->MaxSpeed, Settings->CornerSpeed, FMath::Min(TurnDegrees / Settings->CornerAngle, 1.0f)) * Bot.SpeedScale;
+
+    // --- Avoidance: cars ahead push the aim point away from them, one right in our path caps the speed ---
+    float LateralOffset = Bot.LaneOffset;
+    bool bBlocked = false;
+    Spatial->ForEachVehicleInRadius(Location, Settings->AvoidanceRadius,
+        [&](const AMVehicleBase* Other, const FMVehicleSpatialGrid::FEntry& Entry, float DistanceSquared)
+        {
+            const FVector ToOther = Entry.Location - Location;
+            const float Ahead = FVector::DotProduct(ToOther, Forward);
+            if (Other == Vehicle || Ahead <= 0.0f)
+            {
+                return;
+            }
+
+            const float Side = FVector::DotProduct(ToOther, Right);
+            const float Closeness = 1.0f - FMath::Sqrt(DistanceSquared) / Settings->AvoidanceRadius;
+            LateralOffset -= (Side >= 0.0f ? 1.0f : -1.0f) * Settings->AvoidanceOffset * Closeness;
+            if (Ahead < Settings->FollowDistance && FMath::Abs(Side) < MBotDriver::PathHalfWidth)
+            {
+                const float FollowSpeed = FVector::DotProduct(Entry.Velocity, Forward);
+                bBlocked |= FollowSpeed < MBotDriver::CrawlSpeed;
+                TargetSpeed = FMath::Min(TargetSpeed, FMath::Max(FollowSpeed, MBotDriver::CrawlSpeed));
+            }
+        });
+    LateralOffset = FMath::Clamp(LateralOffset, -Settings->LaneHalfWidth, Settings->LaneHalfWidth);
+    const FVector Target = Track.GetLocationAtDistance(TargetDistance) + TrackRight * LateralOffset;
+
+    // --- Controls ---
+    const FVector LocalTarget = VehicleTransform.InverseTransformVectorNoScale(Target - Location);
+    const float TargetAngle = FMath::RadiansToDegrees(FMath::Atan2(LocalTarget.Y, LocalTarget.X));
+    float Steer = FMath::Clamp(TargetAngle / FMath::Max(Vehicle->MaxSteeringAngle, 1.0f), -1.0f, 1.0f);
+    float Throttle = FMath::Clamp((TargetSpeed - Speed) / MBotDriver::ThrottleRange, 0.0f, 1.0f);
+    bool bBrake = Speed > TargetSpeed + MBotDriver::BrakeMargin;
+
+    // --- Recovery: back up with the wheels turned the other way after pushing against something ---
+    if (Bot.ReverseSeconds > 0.0f)
+    {
+        Bot.ReverseSeconds -= DeltaTime;
+        Throttle = -1.0f;
+        Steer = -Steer;
+        bBrake = false;
+    }
+    // Held up behind a car that is not moving counts too, backing out lets the bot steer round it
+    else if ((Throttle > 0.5f || bBlocked) && FMath::Abs(Speed) < MBotDriver::StuckSpeed)
+    {
+        Bot.StuckSeconds += DeltaTime;
+        if (Bot.StuckSeconds > Settings->StuckTime)
+        {
+            Bot.StuckSeconds = 0.0f;
+            Bot.ReverseSeconds = Settings->ReverseTime;
+        }
+    }
+    else
+    {
+        Bot.StuckSeconds = 0.0f;
+    }
+
+    Vehicle->SetDriverInput(Throttle, Steer, bBrake);
+}
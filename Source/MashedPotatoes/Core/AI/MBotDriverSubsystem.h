@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Core/Race/MTrackSampleTable.h"
+#include "MBotDriverSubsystem.generated.h"
+
+class AMVehicleBase;
+class UMRaceProgressComponent;
+class UMVehicleSpatialSubsystem;
+
+// Native AI drivers. A bot is an ordinary AMVehicleBase without a controller, so it has no input bindings and its
+// camera never ticks, and every bot is driven from this subsystem's single tick: follow the track spline at a lookahead
+// that grows with speed, slow down for the corners ahead, steer around cars ahead found through
+// UMVehicleSpatialSubsystem and back up when stuck. The result goes through SetDriverInput into the same force model
+// the players use. Tuning is in Project Settings > Game > Bots.
+//
+// The track comes from the level's UMRaceProgressComponent, or else from the first bp_TrackSpline. Bots are only
+// spawned where the game is authoritative; clients see them as any other replicated car.
+//   mp.Bots.Spawn <count>  /  mp.Bots.Clear  /  -MPBots=<count> to fill the grid on begin play
+UCLASS()
+class MASHEDPOTATOES_API UMBotDriverSubsystem : public UTickableWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    // USubsystem
+    virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+    virtual void Deinitialize() override;
+    // UWorldSubsystem
+    virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+    // FTickableGameObject
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+    virtual bool IsTickable() const override { return Bots.Num() > 0 || NumPendingBots > 0; }
+
+    // Spawns Count bots on the starting grid behind the ones already there. Empty on clients and without a track.
+    UFUNCTION(BlueprintCallable, Category = "Bots")
+    TArray<AMVehicleBase*> SpawnBots(int32 Count);
+    // Hands a car that is already in the world to a bot driver
+    UFUNCTION(BlueprintCallable, Category = "Bots")
+    void AddBot(AMVehicleBase* Vehicle);
+    UFUNCTION(BlueprintCallable, Category = "Bots")
+    void RemoveBot(AMVehicleBase* Vehicle);
+    // Destroys the cars SpawnBots created and stops driving the ones given to AddBot
+    UFUNCTION(BlueprintCallable, Category = "Bots")
+    void ClearBots();
+    UFUNCTION(BlueprintPure, Category = "Bots")
+    int32 GetNumBots() const { return Bots.Num(); }
+
+    // The track bots follow, null if the level has none
+    const FMTrackSampleTable* GetTrack();
+
+protected:
+    virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+    struct FBot
+    {
+        TWeakObjectPtr<AMVehicleBase> Vehicle;
+        int32 HintSample = INDEX_NONE;
+        // Preferred distance from the spline, to the right, so bots do not all queue on the same line
+        float LaneOffset = 0.0f;
+        float SpeedScale = 1.0f;
+        float StuckSeconds = 0.0f;
+        float ReverseSeconds = 0.0f;
+        // Created by SpawnBots, destroyed by ClearBots
+        bool bSpawned = false;
+    };
+
+    void DriveBot(FBot& Bot, const FMTrackSampleTable& Track, const UMVehicleSpatialSubsystem* Spatial, float DeltaTime) const;
+
+    TArray<FBot> Bots;
+    // From -MPBots, spawned on the first tick once the race progress component has baked the track
+    int32 NumPendingBots = 0;
+    // Grid slots handed out so far, later spawns line up further back
+    int32 NumGridSlots = 0;
+
+    TWeakObjectPtr<UMRaceProgressComponent> RaceProgress;
+    // Baked here when the level has a track spline but no race progress component
+    FMTrackSampleTable OwnTrack;
+    bool bSearchedTrack = false;
+};
@@ -0,0 +1,10 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MBotSettings.h"
+#include "Core/Characters/MVehicleBase.h"
+
+UMBotSettings::UMBotSettings()
+{
+    VehicleClass = TSoftClassPtr<AMVehicleBase>(FSoftObjectPath(TEXT("/Game/Blueprints/Vehicle/BP_VehicleBase.BP_VehicleBase_C")));
+}
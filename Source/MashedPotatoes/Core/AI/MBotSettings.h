@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "MBotSettings.generated.h"
+
+class AMVehicleBase;
+
+// Project Settings > Game > Bots
+UCLASS(Config = Game, DefaultConfig, meta = (DisplayName = "Bots"))
+class MASHEDPOTATOES_API UMBotSettings : public UDeveloperSettings
+{
+    GENERATED_BODY()
+
+public:
+    UMBotSettings();
+
+    virtual FName GetCategoryName() const override { return TEXT("Game"); }
+
+    UPROPERTY(Config, EditAnywhere, Category = "Spawning")
+    TSoftClassPtr<AMVehicleBase> VehicleClass;
+    UPROPERTY(Config, EditAnywhere, Category = "Spawning")
+    // Distance along the track between two rows of the starting grid, two cars per row
+    float GridSpacing = 800.0f;
+    UPROPERTY(Config, EditAnywhere, Category = "Spawning")
+    float SpawnHeight = 150.0f;
+
+    UPROPERTY(Config, EditAnywhere, Category = "Driving")
+    // Bots aim for the point this far ahead along the track...
+    float LookaheadDistance = 800.0f;
+    UPROPERTY(Config, EditAnywhere, Category = "Driving")
+    // ...plus however far they travel in this many seconds
+    float LookaheadTime = 0.6f;
+    UPROPERTY(Config, EditAnywhere, Category = "Driving")
+    // cm/s on a straight
+    float MaxSpeed = 3500.0f;
+    UPROPERTY(Config, EditAnywhere, Category = "Driving")
+    // cm/s when the track turns by CornerAngle or more within the lookahead
+    float CornerSpeed = 1500.0f;
+    UPROPERTY(Config, EditAnywhere, Category = "Driving", meta = (ClampMin = "1.0", ClampMax = "180.0"))
+    float CornerAngle = 60.0f;
+    UPROPERTY(Config, EditAnywhere, Category = "Driving", meta = (ClampMin = "0.0", ClampMax = "0.5"))
+    // Each bot's speeds are scaled by up to this much either way, so they do not drive in lockstep
+    float SpeedVariation = 0.1f;
+    UPROPERTY(Config, EditAnywhere, Category = "Driving")
+    // Bots keep within this distance either side of the spline
+    float LaneHalfWidth = 500.0f;
+
+    UPROPERTY(Config, EditAnywhere, Category = "Avoidance")
+    // Cars ahead within this distance push the bot sideways
+    float AvoidanceRadius = 1500.0f;
+    UPROPERTY(Config, EditAnywhere, Category = "Avoidance")
+    // Sideways push from a car right in front, falling off with distance
+    float AvoidanceOffset = 400.0f;
+    UPROPERTY(Config, EditAnywhere, Category = "Avoidance")
+    // A car closer than this ahead and within a car's width of the bot's path caps its speed
+    float FollowDistance = 700.0f;
+
+    UPROPERTY(Config, EditAnywhere, Category = "Recovery")
+    // Seconds at full throttle without moving before a bot backs up
+    float StuckTime = 2.0f;
+    UPROPERTY(Config, EditAnywhere, Category = "Recovery")
+    float ReverseTime = 1.5f;
+};
@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MAssetManager.h"
+#include "Core/Assets/MVehicleAssetSettings.h"
+#include "Core/Items/MItemSettings.h"
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StreamableManager.h"
+#include "Engine/World.h"
+#include "UObject/UObjectGlobals.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMPAssets, Log, All);
+
+const FPrimaryAssetType UMAssetManager::PlayerAssetType(TEXT("MPPlayer"));
+const FPrimaryAssetType UMAssetManager::ItemAssetType(TEXT("MPItem"));
+
+UMAssetManager& UMAssetManager::Get()
+{
+    UMAssetManager* AssetManager = Cast<UMAssetManager>(GEngine->AssetManager);
+    checkf(AssetManager != nullptr, TEXT("AssetManagerClassName in DefaultEngine.ini must be /Script/MashedPotatoes.MAssetManager"));
+    return *AssetManager;
+}
+
+void UMAssetManager::StartInitialLoading()
+{
+    Super::StartInitialLoading();
+
+    FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &UMAssetManager::OnPostLoadMap);
+}
+
+void UMAssetManager::OnPostLoadMap(UWorld* World)
+{
+    // The main menu is the first game map, PIE straight into a track starts it there instead
+    if (World != nullptr && (World->WorldType == EWorldType::Game || World->WorldType == EWorldType::PIE))
+    {
+        RequestVehiclePreload();
+    }
+}
+
+void UMAssetManager::RequestVehiclePreload()
+{
+    if (VehiclePreloadHandle.IsValid())
+    {
+        return;
+    }
+
+    const UMVehicleAssetSettings* Settings = GetDefault<UMVehicleAssetSettings>();
+    TArray<FSoftObjectPath> Paths;
+    Paths.Add(Settings->BodyMesh.ToSoftObjectPath());
+    if (!IsRunningDedicatedServer())
+    {
+        for (const TSoftObjectPtr<UMaterialInterface>& Material : Settings->CarMaterials)
+        {
+            Paths.Add(Material.ToSoftObjectPath());
+        }
+    }
+    for (const TSoftClassPtr<AActor>& ActorClass : Settings->ActorClasses)
+    {
+        Paths.Add(ActorClass.ToSoftObjectPath());
+    }
+    for (const FPrimaryAssetType& Type : Settings->PrimaryAssetTypes)
+    {
+        GetPrimaryAssetPathList(Type, Paths);
+    }
+    const UMItemSettings* ItemSettings = GetDefault<UMItemSettings>();
+    for (const FMItemTypeSettings* ItemType : { &ItemSettings->Missile, &ItemSettings->HomingMissile, &ItemSettings->Mine, &ItemSettings->Oil })
+    {
+        Paths.Add(ItemType->Mesh.ToSoftObjectPath());
+    }
+    Paths.RemoveAll([](const FSoftObjectPath& Path) { return Path.IsNull(); });
+
+    UE_LOG(LogMPAssets, Log, TEXT("Preloading %d vehicle assets"), Paths.Num());
+    const double StartTime = FPlatformTime::Seconds();
+    VehiclePreloadHandle = GetStreamableManager().RequestAsyncLoad(MoveTemp(Paths), FStreamableDelegate::CreateLambda([StartTime]()
+    {
+        UE_LOG(LogMPAssets, Log, TEXT("Vehicle assets preloaded in %.2f s"), FPlatformTime::Seconds() - StartTime);
+    }), FStreamableManager::AsyncLoadHighPriority);
+}
+
+bool UMAssetManager::IsVehiclePreloadComplete()
+{
+    const TSharedPtr<FStreamableHandle>& Handle = Get().VehiclePreloadHandle;
+    return Handle.IsValid() && Handle->HasLoadCompleted();
+}
+
+float UMAssetManager::GetVehiclePreloadProgress()
+{
+    const TSharedPtr<FStreamableHandle>& Handle = Get().VehiclePreloadHandle;
+    return Handle.IsValid() ? Handle->GetProgress() : 0.0f;
+}
+
+TArray<UObject*> UMAssetManager::GetPlayerAssets()
+{
+    TArray<UObject*> PlayerAssets;
+    Get().GetPrimaryAssetObjectList(PlayerAssetType, PlayerAssets);
+    return PlayerAssets;
+}
+
+UStaticMesh* UMAssetManager::GetVehicleBodyMesh()
+{
+    const TSoftObjectPtr<UStaticMesh>& BodyMesh = GetDefault<UMVehicleAssetSettings>()->BodyMesh;
+    if (UStaticMesh* Mesh = BodyMesh.Get())
+    {
+        return Mesh;
+    }
+    if (!GIsEditor && !BodyMesh.IsNull())
+    {
+        UE_LOG(LogMPAssets, Warning, TEXT("%s was not preloaded, loading it synchronously"), *BodyMesh.ToString());
+    }
+    return BodyMesh.LoadSynchronous();
+}
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/AssetManager.h"
+#include "MAssetManager.generated.h"
+
+class UStaticMesh;
+struct FStreamableHandle;
+
+// Set as the engine's asset manager in DefaultEngine.ini. On the first game map (the main menu) it starts one high
+// priority async load of every car mesh, car material, player data asset (da_Players_*), item data asset and item mesh
+// (UMVehicleAssetSettings) and holds the handle for the rest of the session, so spawning a car on join or respawn
+// finds everything already in memory instead of loading it on the game thread.
+UCLASS()
+class MASHEDPOTATOES_API UMAssetManager : public UAssetManager
+{
+    GENERATED_BODY()
+
+public:
+    // Types given to the data assets in /Game/Players and /Game/Blueprints/Items by DefaultGame.ini
+    static const FPrimaryAssetType PlayerAssetType;
+    static const FPrimaryAssetType ItemAssetType;
+
+    static UMAssetManager& Get();
+
+    // UAssetManager
+    virtual void StartInitialLoading() override;
+
+    // Starts the preload if it has not been started yet
+    void RequestVehiclePreload();
+    // Keeps the preloaded assets resident while held, valid once RequestVehiclePreload has run
+    TSharedPtr<FStreamableHandle> GetVehiclePreloadHandle() const { return VehiclePreloadHandle; }
+
+    UFUNCTION(BlueprintPure, Category = "Assets")
+    static bool IsVehiclePreloadComplete();
+    UFUNCTION(BlueprintPure, Category = "Assets")
+    // 0 to 1, for a loading bar on the main menu
+    static float GetVehiclePreloadProgress();
+    UFUNCTION(BlueprintPure, Category = "Assets")
+    // The player data assets that are in memory, all of them once the preload is complete
+    static TArray<UObject*> GetPlayerAssets();
+
+    // Body mesh for cars whose Blueprint does not set one. Loads it on the spot if the preload has not reached it yet.
+    static UStaticMesh* GetVehicleBodyMesh();
+
+private:
+    void OnPostLoadMap(UWorld* World);
+
+    TSharedPtr<FStreamableHandle> VehiclePreloadHandle;
+};
@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MVehicleAssetSettings.h"
+#include "Core/Assets/MAssetManager.h"
+#include "Engine/StaticMesh.h"
+#include "Materials/MaterialInterface.h"
+
+UMVehicleAssetSettings::UMVehicleAssetSettings()
+{
+    BodyMesh = TSoftObjectPtr<UStaticMesh>(FSoftObjectPath(TEXT("/Game/Assets/Car/SM_Car_Body.SM_Car_Body")));
+
+    for (const TCHAR* MaterialPath : {
+        TEXT("/Game/Assets/Car/M_Car.M_Car"),
+        TEXT("/Game/Assets/Car/M_Car_red.M_Car_red"),
+        TEXT("/Game/Assets/Car/M_Car_blue.M_Car_blue"),
+        TEXT("/Game/Assets/Car/M_Car_green.M_Car_green"),
+        TEXT("/Game/Assets/Car/M_Car_yellow.M_Car_yellow") })
+    {
+        CarMaterials.Add(TSoftObjectPtr<UMaterialInterface>(FSoftObjectPath(MaterialPath)));
+    }
+
+    ActorClasses.Add(TSoftClassPtr<AActor>(FSoftObjectPath(TEXT("/Game/Blueprints/Vehicle/BP_VehicleBase.BP_VehicleBase_C"))));
+    ActorClasses.Add(TSoftClassPtr<AActor>(FSoftObjectPath(TEXT("/Game/Blueprints/Vehicle/bp_VehicleDestroyed.bp_VehicleDestroyed_C"))));
+
+    PrimaryAssetTypes = { UMAssetManager::PlayerAssetType, UMAssetManager::ItemAssetType };
+}
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "UObject/PrimaryAssetId.h"
+#include "MVehicleAssetSettings.generated.h"
+
+class UStaticMesh;
+class UMaterialInterface;
+
+// Project Settings > Game > Vehicle Assets. Everything listed here, plus the item meshes from the Items settings, is
+// loaded in the background by UMAssetManager while the main menu is up and kept resident for the rest of the session.
+UCLASS(Config = Game, DefaultConfig, meta = (DisplayName = "Vehicle Assets"))
+class MASHEDPOTATOES_API UMVehicleAssetSettings : public UDeveloperSettings
+{
+    GENERATED_BODY()
+
+public:
+    UMVehicleAssetSettings();
+
+    virtual FName GetCategoryName() const override { return TEXT("Game"); }
+
+    UPROPERTY(Config, EditAnywhere, Category = "Vehicle")
+    // Used by AMVehicleBase when its Blueprint does not set a body mesh
+    TSoftObjectPtr<UStaticMesh> BodyMesh;
+
+    UPROPERTY(Config, EditAnywhere, Category = "Preload")
+    // Player colours, not needed on dedicated servers
+    TArray<TSoftObjectPtr<UMaterialInterface>> CarMaterials;
+    UPROPERTY(Config, EditAnywhere, Category = "Preload", meta = (AllowAbstract = "true"))
+    // Actors spawned mid-race: the car itself and the wreck left behind when it is destroyed
+    TArray<TSoftClassPtr<AActor>> ActorClasses;
+    UPROPERTY(Config, EditAnywhere, Category = "Preload")
+    // Primary asset types scanned by the asset manager (Project Settings > Game > Asset Manager)
+    TArray<FPrimaryAssetType> PrimaryAssetTypes;
+};
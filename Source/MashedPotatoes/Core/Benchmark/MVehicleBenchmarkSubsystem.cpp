@@ -0,0 +1,398 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MVehicleBenchmarkSubsystem.h"
+#include "Engine/World.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/StaticMesh.h"
+#include "Components/StaticMeshComponent.h"
+#include "GameFramework/PlayerStart.h"
+#include "EngineUtils.h"
+#include "RenderCore.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "Core/AI/MBotDriverSubsystem.h"
+#include "Core/Characters/MVehicleBase.h"
+#include "Core/Physics/MVehicleSimulationSubsystem.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMPVehicleBenchmark, Log, All);
+
+namespace MVehicleBenchmark
+{
+    const TCHAR* DefaultVehicleClass = TEXT("/Game/Blueprints/Vehicle/BP_VehicleBase.BP_VehicleBase_C");
+    // Distance between cars on the spawn grid
+    constexpr float GridSpacing = 800.0f;
+    // Cars are dropped from this height above the spawn origin
+    constexpr float SpawnHeight = 150.0f;
+    // Where the flat plane goes, far below anything in the map
+    const FVector FlatPlaneOrigin(0.0f, 0.0f, -50000.0f);
+
+    // Average, median, 95th percentile and max of one column of samples
+    TSharedRef<FJsonObject> Summarise(TArray<float> Values)
+    {
+        TSharedRef<FJsonObject> Summary = MakeShared<FJsonObject>();
+        if (Values.Num() == 0)
+        {
+            return Summary;
+        }
+
+        Values.Sort();
+        double Sum = 0.0;
+        for (const float Value : Values)
+        {
+            Sum += Value;
+        }
+        Summary->SetNumberField(TEXT("Avg"), Sum / Values.Num());
+        Summary->SetNumberField(TEXT("P50"), Values[Values.Num() / 2]);
+        Summary->SetNumberField(TEXT("P95"), Values[FMath::Min(Values.Num() - 1, FMath::FloorToInt32(Values.Num() * 0.95f))]);
+        Summary->SetNumberField(TEXT("Max"), Values.Last());
+        return Summary;
+    }
+}
+
+bool UMVehicleBenchmarkSubsystem::IsRequested()
+{
+    return FParse::Param(FCommandLine::Get(), TEXT("MPVehicleBenchmark"));
+}
+
+void UMVehicleBenchmarkSubsystem::Deinitialize()
+{
+    bRunning = false;
+    Vehicles.Reset();
+    FlatPlane = nullptr;
+
+    Super::Deinitialize();
+}
+
+bool UMVehicleBenchmarkSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+    return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UMVehicleBenchmarkSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UMVehicleBenchmarkSubsystem, STATGROUP_Tickables);
+}
+
+void UMVehicleBenchmarkSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+    Super::OnWorldBeginPlay(InWorld);
+
+    if (!IsRequested())
+    {
+        return;
+    }
+
+    // --- Options ---
+    const TCHAR* CommandLine = FCommandLine::Get();
+    FString CountsOption = TEXT("1,8,32,128");
+    FParse::Value(CommandLine, TEXT("MPBenchmarkCounts="), CountsOption);
+    TArray<FString> CountStrings;
+    CountsOption.ParseIntoArray(CountStrings, TEXT(","));
+    for (const FString& CountString : CountStrings)
+    {
+        const int32 Count = FCString::Atoi(*CountString);
+        if (Count > 0)
+        {
+            VehicleCounts.Add(Count);
+        }
+    }
+    FParse::Value(CommandLine, TEXT("MPBenchmarkFrames="), NumFrames);
+    FParse::Value(CommandLine, TEXT("MPBenchmarkWarmup="), NumWarmupFrames);
+    NumFrames = FMath::Max(NumFrames, 1);
+    NumWarmupFrames = FMath::Max(NumWarmupFrames, 0);
+    bFlatPlane = FParse::Param(CommandLine, TEXT("MPBenchmarkFlat"));
+    // There is no track to follow on the flat plane
+    bBotDrivers = !bFlatPlane && FParse::Param(CommandLine, TEXT("MPBenchmarkBots"));
+
+    FString ClassPath = MVehicleBenchmark::DefaultVehicleClass;
+    FParse::Value(CommandLine, TEXT("MPBenchmarkClass="), ClassPath);
+    VehicleClass = LoadClass<AMVehicleBase>(nullptr, *ClassPath);
+    if (VehicleClass == nullptr)
+    {
+        UE_LOG(LogMPVehicleBenchmark, Warning, TEXT("Could not load %s, spawning AMVehicleBase"), *ClassPath);
+        VehicleClass = AMVehicleBase::StaticClass();
+    }
+
+    // --- Spawn origin ---
+    if (bFlatPlane)
+    {
+        Origin = MVehicleBenchmark::FlatPlaneOrigin;
+        SpawnFlatPlane();
+    }
+    else if (TActorIterator<APlayerStart> PlayerStart(&InWorld); PlayerStart)
+    {
+        Origin = PlayerStart->GetActorLocation();
+    }
+
+    if (VehicleCounts.Num() == 0)
+    {
+        UE_LOG(LogMPVehicleBenchmark, Error, TEXT("No vehicle counts to run"));
+        return;
+    }
+
+    UE_LOG(LogMPVehicleBenchmark, Display, TEXT("Running %s with %d measured frames per count on %s"),
+        *CountsOption, NumFrames, bFlatPlane ? TEXT("a flat plane") : *InWorld.GetMapName());
+    bRunning = true;
+    RunIndex = 0;
+    StartRun();
+}
+
+void UMVehicleBenchmarkSubsystem::SpawnFlatPlane()
+{
+    UStaticMesh* CubeMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+    if (CubeMesh == nullptr)
+    {
+        UE_LOG(LogMPVehicleBenchmark, Error, TEXT("Could not load the plane mesh, the cars will fall"));
+        return;
+    }
+
+    // The cube is 100 units across, scale it to 2 km with its top face at the origin
+    FActorSpawnParameters SpawnParams;
+    SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+    const FTransform PlaneTransform(FRotator::ZeroRotator, Origin - FVector(0.0f, 0.0f, 50.0f), FVector(2000.0f, 2000.0f, 1.0f));
+    AStaticMeshActor* PlaneActor = GetWorld()->SpawnActor<AStaticMeshActor>(AStaticMeshActor::StaticClass(), PlaneTransform, SpawnParams);
+    if (PlaneActor)
+    {
+        PlaneActor->GetStaticMeshComponent()->SetStaticMesh(CubeMesh);
+        FlatPlane = PlaneActor;
+    }
+}
+
+void UMVehicleBenchmarkSubsystem::StartRun()
+{
+    FRunResult& Result = Results.AddDefaulted_GetRef();
+    Result.NumVehicles = VehicleCounts[RunIndex];
+    Result.Samples.Reserve(NumFrames);
+
+    if (bBotDrivers)
+    {
+        if (UMBotDriverSubsystem* BotSubsystem = GetWorld()->GetSubsystem<UMBotDriverSubsystem>())
+        {
+            Vehicles.Append(BotSubsystem->SpawnBots(Result.NumVehicles));
+        }
+        if (Vehicles.Num() == 0)
+        {
+            UE_LOG(LogMPVehicleBenchmark, Warning, TEXT("No bots could be spawned, falling back to scripted input"));
+            bBotDrivers = false;
+        }
+    }
+
+    // Square grid around the origin, all facing +X
+    const int32 NumColumns = FMath::CeilToInt32(FMath::Sqrt(static_cast<float>(Result.NumVehicles)));
+    const float HalfExtent = (NumColumns - 1) * MVehicleBenchmark::GridSpacing * 0.5f;
+    FActorSpawnParameters SpawnParams;
+    SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+    const int32 NumGridVehicles = bBotDrivers ? 0 : Result.NumVehicles;
+    for (int32 VehicleIndex = 0; VehicleIndex < NumGridVehicles; VehicleIndex++)
+    {
+        const FVector Location = Origin + FVector(
+            (VehicleIndex / NumColumns) * MVehicleBenchmark::GridSpacing - HalfExtent,
+            (VehicleIndex % NumColumns) * MVehicleBenchmark::GridSpacing - HalfExtent,
+            MVehicleBenchmark::SpawnHeight);
+        AMVehicleBase* Vehicle = GetWorld()->SpawnActor<AMVehicleBase>(VehicleClass, Location, FRotator::ZeroRotator, SpawnParams);
+        if (Vehicle == nullptr)
+        {
+            continue;
+        }
+        // The native class has no physics settings of its own, the blueprint does
+        if (!Vehicle->BodyMeshC->IsSimulatingPhysics())
+        {
+            Vehicle->BodyMeshC->SetSimulatePhysics(true);
+        }
+        Vehicles.Add(Vehicle);
+    }
+
+    RunFrame = 0;
+    LastFrameSeconds = FPlatformTime::Seconds();
+    Result.UsedPhysicalStart = FPlatformMemory::GetStats().UsedPhysical;
+    Result.UsedPhysicalPeak = Result.UsedPhysicalStart;
+}
+
+void UMVehicleBenchmarkSubsystem::FinishRun()
+{
+    FRunResult& Result = Results.Last();
+    Result.UsedPhysicalEnd = FPlatformMemory::GetStats().UsedPhysical;
+
+    for (AMVehicleBase* Vehicle : Vehicles)
+    {
+        Result.FinalPositions.Add(Vehicle ? Vehicle->GetActorLocation() : FVector::ZeroVector);
+        if (Vehicle)
+        {
+            Vehicle->Destroy();
+        }
+    }
+    Vehicles.Reset();
+    if (bBotDrivers)
+    {
+        // Forget the destroyed bots so the next run starts from the front of the grid again
+        GetWorld()->GetSubsystem<UMBotDriverSubsystem>()->ClearBots();
+    }
+    Result.PositionChecksum = FCrc::MemCrc32(Result.FinalPositions.GetData(), Result.FinalPositions.Num() * sizeof(FVector));
+
+    UE_LOG(LogMPVehicleBenchmark, Display, TEXT("%d vehicles done, checksum %08x"), Result.NumVehicles, Result.PositionChecksum);
+}
+
+void UMVehicleBenchmarkSubsystem::DriveVehicles()
+{
+    if (bBotDrivers)
+    {
+        return;
+    }
+
+    const float Progress = static_cast<float>(RunFrame - NumWarmupFrames) / NumFrames;
+    for (int32 VehicleIndex = 0; VehicleIndex < Vehicles.Num(); VehicleIndex++)
+    {
+        if (AMVehicleBase* Vehicle = Vehicles[VehicleIndex])
+        {
+            // Sit still while settling, then accelerate and weave, coast, and finally brake to a stop
+            if (Progress < 0.0f)
+            {
+                Vehicle->SetDriverInput(0.0f, 0.0f, true);
+                continue;
+            }
+            const float Throttle = Progress < 0.7f ? 1.0f : 0.0f;
+            const float Steer = 0.6f * FMath::Sin(UE_TWO_PI * (RunFrame / 240.0f + VehicleIndex * 0.125f));
+            Vehicle->SetDriverInput(Throttle, Steer, Progress >= 0.8f);
+        }
+    }
+}
+
+void UMVehicleBenchmarkSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    const double NowSeconds = FPlatformTime::Seconds();
+    const float FrameMs = static_cast<float>((NowSeconds - LastFrameSeconds) * 1000.0);
+    LastFrameSeconds = NowSeconds;
+
+    RunFrame++;
+    DriveVehicles();
+
+    FRunResult& Result = Results.Last();
+    if (RunFrame > NumWarmupFrames)
+    {
+        FFrameSample& Sample = Result.Samples.AddDefaulted_GetRef();
+        Sample.FrameMs = FrameMs;
+        // Game thread time of the previous frame, as shown by "stat unit"
+        Sample.GameThreadMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+        if (const UMVehicleSimulationSubsystem* SimulationSubsystem = GetWorld()->GetSubsystem<UMVehicleSimulationSubsystem>())
+        {
+            Sample.VehicleStepMs = static_cast<float>(SimulationSubsystem->GetLastFrameStepSeconds() * 1000.0);
+            Sample.PhysicsSolveMs = static_cast<float>(SimulationSubsystem->GetLastFrameSolverSeconds() * 1000.0);
+        }
+        Result.UsedPhysicalPeak = FMath::Max<uint64>(Result.UsedPhysicalPeak, FPlatformMemory::GetStats().UsedPhysical);
+    }
+
+    if (RunFrame < NumWarmupFrames + NumFrames)
+    {
+        return;
+    }
+
+    FinishRun();
+    RunIndex++;
+    if (RunIndex < VehicleCounts.Num())
+    {
+        StartRun();
+        return;
+    }
+
+    bRunning = false;
+    WriteReport();
+    if (FApp::IsUnattended())
+    {
+        FPlatformMisc::RequestExit(false, TEXT("UMVehicleBenchmarkSubsystem"));
+    }
+}
+
+void UMVehicleBenchmarkSubsystem::WriteReport() const
+{
+    TSharedRef<FJsonObject> Report = MakeShared<FJsonObject>();
+    Report->SetStringField(TEXT("Map"), GetWorld()->GetMapName());
+    Report->SetBoolField(TEXT("FlatPlane"), bFlatPlane);
+    Report->SetBoolField(TEXT("BotDrivers"), bBotDrivers);
+    Report->SetStringField(TEXT("VehicleClass"), GetPathNameSafe(VehicleClass));
+    Report->SetNumberField(TEXT("WarmupFrames"), NumWarmupFrames);
+    Report->SetNumberField(TEXT("Frames"), NumFrames);
+    Report->SetBoolField(TEXT("FixedFrameTime"), FApp::UseFixedTimeStep());
+    Report->SetNumberField(TEXT("FixedDeltaTime"), FApp::GetFixedDeltaTime());
+    Report->SetStringField(TEXT("BuildVersion"), FApp::GetBuildVersion());
+
+    TArray<TSharedPtr<FJsonValue>> Runs;
+    for (const FRunResult& Result : Results)
+    {
+        TSharedRef<FJsonObject> Run = MakeShared<FJsonObject>();
+        Run->SetNumberField(TEXT("Vehicles"), Result.NumVehicles);
+
+        // Per frame columns, plus a summary of each
+        TArray<float> FrameMs, GameThreadMs, VehicleStepMs, PhysicsSolveMs, PhysicsMs;
+        TArray<TSharedPtr<FJsonValue>> FrameMsValues, GameThreadMsValues, VehicleStepMsValues, PhysicsSolveMsValues, PhysicsMsValues;
+        for (const FFrameSample& Sample : Result.Samples)
+        {
+            FrameMs.Add(Sample.FrameMs);
+            GameThreadMs.Add(Sample.GameThreadMs);
+            VehicleStepMs.Add(Sample.VehicleStepMs);
+            PhysicsSolveMs.Add(Sample.PhysicsSolveMs);
+            PhysicsMs.Add(Sample.VehicleStepMs + Sample.PhysicsSolveMs);
+            FrameMsValues.Add(MakeShared<FJsonValueNumber>(Sample.FrameMs));
+            GameThreadMsValues.Add(MakeShared<FJsonValueNumber>(Sample.GameThreadMs));
+            VehicleStepMsValues.Add(MakeShared<FJsonValueNumber>(Sample.VehicleStepMs));
+            PhysicsSolveMsValues.Add(MakeShared<FJsonValueNumber>(Sample.PhysicsSolveMs));
+            PhysicsMsValues.Add(MakeShared<FJsonValueNumber>(Sample.VehicleStepMs + Sample.PhysicsSolveMs));
+        }
+        Run->SetObjectField(TEXT("FrameMs"), MVehicleBenchmark::Summarise(FrameMs));
+        Run->SetObjectField(TEXT("GameThreadMs"), MVehicleBenchmark::Summarise(GameThreadMs));
+        Run->SetObjectField(TEXT("VehicleStepMs"), MVehicleBenchmark::Summarise(VehicleStepMs));
+        Run->SetObjectField(TEXT("PhysicsSolveMs"), MVehicleBenchmark::Summarise(PhysicsSolveMs));
+        // Vehicle step plus solver, the physics thread time of the frame's steps
+        Run->SetObjectField(TEXT("PhysicsMs"), MVehicleBenchmark::Summarise(PhysicsMs));
+        Run->SetArrayField(TEXT("FrameMsPerFrame"), FrameMsValues);
+        Run->SetArrayField(TEXT("GameThreadMsPerFrame"), GameThreadMsValues);
+        Run->SetArrayField(TEXT("VehicleStepMsPerFrame"), VehicleStepMsValues);
+        Run->SetArrayField(TEXT("PhysicsSolveMsPerFrame"), PhysicsSolveMsValues);
+        Run->SetArrayField(TEXT("PhysicsMsPerFrame"), PhysicsMsValues);
+
+        TSharedRef<FJsonObject> Memory = MakeShared<FJsonObject>();
+        Memory->SetNumberField(TEXT("UsedPhysicalStartMB"), Result.UsedPhysicalStart / (1024.0 * 1024.0));
+        Memory->SetNumberField(TEXT("UsedPhysicalEndMB"), Result.UsedPhysicalEnd / (1024.0 * 1024.0));
+        Memory->SetNumberField(TEXT("UsedPhysicalPeakMB"), Result.UsedPhysicalPeak / (1024.0 * 1024.0));
+        Run->SetObjectField(TEXT("Memory"), Memory);
+
+        TArray<TSharedPtr<FJsonValue>> Positions;
+        for (const FVector& Position : Result.FinalPositions)
+        {
+            TArray<TSharedPtr<FJsonValue>> Components = {
+                MakeShared<FJsonValueNumber>(Position.X), MakeShared<FJsonValueNumber>(Position.Y), MakeShared<FJsonValueNumber>(Position.Z)};
+            Positions.Add(MakeShared<FJsonValueArray>(Components));
+        }
+        Run->SetArrayField(TEXT("FinalPositions"), Positions);
+        Run->SetStringField(TEXT("PositionChecksum"), FString::Printf(TEXT("%08x"), Result.PositionChecksum));
+
+        Runs.Add(MakeShared<FJsonValueObject>(Run));
+    }
+    Report->SetArrayField(TEXT("Runs"), Runs);
+
+    FString Json;
+    const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+    FJsonSerializer::Serialize(Report, Writer);
+
+    const FString FileName = FString::Printf(TEXT("MPVehicle_%s%s_%s.json"), *GetWorld()->GetMapName(),
+        bFlatPlane ? TEXT("_Flat") : TEXT(""), *FDateTime::Now().ToString());
+    const FString FilePath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"), FileName);
+    if (FFileHelper::SaveStringToFile(Json, *FilePath))
+    {
+        UE_LOG(LogMPVehicleBenchmark, Display, TEXT("Wrote %s"), *FilePath);
+    }
+    else
+    {
+        UE_LOG(LogMPVehicleBenchmark, Error, TEXT("Could not write %s"), *FilePath);
+    }
+}
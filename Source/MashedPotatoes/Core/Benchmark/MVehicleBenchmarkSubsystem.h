@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MVehicleBenchmarkSubsystem.generated.h"
+
+class AMVehicleBase;
+class AActor;
+
+// Headless vehicle physics benchmark. Does nothing unless the game is started with -MPVehicleBenchmark, e.g.
+//
+//   UnrealEditor-Cmd MashedPotatoes.uproject /Game/Maps/Lvl_VehicleBasic -game -nullrhi -unattended -benchmark -fps=60 -MPVehicleBenchmark
+//
+// For every vehicle count it spawns that many cars, drives them with scripted throttle/steer/brake for a fixed
+// number of frames and records per-frame timings (frame, game thread, our vehicle step and the Chaos solver), memory
+// and the final positions. The report is written as JSON
+// to Saved/Benchmarks and the game exits when running unattended. -benchmark -fps=N fixes the frame time so two
+// runs of the same build should report the same PositionChecksum.
+//
+// Options:
+//   -MPBenchmarkCounts=1,8,32,128   vehicle counts to run, in order
+//   -MPBenchmarkFrames=600          measured frames per count
+//   -MPBenchmarkWarmup=60           frames to let the cars settle before measuring
+//   -MPBenchmarkFlat                drive on a spawned flat plane below the map instead of the level itself
+//   -MPBenchmarkClass=/Game/...     vehicle class to spawn, defaults to BP_VehicleBase
+//   -MPBenchmarkBots                spawn the cars on the starting grid and let UMBotDriverSubsystem race them round the
+//                                   track instead of scripted input, with the bot settings' vehicle class
+UCLASS()
+class MASHEDPOTATOES_API UMVehicleBenchmarkSubsystem : public UTickableWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    // USubsystem
+    virtual void Deinitialize() override;
+    // UWorldSubsystem
+    virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+    // FTickableGameObject
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+    virtual bool IsTickable() const override { return bRunning; }
+
+    // True when the command line asks for the benchmark
+    static bool IsRequested();
+
+protected:
+    virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+    struct FFrameSample
+    {
+        float FrameMs = 0.0f;
+        float GameThreadMs = 0.0f;
+        // Our force model inside the physics step, and the Chaos solver time of the same steps
+        float VehicleStepMs = 0.0f;
+        float PhysicsSolveMs = 0.0f;
+    };
+
+    struct FRunResult
+    {
+        int32 NumVehicles = 0;
+        TArray<FFrameSample> Samples;
+        uint64 UsedPhysicalStart = 0;
+        uint64 UsedPhysicalEnd = 0;
+        uint64 UsedPhysicalPeak = 0;
+        TArray<FVector> FinalPositions;
+        uint32 PositionChecksum = 0;
+    };
+
+    void StartRun();
+    void FinishRun();
+    void SpawnFlatPlane();
+    // Scripted driver input, the same for a given vehicle and frame on every run
+    void DriveVehicles();
+    void WriteReport() const;
+
+    bool bRunning = false;
+    TArray<int32> VehicleCounts;
+    int32 NumFrames = 600;
+    int32 NumWarmupFrames = 60;
+    bool bFlatPlane = false;
+    bool bBotDrivers = false;
+    UPROPERTY()
+    TSubclassOf<AMVehicleBase> VehicleClass;
+
+    int32 RunIndex = 0;
+    // Frames since the current run's vehicles were spawned
+    int32 RunFrame = 0;
+    double LastFrameSeconds = 0.0;
+    FVector Origin = FVector::ZeroVector;
+
+    UPROPERTY()
+    TArray<TObjectPtr<AMVehicleBase>> Vehicles;
+    UPROPERTY()
+    TObjectPtr<AActor> FlatPlane;
+
+    TArray<FRunResult> Results;
+};
@@ -5,23 +5,54 @@
 #include "Components/ArrowComponent.h"
 #include "EnhancedInput/Public/EnhancedInputComponent.h"
 #include "GameFramework/SpringArmComponent.h"
-#include "DrawDebugHelpers.h" // For visualizing forces
 #include "Camera/CameraComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "GameFramework/PlayerController.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "EnhancedInput/Public/EnhancedInputSubsystems.h"
+#include "Core/Physics/MVehicleSimulationSubsystem.h"
+#include "Core/Physics/MVehicleSuspensionQuerySubsystem.h"
+#include "Core/Physics/MVehicleHandlingProfile.h"
+#include "Core/Debug/MVehicleStats.h"
+#include "Core/Significance/MVehicleSignificanceSubsystem.h"
+#include "Core/Spatial/MVehicleSpatialSubsystem.h"
+#include "Core/Items/MItemSubsystem.h"
+#include "Core/Assets/MAssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "Net/UnrealNetwork.h"
+
+static TAutoConsoleVariable<float> CVarWheelVisualsCullDistance(
+    TEXT("mp.Vehicle.WheelVisuals.CullDistance"),
+    10000.0f,
+    TEXT("Wheel meshes of cars further than this from every player camera are not moved. 0 disables the check."),
+    ECVF_Scalability);
+
+static TAutoConsoleVariable<bool> CVarWheelVisualsSkipOffscreen(
+    TEXT("mp.Vehicle.WheelVisuals.SkipOffscreen"),
+    true,
+    TEXT("Do not move the wheel meshes of cars that were not rendered recently."),
+    ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarWheelContactReuseDistance(
+    TEXT("mp.Vehicle.Contact.ReuseDistance"),
+    2.0f,
+    TEXT("Suspension contacts are not queried again while both ends of the wheel's ray have moved less than this (cm)\n")
+    TEXT("since the last query, the old contact plane is reprojected instead. 0 queries every frame."),
+    ECVF_Scalability);
 
 // Sets default values
 AMVehicleBase::AMVehicleBase()
 {
     PrimaryActorTick.bCanEverTick = true;
+
+    // Movement is replicated as FMVehicleNetState snapshots instead, 30 per second keeps 8 cars well under 20 KB/s per client
+    bReplicates = true;
+    SetReplicatingMovement(false);
+    SetNetUpdateFrequency(30.0f);
     
     BodyMeshC = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("BodyMeshC"));
     SetRootComponent(BodyMeshC); // Set the body mesh as the root component
-    
-    if (UStaticMesh* CarMesh = Cast<UStaticMesh>(StaticLoadObject(UStaticMesh::StaticClass(), nullptr, TEXT("/Game/Assets/Car/SM_Car_Body.SM_Car_Body"))))
-    {
-       BodyMeshC->SetStaticMesh(CarMesh);
-    }
+    // The body mesh comes from UMAssetManager in OnConstruction, already loaded by the main menu preload
     // Attach arrow components to the body mesh
     ArrowC_FL = CreateDefaultSubobject<UArrowComponent>(TEXT("ArrowC_FL"));
     ArrowC_FL->SetupAttachment(BodyMeshC, FName("WheelFL"));
@@ -48,6 +79,8 @@ AMVehicleBase::AMVehicleBase()
     WheelScene_RR = CreateDefaultSubobject<USceneComponent>("WheelSceneRR");
     WheelScene_RR->SetupAttachment(ArrowC_RR);
     
+#if !UE_SERVER
+    // Nobody looks through a dedicated server's cars, the server target leaves both null
     SpringArmComponent = CreateDefaultSubobject<USpringArmComponent>(TEXT("SpringArmComponent"));
     SpringArmComponent->SetupAttachment(BodyMeshC);
     SpringArmComponent->TargetArmLength = 600.0f;
@@ -56,21 +89,99 @@ AMVehicleBase::AMVehicleBase()
     
     CameraC = CreateDefaultSubobject<UCameraComponent>(TEXT("CameraC"));
     CameraC->SetupAttachment(SpringArmComponent);
-    
+#endif
+}
+
+void AMVehicleBase::OnConstruction(const FTransform& Transform)
+{
+    Super::OnConstruction(Transform);
+
+    if (BodyMeshC->GetStaticMesh() == nullptr)
+    {
+        BodyMeshC->SetStaticMesh(UMAssetManager::GetVehicleBodyMesh());
+        // The wheel arrows were registered against a body without sockets and sit at its origin, move them onto the
+        // wheel sockets before BeginPlay caches the suspension ray offsets from them
+        BodyMeshC->UpdateChildTransforms();
+    }
 }
 
 void AMVehicleBase::BeginPlay()
 {
     Super::BeginPlay();
+    // Keep the preloaded car assets resident while this car exists, even if the session handle is released
+    PreloadHandle = UMAssetManager::Get().GetVehiclePreloadHandle();
     // Initialize the holder array for wheel arrow components
     WheelArrowComponentHolder = {ArrowC_FL, ArrowC_FR, ArrowC_RL, ArrowC_RR};
     WheelSceneComponentHolder = {WheelScene_FL, WheelScene_FR, WheelScene_RL, WheelScene_RR};
+    // The wheel meshes are added in the blueprint, as the first child of each wheel scene
+    for (int wheelArrowIndex = 0; wheelArrowIndex < 4; wheelArrowIndex++)
+    {
+        USceneComponent* wheelMeshC = WheelSceneComponentHolder[wheelArrowIndex]->GetChildComponent(0);
+        WheelMeshComponentHolder.Add(wheelMeshC);
+        WheelMeshBaseRotations[wheelArrowIndex] = wheelMeshC ? wheelMeshC->GetRelativeRotation().Quaternion() : FQuat::Identity;
+    }
+
+    // Cache where each suspension ray starts relative to the body, the physics step rebuilds it from the body pose
+    const FTransform bodyTransform = BodyMeshC->GetComponentTransform();
+    for (int wheelArrowIndex = 0; wheelArrowIndex < 4; wheelArrowIndex++)
+    {
+        const UArrowComponent* wheelArrowC = WheelArrowComponentHolder[wheelArrowIndex];
+        WheelSetups[wheelArrowIndex].LocalOffset = bodyTransform.InverseTransformPositionNoScale(wheelArrowC->GetComponentLocation());
+        WheelSetups[wheelArrowIndex].LocalDirection = bodyTransform.InverseTransformVectorNoScale(wheelArrowC->GetForwardVector());
+    }
 
     // Setup for line trace collision query
     const FName TraceTag("MyTraceTag");
     LineTraceCollisionQuery.TraceTag = TraceTag;
     // LineTraceCollisionQuery.bDebugQuery = true; // Enable debug drawing for the trace
     LineTraceCollisionQuery.AddIgnoredActor(this); // Ignore the car itself in the trace
+
+    TraceScopeName = FString::Printf(TEXT("MPVehicle %s"), *GetName());
+    INC_DWORD_STAT(STAT_MPVehicleCount);
+
+    if (UMVehicleSimulationSubsystem* SimulationSubsystem = GetWorld()->GetSubsystem<UMVehicleSimulationSubsystem>())
+    {
+        SimulationSlot = SimulationSubsystem->RegisterVehicle(this);
+    }
+    if (UMVehicleSuspensionQuerySubsystem* QuerySubsystem = GetWorld()->GetSubsystem<UMVehicleSuspensionQuerySubsystem>())
+    {
+        SuspensionQuerySlot = QuerySubsystem->RegisterVehicle(this);
+    }
+    if (UMVehicleSignificanceSubsystem* SignificanceSubsystem = GetWorld()->GetSubsystem<UMVehicleSignificanceSubsystem>())
+    {
+        SignificanceSubsystem->RegisterVehicle(this);
+    }
+    if (UMVehicleSpatialSubsystem* SpatialSubsystem = GetWorld()->GetSubsystem<UMVehicleSpatialSubsystem>())
+    {
+        SpatialSubsystem->RegisterVehicle(this);
+    }
+    UpdateCameraComponents();
+}
+
+void AMVehicleBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    if (UMVehicleSimulationSubsystem* SimulationSubsystem = GetWorld()->GetSubsystem<UMVehicleSimulationSubsystem>())
+    {
+        SimulationSubsystem->UnregisterVehicle(this);
+    }
+    if (UMVehicleSuspensionQuerySubsystem* QuerySubsystem = GetWorld()->GetSubsystem<UMVehicleSuspensionQuerySubsystem>())
+    {
+        QuerySubsystem->UnregisterVehicle(this);
+    }
+    if (UMVehicleSignificanceSubsystem* SignificanceSubsystem = GetWorld()->GetSubsystem<UMVehicleSignificanceSubsystem>())
+    {
+        SignificanceSubsystem->UnregisterVehicle(this);
+    }
+    if (UMVehicleSpatialSubsystem* SpatialSubsystem = GetWorld()->GetSubsystem<UMVehicleSpatialSubsystem>())
+    {
+        SpatialSubsystem->UnregisterVehicle(this);
+    }
+    SimulationSlot = INDEX_NONE;
+    SuspensionQuerySlot = INDEX_NONE;
+    PreloadHandle.Reset();
+    DEC_DWORD_STAT(STAT_MPVehicleCount);
+
+    Super::EndPlay(EndPlayReason);
 }
 
 void AMVehicleBase::PostInitializeComponents()
@@ -82,202 +193,520 @@ void AMVehicleBase::PostInitializeComponents()
     BodyMeshC->SetMassOverrideInKg(NAME_None,1100); // Set car mass
 }
 
+void AMVehicleBase::NotifyControllerChanged()
+{
+    Super::NotifyControllerChanged();
+    UpdateCameraComponents();
+}
+
+void AMVehicleBase::UpdateCameraComponents()
+{
+    if (SpringArmComponent == nullptr || CameraC == nullptr) return;
+
+    // Spring arm collision sweeps and lag are wasted on cars nobody is looking through, which includes every car of a
+    // remote player on the server
+    const bool bLocalPlayerControlled = IsPlayerControlled() && IsLocallyControlled();
+    SpringArmComponent->SetComponentTickEnabled(bLocalPlayerControlled);
+    CameraC->SetComponentTickEnabled(bLocalPlayerControlled);
+}
+
+void AMVehicleBase::SetSimulationLOD(EMVehicleSimulationLOD InSimulationLOD)
+{
+    if (SimulationLOD == InSimulationLOD) return;
+    SimulationLOD = InSimulationLOD;
+
+    // The per-frame path applies its forces in Tick, slowing it down would drop forces, so only the fixed step is throttled
+    SetActorTickInterval(IsUsingFixedStepSimulation() ? UMVehicleSignificanceSubsystem::GetTickInterval(SimulationLOD) : 0.0f);
+}
+
 // Called every frame
 void AMVehicleBase::Tick(float DeltaTime)
 {
     Super::Tick(DeltaTime);
-    
-    // Interpolate input values for smoother acceleration and steering
-    SideAxisValue = UKismetMathLibrary::FInterpTo(SideAxisValue, SideAxisInput, GetWorld()->GetDeltaSeconds(), 5);
-    ForwardAxisValue = UKismetMathLibrary::FInterpTo(ForwardAxisValue, ForwardAxisInput, GetWorld()->GetDeltaSeconds(), 5);
 
-    // Update forces for each wheel
-    for (int wheelArrowIndex = 0; wheelArrowIndex < 4; wheelArrowIndex++)
+    SCOPE_CYCLE_COUNTER(STAT_MPVehicleTick);
+    MP_VEHICLE_TRACE_SCOPE_TEXT(*TraceScopeName);
+
+#if MP_VEHICLE_DEBUG
+    bRecordDebugThisFrame = MVehicleDebug::ShouldDebugVehicle(this);
+    PendingDebugFrame = FMVehicleDebugFrame();
+#endif
+
+    UpdateWheelContacts();
+
+    // With the fixed-step simulation the forces are applied on the physics step, the game thread only refreshes the ground contacts
+    if (!IsUsingFixedStepSimulation())
     {
-       UpdateVehicleForce(wheelArrowIndex, DeltaTime);
+        // Interpolate input values for smoother acceleration and steering
+        const FMVehicleForceParams forceParams = GetForceParams();
+        const FMVehicleControlInput controlInput{ForwardAxisInput, SideAxisInput, bBrakeApplied};
+        FMVehicleControlState controlState{ForwardAxisValue, SideAxisValue, CurrentFrontWheelSteerAngle};
+        MVehiclePhysics::UpdateControls(forceParams, controlInput, controlState, DeltaTime);
+        ForwardAxisValue = controlState.ForwardAxisValue;
+        SideAxisValue = controlState.SideAxisValue;
+        CurrentFrontWheelSteerAngle = controlState.FrontWheelSteerAngle;
+
+        // Update forces for each wheel, the body state is shared by all four
+        const FMVehicleBodyState bodyState = GetBodyState();
+        for (int wheelArrowIndex = 0; wheelArrowIndex < 4; wheelArrowIndex++)
+        {
+           UpdateVehicleForce(wheelArrowIndex, DeltaTime, forceParams, bodyState);
+        }
+        UpdateWheelVisuals();
+
+#if MP_VEHICLE_DEBUG
+        if (bRecordDebugThisFrame)
+        {
+            PendingDebugFrame.SteerAngle = CurrentFrontWheelSteerAngle;
+            DebugHistory.Record(PendingDebugFrame);
+        }
+#endif
+    }
+
+#if MP_VEHICLE_DEBUG
+    if (bRecordDebugThisFrame)
+    {
+        MVehicleDebug::DrawVehicle(this, DebugHistory);
     }
+#endif
 }
 
-void AMVehicleBase::UpdateVehicleForce(int WheelArrowIndex, float DeltaTime)
+FMVehicleForceParams AMVehicleBase::GetForceParams() const
+{
+    FMVehicleForceParams forceParams;
+    forceParams.RestLength = RestLength;
+    forceParams.SpringTravelLength = SpringTravelLength;
+    forceParams.WheelRadius = WheelRadius;
+    forceParams.SpringForceConst = SpringForceConst;
+    forceParams.DamperForceConst = DamperForceConst;
+    forceParams.ForwardForceConst = ForwardForceConst;
+    forceParams.FrictionConst = FrictionConst;
+    forceParams.DragConst = DragConst;
+    forceParams.BrakeConst = BrakeConst;
+    forceParams.MaxSteeringAngle = MaxSteeringAngle;
+    forceParams.BrakeStopForceConst = BrakeStopForceConst;
+    forceParams.BrakeStopThresholdVelocity = BrakeStopThresholdVelocity;
+    forceParams.RestingDragConst = RestingDragConst;
+    forceParams.StopThresholdVelocity = StopThresholdVelocity;
+    forceParams.bContactNormalFrame = bUseSweptWheelContact;
+    forceParams.GripScale = GripScale;
+    forceParams.Handling = HandlingProfile ? HandlingProfile->GetTables() : nullptr;
+    return forceParams;
+}
+
+FMVehicleBodyState AMVehicleBase::GetBodyState() const
+{
+    FMVehicleBodyState bodyState;
+    bodyState.Location = BodyMeshC->GetComponentLocation();
+    bodyState.Rotation = BodyMeshC->GetComponentQuat();
+    bodyState.LinearVelocity = BodyMeshC->GetPhysicsLinearVelocity();
+    bodyState.AngularVelocity = BodyMeshC->GetPhysicsAngularVelocityInRadians();
+    bodyState.CenterOfMass = BodyMeshC->GetCenterOfMass(); // Use CoM for accurate lever arm
+    return bodyState;
+}
+
+void AMVehicleBase::GetWheelTrace(int WheelArrowIndex, FVector& OutStart, FVector& OutEnd) const
 {
-    // Calculate min and max spring lengths based on rest length and travel
-    MinLength = RestLength - SpringTravelLength;
-    MaxLength = RestLength + SpringTravelLength;
-    
-    // Validate wheel arrow component index
     if (!WheelArrowComponentHolder.IsValidIndex(WheelArrowIndex)) return;
-    auto wheelArrowC = WheelArrowComponentHolder[WheelArrowIndex];
+    const UArrowComponent* wheelArrowC = WheelArrowComponentHolder[WheelArrowIndex];
 
-    FHitResult outHit;
-    FVector startTraceLoc = wheelArrowC->GetComponentLocation();
+    OutStart = wheelArrowC->GetComponentLocation();
     // Trace downwards from the wheel's arrow component to detect ground
-    FVector endTraceLoc = wheelArrowC->GetForwardVector() * (MaxLength + WheelRadius) + startTraceLoc;
-    
-    // Perform the line trace to detect ground contact
-    GetWorld()->LineTraceSingleByChannel(outHit, startTraceLoc, endTraceLoc, ECC_Visibility, LineTraceCollisionQuery, FCollisionResponseParams());
-    // Draw debug line for the suspension trace
-    DrawDebugLine(GetWorld(), wheelArrowC->GetComponentLocation(), endTraceLoc , FColor::Green, false, -1, 0, 2.0f);
-
-    // --- Suspension Force (Only apply if the wheel is on the ground) ---
-    if (outHit.bBlockingHit)
-    {
-        float currentSpringLength = outHit.Distance - WheelRadius;
-        
-        // Store the current spring length and calculate velocity from the previous frame's length
-        float prevSpringLength = SpringLength[WheelArrowIndex]; // Capture previous length before updating
-        SpringLength[WheelArrowIndex] = UKismetMathLibrary::FClamp(currentSpringLength, MinLength, MaxLength);
-        
-        float springVelocity = (prevSpringLength - SpringLength[WheelArrowIndex]) / DeltaTime; // Velocity of compression/extension
-        
-        float springForce = (RestLength - SpringLength[WheelArrowIndex]) * SpringForceConst; // Force from spring compression/extension
-        float damperForce = springVelocity * DamperForceConst; // Damping force opposes spring velocity
-
-        // Apply upward force from suspension
-        FVector upwardForce = GetActorUpVector() * (springForce + damperForce);
-        BodyMeshC->AddForceAtLocation(upwardForce, wheelArrowC->GetComponentLocation());
-
-        // --- Debug Drawing for Suspension Force ---
-        DrawDebugLine(GetWorld(), wheelArrowC->GetComponentLocation(), wheelArrowC->GetComponentLocation() + upwardForce * 0.01f, FColor::Blue, false, -1, 0, 2.0f);
-    }
-    else
+    OutEnd = wheelArrowC->GetForwardVector() * (RestLength + SpringTravelLength + WheelRadius) + OutStart;
+}
+
+void AMVehicleBase::GetWheelContactQuery(int WheelArrowIndex, FVector& OutStart, FVector& OutEnd, FCollisionShape& OutShape) const
+{
+    GetWheelTrace(WheelArrowIndex, OutStart, OutEnd);
+    if (!bUseSweptWheelContact)
     {
-        // If the wheel is not on the ground, reset its spring length and apply no other forces from it.
-        SpringLength[WheelArrowIndex] = MaxLength; // Spring is fully extended when not touching ground
-        return; // No further forces are applied if the wheel is airborne
+        OutShape = FCollisionShape::LineShape;
+        return;
     }
 
-    // --- Calculate Ground-Aligned Wheel Vectors for Steering and Forces ---
-    // Get the car's forward vector and flatten it to the ground plane (Z=0)
-    FVector carForwardOnGround = GetActorForwardVector();
-    carForwardOnGround.Z = 0.0f; 
-    carForwardOnGround.Normalize(); // Ensure it's a unit vector
+    // The sphere's centre only has to travel the spring range, its surface covers the wheel radius
+    OutEnd -= (OutEnd - OutStart).GetSafeNormal() * WheelRadius;
+    OutShape = FCollisionShape::MakeSphere(WheelRadius);
+}
 
-    FVector wheelForwardVectorGroundAligned;
+FMVehicleWheelContact AMVehicleBase::MakeWheelContact(const FHitResult* Hit) const
+{
+    FMVehicleWheelContact contact;
+    contact.SweepRadius = bUseSweptWheelContact ? WheelRadius : 0.0f;
+    if (Hit == nullptr || !Hit->bBlockingHit)
+    {
+        return contact;
+    }
 
-    // Apply steering only to front wheels (assuming 0=FL, 1=FR)
-    if (WheelArrowIndex == 0 || WheelArrowIndex == 1) 
+    contact.bBlockingHit = true;
+    contact.ImpactPoint = Hit->ImpactPoint;
+    if (bUseSweptWheelContact)
     {
-        // Interpolate the steering angle for smoother transitions
-        CurrentFrontWheelSteerAngle = UKismetMathLibrary::FInterpTo(CurrentFrontWheelSteerAngle, MaxSteeringAngle * SideAxisInput, DeltaTime, 5.0f);
-        // Rotate the car's ground-aligned forward vector by the steering angle around the world's Up vector
-        wheelForwardVectorGroundAligned = carForwardOnGround.RotateAngleAxis(CurrentFrontWheelSteerAngle, FVector::UpVector);
-        WheelSceneComponentHolder[WheelArrowIndex]->SetRelativeRotation(FRotator(0,0,CurrentFrontWheelSteerAngle));
-        
+        // Distance is where the sphere stopped, measure to the bottom of the wheel like a ray would.
+        // Normal points from the touch point to the sphere centre, on an edge that is smoother than the face normal.
+        contact.Distance = Hit->Distance + WheelRadius;
+        contact.ImpactNormal = Hit->Normal;
     }
-    else // Rear wheels (2=RL, 3=RR) do not steer. They follow the car's forward direction
+    else
     {
-        wheelForwardVectorGroundAligned = carForwardOnGround;
+        contact.Distance = Hit->Distance;
+        contact.ImpactNormal = Hit->ImpactNormal;
     }
-    wheelForwardVectorGroundAligned.Normalize(); // Ensure it's a unit vector after rotation
+    return contact;
+}
 
-    // Calculate the wheel's "right" vector, perpendicular to its ground-aligned forward direction
-    FVector wheelRightVectorGroundAligned = UKismetMathLibrary::Cross_VectorVector(FVector::UpVector, wheelForwardVectorGroundAligned);
-    wheelRightVectorGroundAligned.Normalize(); // Ensure it's a unit vector
+bool AMVehicleBase::CanReuseWheelContact(int WheelArrowIndex) const
+{
+    const float reuseDistance = CVarWheelContactReuseDistance.GetValueOnGameThread();
+    if (WheelArrowIndex < 0 || WheelArrowIndex >= 4 || !bWheelContactValid[WheelArrowIndex] || reuseDistance <= 0.0f)
+    {
+        return false;
+    }
 
-    // Get the velocity of the car at this wheel's contact point
-    // This is the linear velocity of the rigid body + the tangential velocity due to angular rotation
-    FVector wheelWorldVelocityAtContact = BodyMeshC->GetPhysicsLinearVelocity() +
-                                         UKismetMathLibrary::Cross_VectorVector(BodyMeshC->GetPhysicsAngularVelocityInDegrees() * (PI / 180.0f), // Convert deg/s to rad/s
-                                                                                wheelArrowC->GetComponentLocation() - BodyMeshC->GetCenterOfMass()); // Use CoM for accurate lever arm
+    // Switching between rays and sweeps invalidates the contact
+    if (WheelContacts[WheelArrowIndex].SweepRadius != (bUseSweptWheelContact ? WheelRadius : 0.0f))
+    {
+        return false;
+    }
 
-    // --- Calculate Slip Velocities using the ground-aligned vectors ---
-    // Longitudinal velocity: how fast the wheel is moving in its ground-aligned forward direction
-    float longitudinalVelocity = FVector::DotProduct(wheelWorldVelocityAtContact, wheelForwardVectorGroundAligned);
-    // Lateral velocity: how fast the wheel is slipping sideways relative to its ground-aligned orientation
-    float lateralVelocity = FVector::DotProduct(wheelWorldVelocityAtContact, wheelRightVectorGroundAligned);
+    // Comparing both ends covers the wheel turning as well as moving
+    FVector start, end;
+    GetWheelTrace(WheelArrowIndex, start, end);
+    const float reuseDistanceSquared = FMath::Square(reuseDistance);
+    return FVector::DistSquared(start, WheelContactStarts[WheelArrowIndex]) < reuseDistanceSquared &&
+        FVector::DistSquared(end, WheelContactEnds[WheelArrowIndex]) < reuseDistanceSquared;
+}
+
+void AMVehicleBase::SetWheelContact(int WheelArrowIndex, const FMVehicleWheelContact& Contact)
+{
+    if (WheelArrowIndex < 0 || WheelArrowIndex >= 4) return;
+    WheelContacts[WheelArrowIndex] = Contact;
+    GetWheelTrace(WheelArrowIndex, WheelContactStarts[WheelArrowIndex], WheelContactEnds[WheelArrowIndex]);
+    bWheelContactValid[WheelArrowIndex] = true;
+}
 
-    // --- PROPULSION / BRAKING FORCE (Active Force) ---
-    float activeLongitudinalForce = 0.0f;
-    float BrakeHoldForceApplied = 0.0f; // For debugging
-    if (bBrakeApplied)
+void AMVehicleBase::UpdateWheelContacts()
+{
+    // Last frame's batched rays are picked up by whichever vehicle ticks first
+    UMVehicleSuspensionQuerySubsystem* QuerySubsystem = GetWorld()->GetSubsystem<UMVehicleSuspensionQuerySubsystem>();
+    if (QuerySubsystem)
     {
-        // Apply strong braking force directly opposing the current longitudinal velocity
-        activeLongitudinalForce = -longitudinalVelocity * BrakeConst;
+        QuerySubsystem->ResolveQueries();
+    }
+    const bool bHasBatchedContacts = QuerySubsystem && UMVehicleSuspensionQuerySubsystem::IsEnabled() && QuerySubsystem->HasResults(SuspensionQuerySlot);
+
+    SCOPE_CYCLE_COUNTER(STAT_MPVehicleSuspensionTraces);
 
-        // Apply a strong "hold" force when braking and nearly stopped
-        if (FMath::Abs(longitudinalVelocity) < BrakeStopThresholdVelocity)
+    for (int wheelArrowIndex = 0; wheelArrowIndex < 4; wheelArrowIndex++)
+    {
+        if (!bHasBatchedContacts && !CanReuseWheelContact(wheelArrowIndex))
         {
-            // Apply a fixed force in the opposite direction of current velocity
-            BrakeHoldForceApplied = -FMath::Sign(longitudinalVelocity) * BrakeStopForceConst;
-            activeLongitudinalForce += BrakeHoldForceApplied; // Add this to the existing braking force
+            TraceWheel(wheelArrowIndex);
         }
-    }
-    else
-    {
-        // Apply propulsion force based on ForwardAxisValue, ONLY TO REAR WHEELS (indices 2 and 3)
-        if (WheelArrowIndex == 2 || WheelArrowIndex == 3) // Assuming 2=RL, 3=RR are rear wheels
+
+#if MP_VEHICLE_DEBUG
+        // Record the suspension trace for drawing
+        if (bRecordDebugThisFrame)
         {
-            activeLongitudinalForce = ForwardAxisValue * ForwardForceConst;
+            FMVehicleDebugWheel& debugWheel = PendingDebugFrame.Wheels[wheelArrowIndex];
+            GetWheelTrace(wheelArrowIndex, debugWheel.Location, debugWheel.TraceEnd);
         }
+#endif
     }
-    // CRITICAL FIX: Apply propulsion/braking force along the ground-aligned wheel forward vector
-    FVector totalWheelForce = wheelForwardVectorGroundAligned * activeLongitudinalForce;
+}
+
+void AMVehicleBase::TraceWheel(int WheelArrowIndex)
+{
+    FHitResult outHit;
+    FVector startTraceLoc, endTraceLoc;
+    FCollisionShape traceShape;
+    GetWheelContactQuery(WheelArrowIndex, startTraceLoc, endTraceLoc, traceShape);
 
-    // --- FRICTION FORCES (Passive, always oppose slip) ---
-    // Lateral Friction: Opposes sideways movement (crucial for steering and preventing spin)
-    float lateralFrictionMagnitude = -lateralVelocity * FrictionConst;
-    totalWheelForce += wheelRightVectorGroundAligned * lateralFrictionMagnitude; // Use ground-aligned right vector for lateral friction
+    // Perform the line trace (or sphere sweep) to detect ground contact
+    INC_DWORD_STAT(STAT_MPVehicleRaycasts);
+    GetWorld()->SweepSingleByChannel(outHit, startTraceLoc, endTraceLoc, FQuat::Identity, ECC_Visibility, traceShape,
+        LineTraceCollisionQuery, FCollisionResponseParams());
+
+    SetWheelContact(WheelArrowIndex, MakeWheelContact(&outHit));
+}
+
+void AMVehicleBase::UpdateVehicleForce(int WheelArrowIndex, float DeltaTime, const FMVehicleForceParams& ForceParams, const FMVehicleBodyState& BodyState)
+{
+    // Validate wheel arrow component index
+    if (!WheelArrowComponentHolder.IsValidIndex(WheelArrowIndex)) return;
+    auto wheelArrowC = WheelArrowComponentHolder[WheelArrowIndex];
 
-    // Longitudinal Friction (Rolling Resistance / Drag): Opposes forward/backward movement
-    // This slows the car down when no active propulsion/braking is applied.
-    float rollingResistanceMagnitude = -longitudinalVelocity * DragConst;
-    totalWheelForce += wheelForwardVectorGroundAligned * rollingResistanceMagnitude; // Use ground-aligned forward vector for rolling resistance
+    // Batched contacts were traced from last frame's pose, move them to where the wheel is now
+    const FMVehicleWheelContact contact = MVehiclePhysics::ReprojectContact(WheelContacts[WheelArrowIndex],
+        wheelArrowC->GetComponentLocation(), wheelArrowC->GetForwardVector(), ForceParams.GetTraceLength());
 
-    // --- Resting Drag / Low Velocity Damping ---
-    float RestingDragForceMagnitude = 0.0f;
-    // Only apply if no active drive/brake input and car is moving very slowly
-    if (FMath::IsNearlyZero(ForwardAxisInput, KINDA_SMALL_NUMBER) && !bBrakeApplied && FMath::Abs(longitudinalVelocity) < StopThresholdVelocity)
+    const FMVehicleControlInput controlInput{ForwardAxisInput, SideAxisInput, bBrakeApplied};
+    const FMVehicleControlState controlState{ForwardAxisValue, SideAxisValue, CurrentFrontWheelSteerAngle};
+    FMVehicleWheelForce wheelForce;
     {
-        // Apply a stronger drag to bring the car to a complete stop
-        RestingDragForceMagnitude = -longitudinalVelocity * RestingDragConst;
-        totalWheelForce += wheelForwardVectorGroundAligned * RestingDragForceMagnitude;
+        SCOPE_CYCLE_COUNTER(STAT_MPVehicleForces);
+        wheelForce = MVehiclePhysics::ComputeWheelForce(WheelArrowIndex, ForceParams, BodyState, controlInput, controlState,
+            wheelArrowC->GetComponentLocation(), contact, SpringLength[WheelArrowIndex], DeltaTime);
     }
 
+    // No further forces are applied if the wheel is airborne
+    if (!wheelForce.bGrounded) return;
+
+    // Apply upward force from suspension
+    BodyMeshC->AddForceAtLocation(wheelForce.SuspensionForce, wheelForce.Location);
 
     // --- Apply Final Combined Force for this Wheel ---
-    BodyMeshC->AddForceAtLocation(totalWheelForce, wheelArrowC->GetComponentLocation());
-
-    // Setting the wheel mesh position
-    WheelSceneComponentHolder[WheelArrowIndex]->SetRelativeLocation(FVector(SpringLength[WheelArrowIndex], 0,0));
-    // Spin wheel
-        
-    WheelSceneComponentHolder[WheelArrowIndex]->GetChildComponent(0)-> AddLocalRotation(FRotator( // directly in the statich mesh
-    0,0,
-    (-360*longitudinalVelocity*DeltaTime)/(2 * UKismetMathLibrary::GetPI() * WheelRadius)));
-    
+    BodyMeshC->AddForceAtLocation(wheelForce.TireForce, wheelForce.Location);
+    INC_DWORD_STAT_BY(STAT_MPVehicleAddForceCalls, 2);
+
+    // Wheel pose, the components are moved once all four wheels are done
+    FMVehicleWheelVisualPose& visualPose = WheelVisualPoses[WheelArrowIndex];
+    visualPose.SpringLength = SpringLength[WheelArrowIndex];
+    visualPose.SteerAngle = CurrentFrontWheelSteerAngle;
+    visualPose.Spin = FRotator::NormalizeAxis(visualPose.Spin + MVehiclePhysics::GetWheelSpinDelta(wheelForce.LongitudinalVelocity, WheelRadius, DeltaTime));
+    bWheelVisualsDirty = true;
+
     // WheelSceneComponentHolder[WheelArrowIndex]->AddLocalRotation(FRotator(
     //     (-360*longitudinalVelocity*DeltaTime)/(2 * UKismetMathLibrary::GetPI() * WheelRadius),
     //     0,
     //     0));
 
-    // --- Debug Drawing for Individual Force Components ---
-    // Total Force (red)
-    DrawDebugLine(GetWorld(), wheelArrowC->GetComponentLocation(), wheelArrowC->GetComponentLocation() + totalWheelForce * 0.001f, FColor::Red, false, -1, 0, 2.0f);
-    
-    // Active Longitudinal Force (green) - should be strong when accelerating/braking
-    DrawDebugLine(GetWorld(), wheelArrowC->GetComponentLocation(), wheelArrowC->GetComponentLocation() + wheelForwardVectorGroundAligned * activeLongitudinalForce * 0.001f, FColor::Green, false, -1, 0, 1.0f);
-    
-    // Lateral Friction Force (yellow) - should be strong when turning or sliding sideways
-    DrawDebugLine(GetWorld(), wheelArrowC->GetComponentLocation(), wheelArrowC->GetComponentLocation() + wheelRightVectorGroundAligned * lateralFrictionMagnitude * 0.001f, FColor::Yellow, false, -1, 0, 1.0f);
-    
-    // Rolling Resistance/Drag Force (magenta) - should always oppose motion
-    DrawDebugLine(GetWorld(), wheelArrowC->GetComponentLocation(), wheelArrowC->GetComponentLocation() + wheelForwardVectorGroundAligned * rollingResistanceMagnitude * 0.001f, FColor::Magenta, false, -1, 0, 1.0f);
+#if MP_VEHICLE_DEBUG
+    // --- Record Individual Force Components, drawn at the end of Tick ---
+    if (bRecordDebugThisFrame)
+    {
+        FMVehicleDebugWheel& debugWheel = PendingDebugFrame.Wheels[WheelArrowIndex];
+        debugWheel.bGrounded = true;
+        debugWheel.SuspensionForce = wheelForce.SuspensionForce;
+        debugWheel.TireForce = wheelForce.TireForce;
+        debugWheel.WheelForward = wheelForce.WheelForward;
+        debugWheel.WheelRight = wheelForce.WheelRight;
+        debugWheel.LateralVelocity = wheelForce.LateralVelocity;
+        debugWheel.ActiveLongitudinalForce = wheelForce.ActiveLongitudinalForce;
+        debugWheel.LateralFrictionMagnitude = wheelForce.LateralFrictionMagnitude;
+        debugWheel.RollingResistanceMagnitude = wheelForce.RollingResistanceMagnitude;
+        debugWheel.RestingDragForceMagnitude = wheelForce.RestingDragForceMagnitude;
+        debugWheel.BrakeHoldForce = wheelForce.BrakeHoldForce;
+    }
+#endif
+}
 
-    // Optional: Visualize wheel's local ground-aligned forward and right vectors
-    // DrawDebugLine(GetWorld(), wheelArrowC->GetComponentLocation(), wheelArrowC->GetComponentLocation() + wheelForwardVectorGroundAligned * 100.0f, FColor::Cyan, false, -1, 0, 0.5f);
-    // DrawDebugLine(GetWorld(), wheelArrowC->GetComponentLocation(), wheelArrowC->GetComponentLocation() + wheelRightVectorGroundAligned * 100.0f, FColor::Orange, false, -1, 0, 0.5f);
+bool AMVehicleBase::IsUsingFixedStepSimulation() const
+{
+    return bUseFixedStepSimulation && SimulationSlot != INDEX_NONE;
+}
 
-    // --- Debug Messages for Steering Diagnosis (Front-Left Wheel only) ---
-    if (WheelArrowIndex == 0) // Only for the front-left wheel
+void AMVehicleBase::GatherSimulationInput(FMVehicleSimInput& OutInput) const
+{
+    OutInput.Params = GetForceParams();
+    OutInput.Controls = FMVehicleControlInput{ForwardAxisInput, SideAxisInput, bBrakeApplied};
+    for (int wheelArrowIndex = 0; wheelArrowIndex < 4; wheelArrowIndex++)
     {
-        if (GEngine)
+        OutInput.Wheels[wheelArrowIndex] = WheelSetups[wheelArrowIndex];
+        OutInput.Contacts[wheelArrowIndex] = WheelContacts[wheelArrowIndex];
+    }
+#if MP_VEHICLE_DEBUG
+    OutInput.bRecordDebug = MVehicleDebug::ShouldDebugVehicle(this);
+#endif
+}
+
+void AMVehicleBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+    Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+    DOREPLIFETIME(AMVehicleBase, ServerState);
+}
+
+EMVehicleNetRole AMVehicleBase::GetVehicleNetRole() const
+{
+    if (GetNetMode() == NM_Standalone)
+    {
+        return EMVehicleNetRole::Local;
+    }
+    if (HasAuthority())
+    {
+        // Cars possessed by a remote player's controller follow that player's input stream
+        const APlayerController* playerController = Cast<APlayerController>(GetController());
+        return playerController && !playerController->IsLocalController() ? EMVehicleNetRole::ServerRemote : EMVehicleNetRole::Local;
+    }
+    return GetLocalRole() == ROLE_AutonomousProxy ? EMVehicleNetRole::AutonomousProxy : EMVehicleNetRole::SimulatedProxy;
+}
+
+void AMVehicleBase::GatherNetworkInput(FMVehicleNetSimInput& OutInput)
+{
+    OutInput.Role = GetVehicleNetRole();
+    OutInput.bOutputState = HasAuthority() && GetNetMode() != NM_Standalone;
+    OutInput.GravityZ = GetWorld()->GetGravityZ();
+
+    if (bServerStatePending)
+    {
+        OutInput.bHasCorrection = true;
+        OutInput.Correction = ServerState;
+        bServerStatePending = false;
+    }
+
+    OutInput.RemoteInputs = ReceivedInputs;
+    ReceivedInputs.Reset();
+}
+
+void AMVehicleBase::ApplyNetworkOutput(uint32 Step, const FMVehicleQuantizedInput& Input, const FMVehicleNetState* NetState)
+{
+    if (NetState)
+    {
+        ServerState = *NetState;
+    }
+
+    if (GetVehicleNetRole() == EMVehicleNetRole::AutonomousProxy)
+    {
+        // The inputs in a message have to be consecutive
+        if (PredictedInputs.Inputs.Num() > 0 && Step != PredictedInputs.LastStep + 1)
+        {
+            PredictedInputs.Inputs.Reset();
+        }
+        if (PredictedInputs.Inputs.Num() == FMVehicleNetInputs::MaxInputs)
+        {
+            PredictedInputs.Inputs.RemoveAt(0, 1, EAllowShrinking::No);
+        }
+        PredictedInputs.Inputs.Add(Input);
+        PredictedInputs.LastStep = Step;
+        bPredictedInputsDirty = true;
+    }
+}
+
+void AMVehicleBase::SendPredictedInputs()
+{
+    if (bPredictedInputsDirty)
+    {
+        ServerSendInputs(PredictedInputs);
+        bPredictedInputsDirty = false;
+    }
+}
+
+void AMVehicleBase::OnRep_ServerState()
+{
+    bServerStatePending = true;
+}
+
+void AMVehicleBase::ServerSendInputs_Implementation(const FMVehicleNetInputs& Inputs)
+{
+    const int32 numInputs = Inputs.Inputs.Num();
+    for (int32 inputIndex = 0; inputIndex < numInputs; inputIndex++)
+    {
+        const uint32 step = Inputs.LastStep - static_cast<uint32>(numInputs - 1 - inputIndex);
+        if (bHasReceivedInput && step <= LastReceivedInputStep)
+        {
+            continue; // Already had it from an earlier message
+        }
+
+        if (ReceivedInputs.Num() == FMVehicleNetInputs::MaxInputs)
         {
-            GEngine->AddOnScreenDebugMessage(1, 0.1f, FColor::Orange, FString::Printf(TEXT("FL Wheel Lateral Vel: %.2f"), lateralVelocity));
-            GEngine->AddOnScreenDebugMessage(2, 0.1f, FColor::Orange, FString::Printf(TEXT("FL Wheel Lat Friction Mag: %.2f"), lateralFrictionMagnitude));
-            GEngine->AddOnScreenDebugMessage(3, 0.1f, FColor::Orange, FString::Printf(TEXT("FL Wheel Steer Angle: %.2f"), CurrentFrontWheelSteerAngle));
-            GEngine->AddOnScreenDebugMessage(4, 0.1f, FColor::Cyan, FString::Printf(TEXT("Resting Drag Force: %.2f"), RestingDragForceMagnitude));
-            GEngine->AddOnScreenDebugMessage(5, 0.1f, FColor::Red, FString::Printf(TEXT("Brake Hold Force: %.2f"), BrakeHoldForceApplied));
+            ReceivedInputs.RemoveAt(0, 1, EAllowShrinking::No);
         }
+        ReceivedInputs.Add({step, Inputs.Inputs[inputIndex]});
+        LastReceivedInputStep = step;
+        bHasReceivedInput = true;
+    }
+}
+
+void AMVehicleBase::ServerUseItem_Implementation(EMItemType ItemType)
+{
+    if (UMItemSubsystem* ItemSubsystem = GetWorld()->GetSubsystem<UMItemSubsystem>())
+    {
+        ItemSubsystem->UseItem(this, ItemType);
+    }
+}
+
+void AMVehicleBase::RecordDebugFrame(const FMVehicleDebugFrame& Frame)
+{
+#if MP_VEHICLE_DEBUG
+    DebugHistory.Record(Frame);
+#endif
+}
+
+void AMVehicleBase::ApplySimulationOutput(const FMVehicleSimOutput& Output)
+{
+    ForwardAxisValue = Output.Controls.ForwardAxisValue;
+    SideAxisValue = Output.Controls.SideAxisValue;
+    CurrentFrontWheelSteerAngle = Output.Controls.FrontWheelSteerAngle;
+
+    for (int wheelArrowIndex = 0; wheelArrowIndex < 4; wheelArrowIndex++)
+    {
+        SpringLength[wheelArrowIndex] = Output.SpringLength[wheelArrowIndex];
+
+        // Airborne wheels keep their last pose, same as the per-frame path
+        if (!Output.bGrounded[wheelArrowIndex]) continue;
+
+        FMVehicleWheelVisualPose& visualPose = WheelVisualPoses[wheelArrowIndex];
+        visualPose.SpringLength = SpringLength[wheelArrowIndex];
+        visualPose.SteerAngle = CurrentFrontWheelSteerAngle;
+        visualPose.Spin = Output.WheelRotation[wheelArrowIndex];
+        bWheelVisualsDirty = true;
+    }
+
+    UpdateWheelVisuals();
+}
+
+bool AMVehicleBase::ShouldUpdateWheelVisuals() const
+{
+    // No local viewer on a dedicated server, the wheels only matter to clients
+    if (IsNetMode(NM_DedicatedServer))
+    {
+        return false;
+    }
+
+    if (CVarWheelVisualsSkipOffscreen.GetValueOnGameThread() && !BodyMeshC->WasRecentlyRendered(0.2f))
+    {
+        return false;
+    }
+
+    const float cullDistance = CVarWheelVisualsCullDistance.GetValueOnGameThread();
+    if (cullDistance <= 0.0f)
+    {
+        return true;
+    }
+
+    // Close enough to any local player's camera (split screen has several)
+    const FVector location = GetActorLocation();
+    for (FConstPlayerControllerIterator iterator = GetWorld()->GetPlayerControllerIterator(); iterator; ++iterator)
+    {
+        const APlayerController* playerController = iterator->Get();
+        if (playerController && playerController->IsLocalController() && playerController->PlayerCameraManager &&
+            FVector::DistSquared(playerController->PlayerCameraManager->GetCameraLocation(), location) <= FMath::Square(cullDistance))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void AMVehicleBase::UpdateWheelVisuals()
+{
+    // Poses keep accumulating while skipped, the wheels snap to the latest one when the car comes back into view
+    if (!bWheelVisualsDirty || WheelSceneComponentHolder.Num() != 4 || !ShouldUpdateWheelVisuals()) return;
+    bWheelVisualsDirty = false;
+
+    SCOPE_CYCLE_COUNTER(STAT_MPVehicleComponentMoves);
+    MP_VEHICLE_TRACE_SCOPE_TEXT(*TraceScopeName);
+
+    for (int wheelArrowIndex = 0; wheelArrowIndex < 4; wheelArrowIndex++)
+    {
+        USceneComponent* wheelSceneC = WheelSceneComponentHolder[wheelArrowIndex];
+        const FMVehicleWheelVisualPose& visualPose = WheelVisualPoses[wheelArrowIndex];
+
+        // Set the relative transforms without updating anything yet...
+        wheelSceneC->SetRelativeLocation_Direct(FVector(visualPose.SpringLength, 0,0));
+        if (MVehiclePhysics::IsFrontWheel(wheelArrowIndex))
+        {
+            wheelSceneC->SetRelativeRotation_Direct(FRotator(0,0,visualPose.SteerAngle));
+        }
+        if (USceneComponent* wheelMeshC = WheelMeshComponentHolder[wheelArrowIndex])
+        {
+            wheelMeshC->SetRelativeRotation_Direct((WheelMeshBaseRotations[wheelArrowIndex] * FRotator(0,0,visualPose.Spin).Quaternion()).Rotator());
+        }
+
+        // ...then one transform update per wheel, which carries the wheel mesh along with it
+        wheelSceneC->UpdateComponentToWorld();
+        INC_DWORD_STAT(STAT_MPVehicleComponentMoveCalls);
     }
 }
 
@@ -357,6 +786,13 @@ void AMVehicleBase::SetupPlayerInputComponent(UInputComponent* PlayerInputCompon
     }
 }
 
+void AMVehicleBase::SetDriverInput(float InForwardAxisInput, float InSideAxisInput, bool bInBrakeApplied)
+{
+    ForwardAxisInput = InForwardAxisInput;
+    SideAxisInput = InSideAxisInput;
+    bBrakeApplied = bInBrakeApplied;
+}
+
 void AMVehicleBase::Accelerate(const FInputActionValue& Value)
 {
     ForwardAxisInput = Value.Get<float>(); // Set here, interpolate in tick
@@ -368,12 +804,16 @@ void AMVehicleBase::Steer(const FInputActionValue& Value)
 void AMVehicleBase::BrakeStarted(const FInputActionValue& Value)
 {
     bBrakeApplied = true;
-    if (GEngine)
+#if MP_VEHICLE_DEBUG
+    if (GEngine && MVehicleDebug::GetDebugLevel() >= 2)
        GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Red, TEXT("Brake Started."));
+#endif
 }
 void AMVehicleBase::BrakeEnded(const FInputActionValue& Value)
 {
     bBrakeApplied = false;
-    if (GEngine)
+#if MP_VEHICLE_DEBUG
+    if (GEngine && MVehicleDebug::GetDebugLevel() >= 2)
        GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Red, TEXT("Brake Ended."));
+#endif
 }
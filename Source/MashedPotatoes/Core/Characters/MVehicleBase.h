@@ -6,6 +6,11 @@
 #include "InputAction.h" // Required for FInputActionValue
 #include "InputMappingContext.h" // Required for UInputMappingContext
 #include "GameFramework/Pawn.h"
+#include "CollisionShape.h"
+#include "Core/Physics/MVehiclePhysics.h"
+#include "Core/Debug/MVehicleDebug.h"
+#include "Core/Net/MVehicleNetTypes.h"
+#include "Core/Items/MItemSettings.h"
 #include "MVehicleBase.generated.h" // Always the last include for UCLASS()
 
 // Forward declarations to avoid including full headers in the .h file
@@ -15,8 +20,20 @@ class UArrowComponent;
 class USpringArmComponent;
 class UCameraComponent;
 class UInputComponent; // For SetupPlayerInputComponent
+class UMVehicleHandlingProfile;
+struct FHitResult;
+struct FStreamableHandle;
 struct FInputActionValue; // For input action functions
 
+// Where a wheel mesh should be drawn, kept apart from the components so they are only touched once per frame
+struct FMVehicleWheelVisualPose
+{
+    float SpringLength = 0.0f;
+    float SteerAngle = 0.0f;
+    // Accumulated wheel spin in degrees, wrapped to [-180, 180)
+    float Spin = 0.0f;
+};
+
 UCLASS()
 class MASHEDPOTATOES_API AMVehicleBase : public APawn
 {
@@ -48,11 +65,12 @@ public:
     UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
     USceneComponent* WheelScene_RL;
 
+    // Both null in the Server target
     UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
-    USpringArmComponent* SpringArmComponent;
+    USpringArmComponent* SpringArmComponent = nullptr;
     
     UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
-    UCameraComponent* CameraC;
+    UCameraComponent* CameraC = nullptr;
 
     // --- Car Physics Parameters (Exposed in Editor) ---
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Car Physics|Suspension")
@@ -70,6 +88,10 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Car Physics|Suspension")
     // Damping for the suspension (absorbs oscillations)
     float DamperForceConst = 2456.0f;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Car Physics|Suspension")
+    // Sweep a sphere of WheelRadius instead of a thin ray and push the tires along the contact surface.
+    // Rolls over bumps and seams instead of snagging on them.
+    bool bUseSweptWheelContact = false;
 
     
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Car Physics|Engine")
@@ -97,6 +119,15 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Car Physics|Braking")
     // Velocity threshold below which BrakeStopForceConst applies
     float BrakeStopThresholdVelocity = 50.0f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Car Physics|Handling")
+    // Grip and torque curves, drivetrain and brake bias. Replaces FrictionConst, ForwardForceConst and the rear wheel
+    // drive when set, the other constants still apply.
+    TObjectPtr<UMVehicleHandlingProfile> HandlingProfile;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Car Physics|Simulation")
+    // Run the wheel forces on the fixed async physics step instead of once per rendered frame
+    bool bUseFixedStepSimulation = true;
    
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Enhanced Input")
     UInputMappingContext* InputMapping;
@@ -111,10 +142,16 @@ public:
     UInputAction* InputBrake;
     
 protected:
+    // Called when the actor is spawned or changed in the editor, after the construction script
+    virtual void OnConstruction(const FTransform& Transform) override;
     // Called when the game starts or when spawned
     virtual void BeginPlay() override;
     // Called after components are initialized (e.g., physics setup)
     virtual void PostInitializeComponents() override;
+    // Called when the actor is removed from the world
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+    // Called when the pawn is possessed or unpossessed
+    virtual void NotifyControllerChanged() override;
 
     // --- Internal State Variables ---
     UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Car State")
@@ -148,23 +185,135 @@ public:
     // Called to bind functionality to input
     virtual void SetupPlayerInputComponent(UInputComponent* PlayerInputComponent) override;
 
+    // Drives the car without an input component (benchmarks, replays, AI). Same values the input actions set.
+    void SetDriverInput(float InForwardAxisInput, float InSideAxisInput, bool bInBrakeApplied);
+
+    // --- Fixed-Step Simulation (driven by UMVehicleSimulationSubsystem) ---
+    // True when the wheel forces are computed on the physics step rather than in Tick
+    bool IsUsingFixedStepSimulation() const;
+    // Fills the snapshot the physics step works from: tuning, raw input and this frame's ground contacts
+    void GatherSimulationInput(FMVehicleSimInput& OutInput) const;
+    // Moves the wheel visuals to the (interpolated) result of the physics step
+    void ApplySimulationOutput(const FMVehicleSimOutput& Output);
+
+    // --- Suspension Queries (batched by UMVehicleSuspensionQuerySubsystem) ---
+    // World space start and end of a wheel's suspension ray
+    void GetWheelTrace(int WheelArrowIndex, FVector& OutStart, FVector& OutEnd) const;
+    // What to actually query for a wheel: the ray, or a sphere sweep that ends one radius earlier
+    void GetWheelContactQuery(int WheelArrowIndex, FVector& OutStart, FVector& OutEnd, FCollisionShape& OutShape) const;
+    // Turns the result of GetWheelContactQuery into a contact, null for a miss
+    FMVehicleWheelContact MakeWheelContact(const FHitResult* Hit) const;
+    // True while the wheel is close enough to where its contact was queried that reprojecting it is as good as a new query
+    bool CanReuseWheelContact(int WheelArrowIndex) const;
+    const FCollisionQueryParams& GetSuspensionQueryParams() const { return LineTraceCollisionQuery; }
+    void SetWheelContact(int WheelArrowIndex, const FMVehicleWheelContact& Contact);
+
+    // Scales the tires' lateral grip, e.g. while driving through oil (UMItemSubsystem)
+    void SetGripScale(float InGripScale) { GripScale = InGripScale; }
+    float GetGripScale() const { return GripScale; }
+    // Items are spawned by the server, a client's UMItemSubsystem::UseItem asks for them through its own car
+    UFUNCTION(Server, Reliable)
+    void ServerUseItem(EMItemType ItemType);
+
+    // --- Simulation LOD (chosen by UMVehicleSignificanceSubsystem) ---
+    // Lower LODs tick less often and refresh fewer suspension rays
+    void SetSimulationLOD(EMVehicleSimulationLOD InSimulationLOD);
+    EMVehicleSimulationLOD GetSimulationLOD() const { return SimulationLOD; }
+
+    // --- Debug Visualisation (mp.Vehicle.Debug, compiled out of Shipping/Test) ---
+    // Stores a step recorded by the fixed-step simulation
+    void RecordDebugFrame(const FMVehicleDebugFrame& Frame);
+
+    // --- Networking (fixed-step simulation only, see MVehicleNetPrediction.h) ---
+    virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+    EMVehicleNetRole GetVehicleNetRole() const;
+    // Hands the physics step new server state (clients) or new client inputs (server), each only once
+    void GatherNetworkInput(FMVehicleNetSimInput& OutInput);
+    // Called for every physics step: queues the input a client predicted with, stores the state a server replicates
+    void ApplyNetworkOutput(uint32 Step, const FMVehicleQuantizedInput& Input, const FMVehicleNetState* NetState);
+    // Sends the inputs queued this frame to the server, once per frame
+    void SendPredictedInputs();
+
 private:
+    // Latest authoritative state, quantized and sent at NetUpdateFrequency
+    UPROPERTY(ReplicatedUsing = OnRep_ServerState)
+    FMVehicleNetState ServerState;
+    bool bServerStatePending = false;
+
+    UFUNCTION()
+    void OnRep_ServerState();
+
+    UFUNCTION(Server, Unreliable)
+    void ServerSendInputs(const FMVehicleNetInputs& Inputs);
+
+    // Client: the newest inputs, re-sent every frame so a lost packet is covered by the next one
+    FMVehicleNetInputs PredictedInputs;
+    bool bPredictedInputsDirty = false;
+    // Server: inputs received since the last physics step picked them up
+    TArray<FMVehicleNetInput, TInlineAllocator<FMVehicleNetInputs::MaxInputs>> ReceivedInputs;
+    uint32 LastReceivedInputStep = 0;
+    bool bHasReceivedInput = false;
+
     // --- Internal Physics Calculation Variables ---
     // Array to hold references to wheel arrow components
     TArray<UArrowComponent*> WheelArrowComponentHolder;
     // Array to hold references to wheel meshes
     TArray<USceneComponent*> WheelSceneComponentHolder;
-    // Minimum compressed length of the spring
-    float MinLength;
-    // Maximum extended length of the spring
-    float MaxLength;
     // Current length of each spring
     float SpringLength[4] = {0.0f, 0.0f, 0.0f, 0.0f};
     // Parameters for the wheel line trace
     FCollisionQueryParams LineTraceCollisionQuery;
+    // Latest ground contact of each wheel
+    FMVehicleWheelContact WheelContacts[4];
+    // Ray the contact was stored for, see CanReuseWheelContact
+    FVector WheelContactStarts[4];
+    FVector WheelContactEnds[4];
+    bool bWheelContactValid[4] = {false, false, false, false};
+    // Suspension ray start/direction of each wheel relative to the body
+    FMVehicleWheelSetup WheelSetups[4];
+    // Wheel meshes under each WheelScene, spun around their own axis
+    TArray<USceneComponent*> WheelMeshComponentHolder;
+    // Relative rotation the wheel meshes were authored with, spin is applied on top
+    FQuat WheelMeshBaseRotations[4] = {FQuat::Identity, FQuat::Identity, FQuat::Identity, FQuat::Identity};
+    // Latest pose of each wheel and whether the components still have to be moved to it
+    FMVehicleWheelVisualPose WheelVisualPoses[4];
+    bool bWheelVisualsDirty = true;
+    // Slot in UMVehicleSimulationSubsystem, INDEX_NONE if not registered
+    int32 SimulationSlot = INDEX_NONE;
+    // Slot in UMVehicleSuspensionQuerySubsystem, INDEX_NONE if not registered
+    int32 SuspensionQuerySlot = INDEX_NONE;
+
+    EMVehicleSimulationLOD SimulationLOD = EMVehicleSimulationLOD::Full;
+    float GripScale = 1.0f;
+
+    // Per car scope name in Insights (MPVehicleChannel), built once in BeginPlay
+    FString TraceScopeName;
+    // UMAssetManager's preload of car, item and player assets
+    TSharedPtr<FStreamableHandle> PreloadHandle;
+
+#if MP_VEHICLE_DEBUG
+    // Recent steps, drawn once per frame instead of from inside the force path
+    FMVehicleDebugHistory DebugHistory;
+    // Frame being filled by the per-frame path
+    FMVehicleDebugFrame PendingDebugFrame;
+    bool bRecordDebugThisFrame = false;
+#endif
 
+    // The spring arm and camera only need to update for pawns a player is driving
+    void UpdateCameraComponents();
+    // Copies the tuning constants into the form the force model uses
+    FMVehicleForceParams GetForceParams() const;
+    // Current rigid body state of BodyMeshC
+    FMVehicleBodyState GetBodyState() const;
+    // Makes sure every wheel has a contact for this frame, from the batched queries or by tracing
+    void UpdateWheelContacts();
+    // Traces the suspension ray of a single wheel and stores the contact
+    void TraceWheel(int WheelArrowIndex);
+    // Writes WheelVisualPoses to the wheel components in one pass, unless the car is off-screen or far from every camera
+    void UpdateWheelVisuals();
+    bool ShouldUpdateWheelVisuals() const;
     // Calculates and applies forces for a single wheel
-    void UpdateVehicleForce(int WheelArrowIndex, float DeltaTime); 
+    void UpdateVehicleForce(int WheelArrowIndex, float DeltaTime, const FMVehicleForceParams& ForceParams, const FMVehicleBodyState& BodyState); 
     
     // Input Action Callbacks
     void Accelerate(const FInputActionValue& Value);
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MVehicleDebug.h"
+
+#if MP_VEHICLE_DEBUG
+
+#include "Components/LineBatchComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Core/Characters/MVehicleBase.h"
+
+static TAutoConsoleVariable<int32> CVarVehicleDebug(
+    TEXT("mp.Vehicle.Debug"),
+    0,
+    TEXT("Vehicle physics debug visualisation.\n")
+    TEXT("0: off\n")
+    TEXT("1: suspension rays and wheel force lines\n")
+    TEXT("2: lines plus on-screen front-left wheel values"),
+    ECVF_Cheat);
+
+static TAutoConsoleVariable<FString> CVarVehicleDebugFilter(
+    TEXT("mp.Vehicle.Debug.Filter"),
+    TEXT(""),
+    TEXT("Only debug vehicles whose name contains this string. Empty debugs every vehicle."),
+    ECVF_Cheat);
+
+int32 MVehicleDebug::GetDebugLevel()
+{
+    return CVarVehicleDebug.GetValueOnGameThread();
+}
+
+bool MVehicleDebug::ShouldDebugVehicle(const AMVehicleBase* Vehicle)
+{
+    if (Vehicle == nullptr || GetDebugLevel() <= 0)
+    {
+        return false;
+    }
+    // Nothing would show the lines or messages, e.g. the editor or Game binary running with -server
+    if (Vehicle->IsNetMode(NM_DedicatedServer))
+    {
+        return false;
+    }
+
+    const FString Filter = CVarVehicleDebugFilter.GetValueOnGameThread();
+    return Filter.IsEmpty() || Vehicle->GetName().Contains(Filter);
+}
+
+void MVehicleDebug::DrawVehicle(const AMVehicleBase* Vehicle, const FMVehicleDebugHistory& History)
+{
+    const FMVehicleDebugFrame* Frame = History.GetFrame();
+    UWorld* World = Vehicle ? Vehicle->GetWorld() : nullptr;
+    if (Frame == nullptr || World == nullptr)
+    {
+        return;
+    }
+
+    // Same colours and scales the force path used to draw with, submitted in one go
+    TArray<FBatchedLine, TInlineAllocator<24>> Lines;
+    for (const FMVehicleDebugWheel& Wheel : Frame->Wheels)
+    {
+        const FVector& Location = Wheel.Location;
+        // Suspension trace (green)
+        Lines.Emplace(Location, Wheel.TraceEnd, FColor::Green, 0.0f, 2.0f, SDPG_World);
+        if (!Wheel.bGrounded)
+        {
+            continue;
+        }
+        // Suspension force (blue)
+        Lines.Emplace(Location, Location + Wheel.SuspensionForce * 0.01f, FColor::Blue, 0.0f, 2.0f, SDPG_World);
+        // Total tire force (red)
+        Lines.Emplace(Location, Location + Wheel.TireForce * 0.001f, FColor::Red, 0.0f, 2.0f, SDPG_World);
+        // Active longitudinal force (green) - should be strong when accelerating/braking
+        Lines.Emplace(Location, Location + Wheel.WheelForward * Wheel.ActiveLongitudinalForce * 0.001f, FColor::Green, 0.0f, 1.0f, SDPG_World);
+        // Lateral friction force (yellow) - should be strong when turning or sliding sideways
+        Lines.Emplace(Location, Location + Wheel.WheelRight * Wheel.LateralFrictionMagnitude * 0.001f, FColor::Yellow, 0.0f, 1.0f, SDPG_World);
+        // Rolling resistance/drag force (magenta) - should always oppose motion
+        Lines.Emplace(Location, Location + Wheel.WheelForward * Wheel.RollingResistanceMagnitude * 0.001f, FColor::Magenta, 0.0f, 1.0f, SDPG_World);
+    }
+
+    if (ULineBatchComponent* LineBatcher = World->GetLineBatcher(UWorld::ELineBatcherType::World))
+    {
+        LineBatcher->DrawLines(Lines);
+    }
+
+    // --- Steering diagnosis (front-left wheel only), formatted once per drawn frame ---
+    if (GetDebugLevel() >= 2 && GEngine)
+    {
+        const FMVehicleDebugWheel& Wheel = Frame->Wheels[0];
+        // Keep keys per vehicle so several debugged cars do not overwrite each other
+        const uint64 KeyBase = static_cast<uint64>(Vehicle->GetUniqueID()) * 8;
+        GEngine->AddOnScreenDebugMessage(KeyBase + 1, 0.1f, FColor::Orange, FString::Printf(TEXT("%s FL Wheel Lateral Vel: %.2f"), *Vehicle->GetName(), Wheel.LateralVelocity));
+        GEngine->AddOnScreenDebugMessage(KeyBase + 2, 0.1f, FColor::Orange, FString::Printf(TEXT("%s FL Wheel Lat Friction Mag: %.2f"), *Vehicle->GetName(), Wheel.LateralFrictionMagnitude));
+        GEngine->AddOnScreenDebugMessage(KeyBase + 3, 0.1f, FColor::Orange, FString::Printf(TEXT("%s FL Wheel Steer Angle: %.2f"), *Vehicle->GetName(), Frame->SteerAngle));
+        GEngine->AddOnScreenDebugMessage(KeyBase + 4, 0.1f, FColor::Cyan, FString::Printf(TEXT("%s Resting Drag Force: %.2f"), *Vehicle->GetName(), Wheel.RestingDragForceMagnitude));
+        GEngine->AddOnScreenDebugMessage(KeyBase + 5, 0.1f, FColor::Red, FString::Printf(TEXT("%s Brake Hold Force: %.2f"), *Vehicle->GetName(), Wheel.BrakeHoldForce));
+    }
+}
+
+#endif // MP_VEHICLE_DEBUG
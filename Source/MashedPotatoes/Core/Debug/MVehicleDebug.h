@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/StaticArray.h"
+
+// Vehicle debug visualisation is compiled out of Shipping, Test and Server builds
+#define MP_VEHICLE_DEBUG (!(UE_BUILD_SHIPPING || UE_BUILD_TEST || UE_SERVER))
+
+class AMVehicleBase;
+
+// What one wheel did in one step. Recorded as plain numbers so the force path never formats strings or issues lines.
+struct FMVehicleDebugWheel
+{
+    bool bGrounded = false;
+    FVector Location = FVector::ZeroVector;
+    FVector TraceEnd = FVector::ZeroVector;
+    FVector SuspensionForce = FVector::ZeroVector;
+    FVector TireForce = FVector::ZeroVector;
+    FVector WheelForward = FVector::ForwardVector;
+    FVector WheelRight = FVector::RightVector;
+    float LateralVelocity = 0.0f;
+    float ActiveLongitudinalForce = 0.0f;
+    float LateralFrictionMagnitude = 0.0f;
+    float RollingResistanceMagnitude = 0.0f;
+    float RestingDragForceMagnitude = 0.0f;
+    float BrakeHoldForce = 0.0f;
+};
+
+// One step of a vehicle
+struct FMVehicleDebugFrame
+{
+    float SteerAngle = 0.0f;
+    FMVehicleDebugWheel Wheels[4];
+};
+
+#if MP_VEHICLE_DEBUG
+
+// Fixed size history of debug frames, the oldest frame is overwritten once it is full
+class FMVehicleDebugHistory
+{
+public:
+    static constexpr int32 Capacity = 64;
+
+    void Record(const FMVehicleDebugFrame& Frame)
+    {
+        Head = (Head + 1) % Capacity;
+        Frames[Head] = Frame;
+        NumFrames = FMath::Min(NumFrames + 1, Capacity);
+    }
+
+    // Frame recorded AgeInFrames steps ago, 0 being the newest
+    const FMVehicleDebugFrame* GetFrame(int32 AgeInFrames = 0) const
+    {
+        if (AgeInFrames < 0 || AgeInFrames >= NumFrames) return nullptr;
+        return &Frames[(Head - AgeInFrames + Capacity) % Capacity];
+    }
+
+    int32 Num() const { return NumFrames; }
+
+    void Reset()
+    {
+        Head = 0;
+        NumFrames = 0;
+    }
+
+private:
+    TStaticArray<FMVehicleDebugFrame, Capacity> Frames;
+    int32 Head = 0;
+    int32 NumFrames = 0;
+};
+
+namespace MVehicleDebug
+{
+    // mp.Vehicle.Debug: 0 = off, 1 = suspension and force lines, 2 = lines plus on-screen values
+    int32 GetDebugLevel();
+    // Debugging is on and the vehicle passes mp.Vehicle.Debug.Filter
+    bool ShouldDebugVehicle(const AMVehicleBase* Vehicle);
+    // Draws the newest frame as a single batch of lines, and at level 2 prints its front-left wheel values
+    void DrawVehicle(const AMVehicleBase* Vehicle, const FMVehicleDebugHistory& History);
+}
+
+#endif // MP_VEHICLE_DEBUG
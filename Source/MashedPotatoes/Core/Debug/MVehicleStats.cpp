@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MVehicleStats.h"
+
+DEFINE_STAT(STAT_MPVehicleTick);
+DEFINE_STAT(STAT_MPVehicleSuspensionTraces);
+DEFINE_STAT(STAT_MPSuspensionQueryDispatch);
+DEFINE_STAT(STAT_MPVehicleForces);
+DEFINE_STAT(STAT_MPVehicleSimStep);
+DEFINE_STAT(STAT_MPVehicleComponentMoves);
+DEFINE_STAT(STAT_MPVehicleNetResimulate);
+DEFINE_STAT(STAT_MPItems);
+DEFINE_STAT(STAT_MPVehicleSpatialRefresh);
+DEFINE_STAT(STAT_MPRaceProgress);
+DEFINE_STAT(STAT_MPScatterStreaming);
+DEFINE_STAT(STAT_MPBots);
+
+DEFINE_STAT(STAT_MPVehicleCount);
+DEFINE_STAT(STAT_MPVehicleSimulated);
+DEFINE_STAT(STAT_MPVehicleRaycasts);
+DEFINE_STAT(STAT_MPSuspensionRays);
+DEFINE_STAT(STAT_MPVehicleAddForceCalls);
+DEFINE_STAT(STAT_MPVehicleComponentMoveCalls);
+DEFINE_STAT(STAT_MPVehicleNetRollbacks);
+DEFINE_STAT(STAT_MPVehicleNetResimulatedSteps);
+DEFINE_STAT(STAT_MPVehicleNetSnaps);
+DEFINE_STAT(STAT_MPItemProjectiles);
+DEFINE_STAT(STAT_MPItemHazards);
+DEFINE_STAT(STAT_MPVehicleSpatialRebuilds);
+DEFINE_STAT(STAT_MPScatterCells);
+DEFINE_STAT(STAT_MPBotCount);
+
+UE_TRACE_CHANNEL_DEFINE(MPVehicleChannel);
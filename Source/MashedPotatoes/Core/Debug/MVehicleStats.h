@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+// "stat MPVehicle" in game. Cycle stats are inclusive, counters reset every frame.
+DECLARE_STATS_GROUP(TEXT("MP Vehicle"), STATGROUP_MPVehicle, STATCAT_Advanced);
+
+// --- Timers ---
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Vehicle Tick"), STAT_MPVehicleTick, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Suspension Traces (Sync)"), STAT_MPVehicleSuspensionTraces, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+// Game thread cost of requesting the batched traces and copying their results. The traces themselves run on the
+// engine's async trace tasks and are not included, use Insights to see those.
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Suspension Query Dispatch (Batched)"), STAT_MPSuspensionQueryDispatch, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Force Computation"), STAT_MPVehicleForces, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Fixed Step Simulation"), STAT_MPVehicleSimStep, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Wheel Component Moves"), STAT_MPVehicleComponentMoves, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Net Resimulation"), STAT_MPVehicleNetResimulate, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Items"), STAT_MPItems, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Spatial Grid Refresh"), STAT_MPVehicleSpatialRefresh, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Race Progress"), STAT_MPRaceProgress, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Scatter Streaming"), STAT_MPScatterStreaming, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Bot Drivers"), STAT_MPBots, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+
+// --- Counters ---
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Vehicles"), STAT_MPVehicleCount, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Fixed Step Vehicles"), STAT_MPVehicleSimulated, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Suspension Rays (Sync)"), STAT_MPVehicleRaycasts, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Suspension Rays (Batched)"), STAT_MPSuspensionRays, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("AddForce Calls"), STAT_MPVehicleAddForceCalls, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Wheel Component Move Calls"), STAT_MPVehicleComponentMoveCalls, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Net Rollbacks"), STAT_MPVehicleNetRollbacks, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Net Resimulated Steps"), STAT_MPVehicleNetResimulatedSteps, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Net Snaps"), STAT_MPVehicleNetSnaps, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Item Projectiles"), STAT_MPItemProjectiles, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Item Hazards"), STAT_MPItemHazards, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Spatial Grid Rebuilds"), STAT_MPVehicleSpatialRebuilds, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Scatter Cells Loaded"), STAT_MPScatterCells, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Bots"), STAT_MPBotCount, STATGROUP_MPVehicle, MASHEDPOTATOES_API);
+
+// Insights channel for the vehicle scopes, enable with -trace=cpu,MPVehicle.
+// Kept off by default so the per car scopes cost nothing in regular captures.
+UE_TRACE_CHANNEL_EXTERN(MPVehicleChannel, MASHEDPOTATOES_API);
+
+// Named CPU scope that only shows up when MPVehicleChannel is enabled
+#define MP_VEHICLE_TRACE_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Name, MPVehicleChannel)
+// Same with a runtime name, used to tell the cars apart
+#define MP_VEHICLE_TRACE_SCOPE_TEXT(Name) TRACE_CPUPROFILER_EVENT_SCOPE_TEXT_ON_CHANNEL(Name, MPVehicleChannel)
@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MItemReplicator.h"
+#include "Engine/World.h"
+#include "Core/Characters/MVehicleBase.h"
+#include "Core/Items/MItemSubsystem.h"
+
+AMItemReplicator::AMItemReplicator()
+{
+    bReplicates = true;
+    bAlwaysRelevant = true;
+    // Only sends RPCs, there is no state to check for changes
+    SetNetUpdateFrequency(1.0f);
+}
+
+void AMItemReplicator::MulticastItemSpawned_Implementation(EMItemType ItemType, int32 Slot, FVector_NetQuantize10 Location,
+    FVector_NetQuantize10 Velocity, FRotator Rotation, AMVehicleBase* Instigator)
+{
+    // Multicasts also run on the server, which already has the item
+    if (HasAuthority())
+    {
+        return;
+    }
+    if (UMItemSubsystem* ItemSubsystem = GetWorld()->GetSubsystem<UMItemSubsystem>())
+    {
+        ItemSubsystem->MirrorSpawn(ItemType, Slot, Location, Velocity, Rotation.Quaternion(), Instigator);
+    }
+}
+
+void AMItemReplicator::MulticastItemDetonated_Implementation(EMItemType ItemType, int32 Slot, FVector_NetQuantize10 Location,
+    AMVehicleBase* Instigator, AMVehicleBase* DirectHit)
+{
+    if (HasAuthority())
+    {
+        return;
+    }
+    if (UMItemSubsystem* ItemSubsystem = GetWorld()->GetSubsystem<UMItemSubsystem>())
+    {
+        ItemSubsystem->MirrorDetonation(ItemType, Slot, Location, Instigator, DirectHit);
+    }
+}
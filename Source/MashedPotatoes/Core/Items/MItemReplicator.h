@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "Core/Items/MItemSettings.h"
+#include "MItemReplicator.generated.h"
+
+class AMVehicleBase;
+
+// Carries UMItemSubsystem's events from the server to clients. Items only exist on the server; clients mirror them
+// into the same pool slots so the events line up, and never spawn, hit or detonate anything themselves.
+// Spawned by the server's item subsystem, one per world.
+UCLASS(NotPlaceable, Transient)
+class MASHEDPOTATOES_API AMItemReplicator : public AInfo
+{
+    GENERATED_BODY()
+
+public:
+    AMItemReplicator();
+
+    // Velocity is only used by projectiles, Rotation only by hazards
+    UFUNCTION(NetMulticast, Reliable)
+    void MulticastItemSpawned(EMItemType ItemType, int32 Slot, FVector_NetQuantize10 Location, FVector_NetQuantize10 Velocity,
+        FRotator Rotation, AMVehicleBase* Instigator);
+
+    UFUNCTION(NetMulticast, Reliable)
+    void MulticastItemDetonated(EMItemType ItemType, int32 Slot, FVector_NetQuantize10 Location, AMVehicleBase* Instigator,
+        AMVehicleBase* DirectHit);
+};
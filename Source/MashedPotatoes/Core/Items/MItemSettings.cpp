@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MItemSettings.h"
+#include "Engine/StaticMesh.h"
+
+UMItemSettings::UMItemSettings()
+{
+    Missile.Mesh = TSoftObjectPtr<UStaticMesh>(FSoftObjectPath(TEXT("/Game/Blueprints/Items/sm_rocket.sm_rocket")));
+    Missile.Lifetime = 5.0f;
+    Missile.TriggerRadius = 120.0f;
+
+    HomingMissile = Missile;
+    HomingMissile.Lifetime = 8.0f;
+
+    Mine.Mesh = TSoftObjectPtr<UStaticMesh>(FSoftObjectPath(TEXT("/Game/Blueprints/Items/sm_mine.sm_mine")));
+    Mine.Lifetime = 60.0f;
+    Mine.TriggerRadius = 250.0f;
+    Mine.ExplosionImpulse = 2000.0f;
+
+    // Oil has no mesh by default, Blueprints can draw it from OnItemSpawned
+    Oil.Lifetime = 20.0f;
+    Oil.TriggerRadius = 400.0f;
+    Oil.ExplosionRadius = 0.0f;
+    Oil.ExplosionImpulse = 0.0f;
+}
+
+const FMItemTypeSettings& UMItemSettings::GetTypeSettings(EMItemType Type) const
+{
+    switch (Type)
+    {
+    case EMItemType::HomingMissile: return HomingMissile;
+    case EMItemType::Mine: return Mine;
+    case EMItemType::Oil: return Oil;
+    default: return Missile;
+    }
+}
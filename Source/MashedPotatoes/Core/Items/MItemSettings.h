@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "MItemSettings.generated.h"
+
+class UStaticMesh;
+
+UENUM(BlueprintType)
+enum class EMItemType : uint8
+{
+    Missile,
+    HomingMissile,
+    Mine,
+    Oil,
+};
+
+// Tuning shared by every item type
+USTRUCT(BlueprintType)
+struct FMItemTypeSettings
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, Category = "Item")
+    TSoftObjectPtr<UStaticMesh> Mesh;
+    UPROPERTY(EditAnywhere, Category = "Item")
+    FVector MeshScale = FVector::OneVector;
+    UPROPERTY(EditAnywhere, Category = "Item", meta = (ClampMin = "0.0"))
+    // Seconds before the item disappears on its own
+    float Lifetime = 10.0f;
+    UPROPERTY(EditAnywhere, Category = "Item", meta = (ClampMin = "0.0"))
+    // How close a car has to get to set it off (projectiles, mines) or to be affected (oil)
+    float TriggerRadius = 150.0f;
+    UPROPERTY(EditAnywhere, Category = "Item", meta = (ClampMin = "0.0"))
+    // Cars within this distance of the explosion are thrown, 0 for items that do not explode
+    float ExplosionRadius = 600.0f;
+    UPROPERTY(EditAnywhere, Category = "Item", meta = (ClampMin = "0.0"))
+    // Velocity change in cm/s at the centre of the explosion, falling off linearly to the radius
+    float ExplosionImpulse = 1500.0f;
+};
+
+// Project Settings > Game > Items
+UCLASS(Config = Game, DefaultConfig, meta = (DisplayName = "Items"))
+class MASHEDPOTATOES_API UMItemSettings : public UDeveloperSettings
+{
+    GENERATED_BODY()
+
+public:
+    UMItemSettings();
+
+    virtual FName GetCategoryName() const override { return TEXT("Game"); }
+
+    const FMItemTypeSettings& GetTypeSettings(EMItemType Type) const;
+
+    // --- Pools, allocated once per world ---
+    UPROPERTY(Config, EditAnywhere, Category = "Pools", meta = (ClampMin = "1"))
+    int32 MaxProjectiles = 64;
+    UPROPERTY(Config, EditAnywhere, Category = "Pools", meta = (ClampMin = "1"))
+    // Once full, the oldest mine or oil slick is recycled
+    int32 MaxHazards = 64;
+
+    UPROPERTY(Config, EditAnywhere, Category = "Items")
+    FMItemTypeSettings Missile;
+    UPROPERTY(Config, EditAnywhere, Category = "Items")
+    FMItemTypeSettings HomingMissile;
+    UPROPERTY(Config, EditAnywhere, Category = "Items")
+    FMItemTypeSettings Mine;
+    UPROPERTY(Config, EditAnywhere, Category = "Items")
+    FMItemTypeSettings Oil;
+
+    UPROPERTY(Config, EditAnywhere, Category = "Projectiles")
+    // cm/s on top of the firing car's velocity
+    float ProjectileSpeed = 6000.0f;
+    UPROPERTY(Config, EditAnywhere, Category = "Projectiles")
+    // How far in front of the car projectiles appear
+    float LaunchOffset = 350.0f;
+    UPROPERTY(Config, EditAnywhere, Category = "Projectiles")
+    // Degrees per second a homing missile can turn
+    float HomingTurnRate = 120.0f;
+    UPROPERTY(Config, EditAnywhere, Category = "Projectiles")
+    // Homing missiles only pick cars within this distance...
+    float HomingRange = 8000.0f;
+    UPROPERTY(Config, EditAnywhere, Category = "Projectiles", meta = (ClampMin = "0.0", ClampMax = "180.0"))
+    // ...and within this many degrees of their heading
+    float HomingConeAngle = 60.0f;
+
+    UPROPERTY(Config, EditAnywhere, Category = "Hazards")
+    // How far behind the car mines and oil are dropped
+    float DropOffset = 350.0f;
+    UPROPERTY(Config, EditAnywhere, Category = "Hazards")
+    // Seconds before a mine can go off, so it does not hit the car that dropped it
+    float MineArmTime = 1.0f;
+    UPROPERTY(Config, EditAnywhere, Category = "Hazards", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+    // Lateral grip of a car driving through oil
+    float OilGripScale = 0.2f;
+};
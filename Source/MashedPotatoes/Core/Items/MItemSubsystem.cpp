@@ -0,0 +1,643 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MItemSubsystem.h"
+#include "Engine/World.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Core/Characters/MVehicleBase.h"
+#include "Core/Debug/MVehicleStats.h"
+#include "Core/Items/MItemReplicator.h"
+#include "Core/Spatial/MVehicleSpatialSubsystem.h"
+
+namespace MItemSubsystem
+{
+    constexpr int32 NumItemTypes = static_cast<int32>(EMItemType::Oil) + 1;
+    // Projectiles ignore the car that fired them for this long
+    constexpr float InstigatorGraceTime = 0.5f;
+    // How far below a dropped hazard the ground is searched for
+    constexpr float DropTraceLength = 500.0f;
+    // Inactive instances are scaled to nothing rather than removed, so instance indices match pool slots
+    const FTransform HiddenTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector);
+
+    bool IsProjectile(EMItemType Type)
+    {
+        return Type == EMItemType::Missile || Type == EMItemType::HomingMissile;
+    }
+}
+
+void UMItemSubsystem::Deinitialize()
+{
+    Projectiles.Reset();
+    FreeProjectiles.Reset();
+    Hazards.Reset();
+    FreeHazards.Reset();
+    HazardOrder.Reset();
+    GripScales.Reset();
+    VehicleQueries = nullptr;
+    Replicator = nullptr;
+    ItemMeshes.Reset();
+    InstanceTransforms.Reset();
+    InstancesDirty.Reset();
+    VisualsActor = nullptr;
+    bPoolsAllocated = false;
+
+    Super::Deinitialize();
+}
+
+void UMItemSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+    Super::OnWorldBeginPlay(InWorld);
+
+    VehicleQueries = InWorld.GetSubsystem<UMVehicleSpatialSubsystem>();
+    AllocatePools();
+    CreateVisuals();
+
+    const ENetMode NetMode = InWorld.GetNetMode();
+    if (NetMode == NM_ListenServer || NetMode == NM_DedicatedServer)
+    {
+        Replicator = InWorld.SpawnActor<AMItemReplicator>();
+    }
+}
+
+bool UMItemSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+    return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UMItemSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UMItemSubsystem, STATGROUP_Tickables);
+}
+
+void UMItemSubsystem::AllocatePools()
+{
+    const UMItemSettings* Settings = GetDefault<UMItemSettings>();
+
+    Projectiles.SetNum(Settings->MaxProjectiles);
+    FreeProjectiles.Reset(Projectiles.Num());
+    // Popped from the back, so slot 0 is used first
+    for (int32 ProjectileIndex = Projectiles.Num() - 1; ProjectileIndex >= 0; ProjectileIndex--)
+    {
+        FreeProjectiles.Add(ProjectileIndex);
+    }
+
+    Hazards.SetNum(Settings->MaxHazards);
+    FreeHazards.Reset(Hazards.Num());
+    for (int32 HazardIndex = Hazards.Num() - 1; HazardIndex >= 0; HazardIndex--)
+    {
+        FreeHazards.Add(HazardIndex);
+    }
+    HazardOrder.Reset(Hazards.Num());
+
+    bPoolsAllocated = true;
+}
+
+void UMItemSubsystem::CreateVisuals()
+{
+    InstanceTransforms.SetNum(MItemSubsystem::NumItemTypes);
+    InstancesDirty.Init(false, MItemSubsystem::NumItemTypes);
+    ItemMeshes.Init(nullptr, MItemSubsystem::NumItemTypes);
+
+    UWorld* World = GetWorld();
+    if (World->GetNetMode() == NM_DedicatedServer)
+    {
+        return;
+    }
+
+    FActorSpawnParameters SpawnParams;
+    SpawnParams.ObjectFlags |= RF_Transient;
+    VisualsActor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+    if (VisualsActor == nullptr)
+    {
+        return;
+    }
+    USceneComponent* Root = NewObject<USceneComponent>(VisualsActor, TEXT("Root"));
+    VisualsActor->SetRootComponent(Root);
+    Root->RegisterComponent();
+
+    const UMItemSettings* Settings = GetDefault<UMItemSettings>();
+    for (int32 TypeIndex = 0; TypeIndex < MItemSubsystem::NumItemTypes; TypeIndex++)
+    {
+        const EMItemType Type = static_cast<EMItemType>(TypeIndex);
+        const int32 NumInstances = MItemSubsystem::IsProjectile(Type) ? Projectiles.Num() : Hazards.Num();
+        InstanceTransforms[TypeIndex].Init(MItemSubsystem::HiddenTransform, NumInstances);
+
+        UStaticMesh* Mesh = Settings->GetTypeSettings(Type).Mesh.LoadSynchronous();
+        if (Mesh == nullptr)
+        {
+            continue;
+        }
+
+        UInstancedStaticMeshComponent* ItemMesh = NewObject<UInstancedStaticMeshComponent>(VisualsActor);
+        ItemMesh->SetStaticMesh(Mesh);
+        ItemMesh->SetMobility(EComponentMobility::Movable);
+        ItemMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+        ItemMesh->SetupAttachment(Root);
+        ItemMesh->RegisterComponent();
+        ItemMesh->AddInstances(InstanceTransforms[TypeIndex], false);
+        ItemMeshes[TypeIndex] = ItemMesh;
+    }
+}
+
+bool UMItemSubsystem::HasItemAuthority() const
+{
+    return GetWorld()->GetNetMode() != NM_Client;
+}
+
+// --- Using Items ---
+
+bool UMItemSubsystem::UseItem(AMVehicleBase* Instigator, EMItemType ItemType)
+{
+    if (!bPoolsAllocated || Instigator == nullptr)
+    {
+        return false;
+    }
+    if (!HasItemAuthority())
+    {
+        if (!Instigator->IsLocallyControlled())
+        {
+            return false;
+        }
+        Instigator->ServerUseItem(ItemType);
+        return true;
+    }
+
+    if (MItemSubsystem::IsProjectile(ItemType))
+    {
+        if (FreeProjectiles.Num() == 0)
+        {
+            return false;
+        }
+        FireProjectile(Instigator, ItemType);
+    }
+    else
+    {
+        DropHazard(Instigator, ItemType);
+    }
+    return true;
+}
+
+void UMItemSubsystem::FireProjectile(AMVehicleBase* Instigator, EMItemType ItemType)
+{
+    const UMItemSettings* Settings = GetDefault<UMItemSettings>();
+    const FVector Forward = Instigator->GetActorForwardVector();
+
+    const int32 ProjectileIndex = FreeProjectiles.Pop(EAllowShrinking::No);
+    const FVector Location = Instigator->GetActorLocation() + Forward * Settings->LaunchOffset;
+    const FVector Velocity = Forward * Settings->ProjectileSpeed + Instigator->GetVelocity();
+    StartProjectile(ProjectileIndex, ItemType, Location, Velocity, Instigator);
+
+    if (Replicator)
+    {
+        Replicator->MulticastItemSpawned(ItemType, ProjectileIndex, Location, Velocity, FRotator::ZeroRotator, Instigator);
+    }
+}
+
+void UMItemSubsystem::StartProjectile(int32 ProjectileIndex, EMItemType ItemType, const FVector& Location, const FVector& Velocity, AMVehicleBase* Instigator)
+{
+    FProjectile& Projectile = Projectiles[ProjectileIndex];
+    Projectile = FProjectile();
+    Projectile.bActive = true;
+    Projectile.Type = ItemType;
+    Projectile.Location = Location;
+    Projectile.PreviousLocation = Location;
+    Projectile.Velocity = Velocity;
+    Projectile.Instigator = Instigator;
+
+    OnItemSpawned.Broadcast(ItemType, Location, Instigator, nullptr);
+}
+
+void UMItemSubsystem::DropHazard(AMVehicleBase* Instigator, EMItemType ItemType)
+{
+    const UMItemSettings* Settings = GetDefault<UMItemSettings>();
+
+    // A full pool recycles the oldest hazard on the track
+    if (FreeHazards.Num() == 0)
+    {
+        ReleaseHazard(HazardOrder[0]);
+    }
+
+    FVector Location = Instigator->GetActorLocation() - Instigator->GetActorForwardVector() * Settings->DropOffset;
+    FQuat Rotation = Instigator->GetActorQuat();
+
+    // Lay it on the ground under the drop point
+    FHitResult Hit;
+    const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(MPItemDrop), false, Instigator);
+    if (GetWorld()->LineTraceSingleByObjectType(Hit, Location, Location - FVector::UpVector * MItemSubsystem::DropTraceLength,
+        FCollisionObjectQueryParams(ECC_WorldStatic), QueryParams))
+    {
+        Location = Hit.ImpactPoint;
+        Rotation = FQuat::FindBetweenNormals(FVector::UpVector, Hit.ImpactNormal) * FQuat(FVector::UpVector, FMath::DegreesToRadians(Instigator->GetActorRotation().Yaw));
+    }
+
+    const int32 HazardIndex = FreeHazards.Pop(EAllowShrinking::No);
+    StartHazard(HazardIndex, ItemType, Location, Rotation, Instigator);
+
+    if (Replicator)
+    {
+        Replicator->MulticastItemSpawned(ItemType, HazardIndex, Location, FVector::ZeroVector, Rotation.Rotator(), Instigator);
+    }
+}
+
+void UMItemSubsystem::StartHazard(int32 HazardIndex, EMItemType ItemType, const FVector& Location, const FQuat& Rotation, AMVehicleBase* Instigator)
+{
+    const UMItemSettings* Settings = GetDefault<UMItemSettings>();
+
+    FHazard& Hazard = Hazards[HazardIndex];
+    Hazard = FHazard();
+    Hazard.bActive = true;
+    Hazard.Type = ItemType;
+    Hazard.Location = Location;
+    Hazard.Rotation = Rotation;
+    Hazard.Instigator = Instigator;
+    HazardOrder.Add(HazardIndex);
+
+    const FMItemTypeSettings& TypeSettings = Settings->GetTypeSettings(ItemType);
+    InstanceTransforms[static_cast<int32>(ItemType)][HazardIndex] = FTransform(Rotation, Location, TypeSettings.MeshScale);
+    InstancesDirty[static_cast<int32>(ItemType)] = true;
+
+    OnItemSpawned.Broadcast(ItemType, Location, Instigator, nullptr);
+}
+
+void UMItemSubsystem::ReleaseProjectile(int32 ProjectileIndex)
+{
+    FProjectile& Projectile = Projectiles[ProjectileIndex];
+    if (!Projectile.bActive)
+    {
+        return;
+    }
+    Projectile.bActive = false;
+    Projectile.Trace.Invalidate();
+    InstanceTransforms[static_cast<int32>(Projectile.Type)][ProjectileIndex] = MItemSubsystem::HiddenTransform;
+    InstancesDirty[static_cast<int32>(Projectile.Type)] = true;
+    FreeProjectiles.Add(ProjectileIndex);
+}
+
+void UMItemSubsystem::ReleaseHazard(int32 HazardIndex)
+{
+    FHazard& Hazard = Hazards[HazardIndex];
+    if (!Hazard.bActive)
+    {
+        return;
+    }
+    Hazard.bActive = false;
+    InstanceTransforms[static_cast<int32>(Hazard.Type)][HazardIndex] = MItemSubsystem::HiddenTransform;
+    InstancesDirty[static_cast<int32>(Hazard.Type)] = true;
+    HazardOrder.RemoveSingle(HazardIndex);
+    FreeHazards.Add(HazardIndex);
+}
+
+// --- Per Frame ---
+
+void UMItemSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    if (!bPoolsAllocated || VehicleQueries == nullptr)
+    {
+        return;
+    }
+
+    const int32 NumActiveProjectiles = Projectiles.Num() - FreeProjectiles.Num();
+    SET_DWORD_STAT(STAT_MPItemProjectiles, NumActiveProjectiles);
+    SET_DWORD_STAT(STAT_MPItemHazards, HazardOrder.Num());
+    if (NumActiveProjectiles == 0 && HazardOrder.Num() == 0 && !bGripModified)
+    {
+        UpdateVisuals();
+        return;
+    }
+
+    SCOPE_CYCLE_COUNTER(STAT_MPItems);
+    MP_VEHICLE_TRACE_SCOPE(MPItems_Tick);
+
+    VehicleQueries->Refresh();
+    ResolveProjectileTraces();
+    SelectHomingTargets();
+    MoveProjectiles(DeltaTime);
+    UpdateHazards(DeltaTime);
+    // Walls only matter where hits are decided
+    if (HasItemAuthority())
+    {
+        IssueProjectileTraces();
+    }
+    UpdateVisuals();
+}
+
+void UMItemSubsystem::ResolveProjectileTraces()
+{
+    UWorld* World = GetWorld();
+    FTraceDatum TraceDatum;
+    for (int32 ProjectileIndex = 0; ProjectileIndex < Projectiles.Num(); ProjectileIndex++)
+    {
+        FProjectile& Projectile = Projectiles[ProjectileIndex];
+        if (!Projectile.bActive || !Projectile.Trace.IsValid())
+        {
+            continue;
+        }
+
+        const bool bHasData = World->QueryTraceData(Projectile.Trace, TraceDatum);
+        Projectile.Trace.Invalidate();
+        if (!bHasData)
+        {
+            continue;
+        }
+
+        if (const FHitResult* Hit = FHitResult::GetFirstBlockingHit(TraceDatum.OutHits))
+        {
+            DetonateProjectile(ProjectileIndex, Hit->ImpactPoint, nullptr);
+        }
+    }
+}
+
+void UMItemSubsystem::SelectHomingTargets()
+{
+    const UMItemSettings* Settings = GetDefault<UMItemSettings>();
+    const float MinConeDot = FMath::Cos(FMath::DegreesToRadians(Settings->HomingConeAngle));
+
+    for (FProjectile& Projectile : Projectiles)
+    {
+        if (!Projectile.bActive || Projectile.Type != EMItemType::HomingMissile || Projectile.Target.IsValid())
+        {
+            continue;
+        }
+
+        const FVector Heading = Projectile.Velocity.GetSafeNormal();
+        const AMVehicleBase* Instigator = Projectile.Instigator.Get();
+        const FMVehicleSpatialGrid::FEntry* Nearest = VehicleQueries->GetGrid().FindNearest(Projectile.Location, Settings->HomingRange,
+            [this, &Projectile, &Heading, Instigator, MinConeDot](const FMVehicleSpatialGrid::FEntry& Entry)
+            {
+                const AMVehicleBase* Vehicle = VehicleQueries->GetVehicle(Entry.Id);
+                return Vehicle && Vehicle != Instigator &&
+                    FVector::DotProduct((Entry.Location - Projectile.Location).GetSafeNormal(), Heading) >= MinConeDot;
+            });
+        if (Nearest)
+        {
+            Projectile.Target = VehicleQueries->GetVehicle(Nearest->Id);
+        }
+    }
+}
+
+void UMItemSubsystem::MoveProjectiles(float DeltaTime)
+{
+    const UMItemSettings* Settings = GetDefault<UMItemSettings>();
+    const bool bAuthority = HasItemAuthority();
+
+    for (int32 ProjectileIndex = 0; ProjectileIndex < Projectiles.Num(); ProjectileIndex++)
+    {
+        FProjectile& Projectile = Projectiles[ProjectileIndex];
+        if (!Projectile.bActive)
+        {
+            continue;
+        }
+
+        const FMItemTypeSettings& TypeSettings = Settings->GetTypeSettings(Projectile.Type);
+        Projectile.Age += DeltaTime;
+        if (Projectile.Age > TypeSettings.Lifetime)
+        {
+            // Clients hide it and wait for the server's detonation
+            if (bAuthority)
+            {
+                DetonateProjectile(ProjectileIndex, Projectile.Location, nullptr);
+            }
+            else
+            {
+                ReleaseProjectile(ProjectileIndex);
+            }
+            continue;
+        }
+
+        // Turn towards the target at a limited rate, keeping the speed
+        if (const AMVehicleBase* Target = Projectile.Target.Get())
+        {
+            const float Speed = Projectile.Velocity.Size();
+            const FVector Heading = FMath::VInterpNormalRotationTo(Projectile.Velocity.GetSafeNormal(),
+                (Target->GetActorLocation() - Projectile.Location).GetSafeNormal(), DeltaTime, Settings->HomingTurnRate);
+            Projectile.Velocity = Heading * Speed;
+        }
+
+        Projectile.PreviousLocation = Projectile.Location;
+        Projectile.Location += Projectile.Velocity * DeltaTime;
+
+        // The closest car in reach takes the hit, as decided by the server
+        if (bAuthority)
+        {
+            const AMVehicleBase* Instigator = Projectile.Age < MItemSubsystem::InstigatorGraceTime ? Projectile.Instigator.Get() : nullptr;
+            AMVehicleBase* HitVehicle = nullptr;
+            float HitDistanceSquared = MAX_flt;
+            VehicleQueries->ForEachVehicleInRadius(Projectile.Location, TypeSettings.TriggerRadius,
+                [Instigator, &HitVehicle, &HitDistanceSquared](AMVehicleBase* Vehicle, const FMVehicleSpatialGrid::FEntry& Entry, float DistanceSquared)
+                {
+                    if (Vehicle != Instigator && DistanceSquared < HitDistanceSquared)
+                    {
+                        HitVehicle = Vehicle;
+                        HitDistanceSquared = DistanceSquared;
+                    }
+                });
+            if (HitVehicle)
+            {
+                DetonateProjectile(ProjectileIndex, Projectile.Location, HitVehicle);
+                continue;
+            }
+        }
+
+        InstanceTransforms[static_cast<int32>(Projectile.Type)][ProjectileIndex] =
+            FTransform(Projectile.Velocity.ToOrientationQuat(), Projectile.Location, TypeSettings.MeshScale);
+        InstancesDirty[static_cast<int32>(Projectile.Type)] = true;
+    }
+}
+
+void UMItemSubsystem::UpdateHazards(float DeltaTime)
+{
+    const UMItemSettings* Settings = GetDefault<UMItemSettings>();
+    const bool bAuthority = HasItemAuthority();
+    GripScales.Init(1.0f, VehicleQueries->GetMaxVehicles());
+
+    // Backwards, hazards that go off leave HazardOrder
+    for (int32 OrderIndex = HazardOrder.Num() - 1; OrderIndex >= 0; OrderIndex--)
+    {
+        const int32 HazardIndex = HazardOrder[OrderIndex];
+        FHazard& Hazard = Hazards[HazardIndex];
+        const FMItemTypeSettings& TypeSettings = Settings->GetTypeSettings(Hazard.Type);
+
+        Hazard.Age += DeltaTime;
+        if (Hazard.Age > TypeSettings.Lifetime)
+        {
+            ReleaseHazard(HazardIndex);
+            continue;
+        }
+
+        if (Hazard.Type == EMItemType::Oil)
+        {
+            VehicleQueries->ForEachVehicleInRadius(Hazard.Location, TypeSettings.TriggerRadius,
+                [this, Settings](AMVehicleBase* Vehicle, const FMVehicleSpatialGrid::FEntry& Entry, float DistanceSquared)
+                {
+                    GripScales[Entry.Id] = FMath::Min(GripScales[Entry.Id], Settings->OilGripScale);
+                });
+        }
+        else if (bAuthority && Hazard.Age >= Settings->MineArmTime)
+        {
+            AMVehicleBase* Trigger = VehicleQueries->FindNearestVehicle(Hazard.Location, TypeSettings.TriggerRadius);
+            if (Trigger)
+            {
+                const FVector Location = Hazard.Location;
+                AMVehicleBase* Instigator = Hazard.Instigator.Get();
+                ReleaseHazard(HazardIndex);
+                Explode(EMItemType::Mine, HazardIndex, Location, Instigator, Trigger);
+            }
+        }
+    }
+
+    bGripModified = false;
+    for (int32 Id = 0; Id < GripScales.Num(); Id++)
+    {
+        if (AMVehicleBase* Vehicle = VehicleQueries->GetVehicle(Id))
+        {
+            Vehicle->SetGripScale(GripScales[Id]);
+            bGripModified |= GripScales[Id] != 1.0f;
+        }
+    }
+}
+
+void UMItemSubsystem::IssueProjectileTraces()
+{
+    UWorld* World = GetWorld();
+    const FCollisionObjectQueryParams ObjectParams(ECC_WorldStatic);
+    for (FProjectile& Projectile : Projectiles)
+    {
+        if (!Projectile.bActive)
+        {
+            continue;
+        }
+
+        // Cars are found through the grid, the world sweep only has to find walls and the ground
+        const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(MPItemProjectile), false, Projectile.Instigator.Get());
+        Projectile.Trace = World->AsyncLineTraceByObjectType(EAsyncTraceType::Single, Projectile.PreviousLocation, Projectile.Location,
+            ObjectParams, QueryParams);
+    }
+}
+
+void UMItemSubsystem::UpdateVisuals()
+{
+    for (int32 TypeIndex = 0; TypeIndex < ItemMeshes.Num(); TypeIndex++)
+    {
+        if (!InstancesDirty[TypeIndex])
+        {
+            continue;
+        }
+        InstancesDirty[TypeIndex] = false;
+
+        if (UInstancedStaticMeshComponent* ItemMesh = ItemMeshes[TypeIndex])
+        {
+            ItemMesh->BatchUpdateInstancesTransforms(0, InstanceTransforms[TypeIndex], true, true);
+        }
+    }
+}
+
+// --- Detonation ---
+
+void UMItemSubsystem::DetonateProjectile(int32 ProjectileIndex, const FVector& Location, AMVehicleBase* DirectHit)
+{
+    const EMItemType Type = Projectiles[ProjectileIndex].Type;
+    AMVehicleBase* Instigator = Projectiles[ProjectileIndex].Instigator.Get();
+    ReleaseProjectile(ProjectileIndex);
+    Explode(Type, ProjectileIndex, Location, Instigator, DirectHit);
+}
+
+void UMItemSubsystem::Explode(EMItemType ItemType, int32 Slot, const FVector& Location, AMVehicleBase* Instigator, AMVehicleBase* DirectHit)
+{
+    const FMItemTypeSettings& TypeSettings = GetDefault<UMItemSettings>()->GetTypeSettings(ItemType);
+    const bool bAuthority = HasItemAuthority();
+    if (Replicator)
+    {
+        Replicator->MulticastItemDetonated(ItemType, Slot, Location, Instigator, DirectHit);
+    }
+
+    // Gathered first, the events may fire more items
+    TArray<AMVehicleBase*, TInlineAllocator<16>> Victims;
+    if (TypeSettings.ExplosionRadius > 0.0f)
+    {
+        VehicleQueries->ForEachVehicleInRadius(Location, TypeSettings.ExplosionRadius,
+            [&Victims](AMVehicleBase* Vehicle, const FMVehicleSpatialGrid::FEntry& Entry, float DistanceSquared)
+            {
+                Victims.Add(Vehicle);
+            });
+    }
+    if (DirectHit)
+    {
+        Victims.AddUnique(DirectHit);
+    }
+
+    // Cars are server authoritative, a client pushing one would only be corrected straight back
+    for (AMVehicleBase* Victim : Victims)
+    {
+        if (bAuthority && Victim->BodyMeshC && Victim->BodyMeshC->IsSimulatingPhysics())
+        {
+            Victim->BodyMeshC->AddRadialImpulse(Location, FMath::Max(TypeSettings.ExplosionRadius, 1.0f), TypeSettings.ExplosionImpulse, RIF_Linear, true);
+        }
+    }
+
+    OnItemDetonated.Broadcast(ItemType, Location, Instigator, DirectHit);
+    for (AMVehicleBase* Victim : Victims)
+    {
+        if (Victim != DirectHit)
+        {
+            OnItemDetonated.Broadcast(ItemType, Location, Instigator, Victim);
+        }
+    }
+}
+
+// --- Client Mirror ---
+
+void UMItemSubsystem::MirrorSpawn(EMItemType ItemType, int32 Slot, const FVector& Location, const FVector& Velocity, const FQuat& Rotation, AMVehicleBase* Instigator)
+{
+    if (!bPoolsAllocated)
+    {
+        return;
+    }
+
+    // Same slot as on the server. Whatever the client still shows there has already ended on the server.
+    if (MItemSubsystem::IsProjectile(ItemType))
+    {
+        if (!Projectiles.IsValidIndex(Slot))
+        {
+            return;
+        }
+        ReleaseProjectile(Slot);
+        FreeProjectiles.RemoveSingleSwap(Slot, EAllowShrinking::No);
+        StartProjectile(Slot, ItemType, Location, Velocity, Instigator);
+    }
+    else
+    {
+        if (!Hazards.IsValidIndex(Slot))
+        {
+            return;
+        }
+        ReleaseHazard(Slot);
+        FreeHazards.RemoveSingleSwap(Slot, EAllowShrinking::No);
+        StartHazard(Slot, ItemType, Location, Rotation, Instigator);
+    }
+}
+
+void UMItemSubsystem::MirrorDetonation(EMItemType ItemType, int32 Slot, const FVector& Location, AMVehicleBase* Instigator, AMVehicleBase* DirectHit)
+{
+    if (!bPoolsAllocated || VehicleQueries == nullptr)
+    {
+        return;
+    }
+
+    if (MItemSubsystem::IsProjectile(ItemType))
+    {
+        if (Projectiles.IsValidIndex(Slot))
+        {
+            ReleaseProjectile(Slot);
+        }
+    }
+    else if (Hazards.IsValidIndex(Slot))
+    {
+        ReleaseHazard(Slot);
+    }
+    VehicleQueries->Refresh();
+    Explode(ItemType, Slot, Location, Instigator, DirectHit);
+}
@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "Core/Items/MItemSettings.h"
+#include "MItemSubsystem.generated.h"
+
+class AMItemReplicator;
+class AMVehicleBase;
+class UInstancedStaticMeshComponent;
+class UMVehicleSpatialSubsystem;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(FMItemEventSignature, EMItemType, ItemType, FVector, Location, AMVehicleBase*, Instigator, AMVehicleBase*, Victim);
+
+// Missiles, homing missiles, mines and oil slicks without actors. Every item lives in a slot of a pool that is
+// allocated when the world begins play, all projectiles are moved and swept in one pass per frame and drawn as
+// instances of one mesh component per item type. Gameplay reacts through the events (sounds, particles, score).
+//
+// Items are server authoritative: only the server spawns, hits and detonates them and pushes cars around.
+// AMItemReplicator mirrors every spawn and detonation into the same pool slot on clients, which move the projectiles,
+// apply oil to their own predicted car and fire the same events, but never decide a hit.
+UCLASS()
+class MASHEDPOTATOES_API UMItemSubsystem : public UTickableWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    // USubsystem
+    virtual void Deinitialize() override;
+    // UWorldSubsystem
+    virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+    // FTickableGameObject
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+
+    // Fires or drops an item from the car. False if the pool is out of projectiles. On a client the request is sent
+    // to the server through the car (only for the client's own car) and the item shows up once it is replicated.
+    UFUNCTION(BlueprintCallable, Category = "Items")
+    bool UseItem(AMVehicleBase* Instigator, EMItemType ItemType);
+
+    // An item came into play
+    UPROPERTY(BlueprintAssignable, Category = "Items")
+    FMItemEventSignature OnItemSpawned;
+    // An item went off: once with the car it hit (null for a wall or running out of time), then once more for every
+    // other car caught in the blast
+    UPROPERTY(BlueprintAssignable, Category = "Items")
+    FMItemEventSignature OnItemDetonated;
+
+protected:
+    virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+    friend class AMItemReplicator;
+
+    struct FProjectile
+    {
+        bool bActive = false;
+        EMItemType Type = EMItemType::Missile;
+        FVector Location = FVector::ZeroVector;
+        FVector Velocity = FVector::ZeroVector;
+        // Where the last move started, swept against the world
+        FVector PreviousLocation = FVector::ZeroVector;
+        float Age = 0.0f;
+        TWeakObjectPtr<AMVehicleBase> Instigator;
+        // Homing missiles only, refreshed in the batched target pass when lost
+        TWeakObjectPtr<AMVehicleBase> Target;
+        // World sweep of the last move, resolved next frame
+        FTraceHandle Trace;
+    };
+
+    struct FHazard
+    {
+        bool bActive = false;
+        EMItemType Type = EMItemType::Mine;
+        FVector Location = FVector::ZeroVector;
+        FQuat Rotation = FQuat::Identity;
+        float Age = 0.0f;
+        TWeakObjectPtr<AMVehicleBase> Instigator;
+    };
+
+    void AllocatePools();
+    void CreateVisuals();
+    void ResolveProjectileTraces();
+    void SelectHomingTargets();
+    void MoveProjectiles(float DeltaTime);
+    void UpdateHazards(float DeltaTime);
+    void IssueProjectileTraces();
+    void UpdateVisuals();
+
+    // Spawns, hits and detonations are decided here, clients only mirror them
+    bool HasItemAuthority() const;
+    void FireProjectile(AMVehicleBase* Instigator, EMItemType ItemType);
+    void DropHazard(AMVehicleBase* Instigator, EMItemType ItemType);
+    // Fills a slot already taken off the free list, shared by the server and the mirrored spawns
+    void StartProjectile(int32 ProjectileIndex, EMItemType ItemType, const FVector& Location, const FVector& Velocity, AMVehicleBase* Instigator);
+    void StartHazard(int32 HazardIndex, EMItemType ItemType, const FVector& Location, const FQuat& Rotation, AMVehicleBase* Instigator);
+    void DetonateProjectile(int32 ProjectileIndex, const FVector& Location, AMVehicleBase* DirectHit);
+    // Throws every car within the type's explosion radius (server only) and fires the events. Slot is the pool slot
+    // the item was in, for the clients' mirror.
+    void Explode(EMItemType ItemType, int32 Slot, const FVector& Location, AMVehicleBase* Instigator, AMVehicleBase* DirectHit);
+    // Clients: AMItemReplicator's events
+    void MirrorSpawn(EMItemType ItemType, int32 Slot, const FVector& Location, const FVector& Velocity, const FQuat& Rotation, AMVehicleBase* Instigator);
+    void MirrorDetonation(EMItemType ItemType, int32 Slot, const FVector& Location, AMVehicleBase* Instigator, AMVehicleBase* DirectHit);
+    void ReleaseProjectile(int32 ProjectileIndex);
+    void ReleaseHazard(int32 HazardIndex);
+
+    bool bPoolsAllocated = false;
+    TArray<FProjectile> Projectiles;
+    TArray<int32> FreeProjectiles;
+    TArray<FHazard> Hazards;
+    TArray<int32> FreeHazards;
+    // Active hazards oldest first, recycled from the front when the pool runs out
+    TArray<int32> HazardOrder;
+
+    // Server: sends the events to clients, null in standalone games
+    UPROPERTY()
+    TObjectPtr<AMItemReplicator> Replicator;
+
+    // Where the cars are, for hits, homing targets and triggers
+    UPROPERTY()
+    TObjectPtr<UMVehicleSpatialSubsystem> VehicleQueries;
+    // Grip applied to each car this frame by its spatial Id, oil lowers it
+    TArray<float> GripScales;
+    // Some car's grip was lowered last frame and has to be restored once it leaves the oil
+    bool bGripModified = false;
+
+    // One instanced mesh per item type, with an instance per pool slot
+    UPROPERTY()
+    TObjectPtr<AActor> VisualsActor;
+    UPROPERTY()
+    TArray<TObjectPtr<UInstancedStaticMeshComponent>> ItemMeshes;
+    // Instance transforms per item type, written in one batch per frame
+    TArray<TArray<FTransform>> InstanceTransforms;
+    TArray<bool> InstancesDirty;
+};
@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MVehicleNetPrediction.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<float> CVarMPVehicleNetPositionTolerance(
+    TEXT("mp.Vehicle.Net.PositionTolerance"),
+    5.0f,
+    TEXT("Distance in cm the predicted car may be off the server's before it is rolled back and resimulated."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarMPVehicleNetVelocityTolerance(
+    TEXT("mp.Vehicle.Net.VelocityTolerance"),
+    50.0f,
+    TEXT("Speed difference in cm/s tolerated before a rollback."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarMPVehicleNetRotationTolerance(
+    TEXT("mp.Vehicle.Net.RotationTolerance"),
+    2.0f,
+    TEXT("Rotation difference in degrees tolerated before a rollback."),
+    ECVF_Default);
+
+// --- History ---
+
+FMVehicleNetHistoryEntry& FMVehicleNetHistory::Add(uint32 Step)
+{
+    // Steps always arrive in order, a gap (the vehicle sat out a step) drops what came before it
+    if (NumEntries > 0 && Step != LatestStep + 1)
+    {
+        Reset();
+    }
+
+    LatestStep = Step;
+    NumEntries = FMath::Min(NumEntries + 1, Capacity);
+
+    FMVehicleNetHistoryEntry& entry = Entries[Step % Capacity];
+    entry = FMVehicleNetHistoryEntry();
+    entry.Step = Step;
+    return entry;
+}
+
+FMVehicleNetHistoryEntry* FMVehicleNetHistory::Find(uint32 Step)
+{
+    const uint32 age = LatestStep - Step;
+    if (NumEntries == 0 || age >= static_cast<uint32>(NumEntries))
+    {
+        return nullptr;
+    }
+    return &Entries[Step % Capacity];
+}
+
+void FMVehicleNetHistory::Reset()
+{
+    NumEntries = 0;
+    LatestStep = 0;
+}
+
+// --- Prediction ---
+
+bool MVehicleNetPrediction::NeedsCorrection(const FMVehicleNetState& Predicted, const FMVehicleNetState& Authoritative)
+{
+    const float positionTolerance = CVarMPVehicleNetPositionTolerance.GetValueOnAnyThread();
+    const float velocityTolerance = CVarMPVehicleNetVelocityTolerance.GetValueOnAnyThread();
+    const float rotationTolerance = FMath::DegreesToRadians(CVarMPVehicleNetRotationTolerance.GetValueOnAnyThread());
+
+    return FVector::DistSquared(Predicted.Location, Authoritative.Location) > FMath::Square(positionTolerance) ||
+        FVector::DistSquared(Predicted.LinearVelocity, Authoritative.LinearVelocity) > FMath::Square(velocityTolerance) ||
+        Predicted.Rotation.AngularDistance(Authoritative.Rotation) > rotationTolerance;
+}
+
+void MVehicleNetPrediction::SimulateStep(const FMVehicleSimInput& Sim, const FMVehicleNetBodyProperties& Body, const FMVehicleQuantizedInput& Input,
+    const FMVehicleWheelContact (&Contacts)[MVehiclePhysics::NumWheels], FMVehicleNetState& InOutState, float DeltaTime)
+{
+    const FMVehicleForceParams& params = Sim.Params;
+    const FMVehicleControlInput controls = Input.ToControlInput();
+    MVehiclePhysics::UpdateControls(params, controls, InOutState.Controls, DeltaTime);
+
+    FMVehicleBodyState bodyState;
+    bodyState.Location = InOutState.Location;
+    bodyState.Rotation = InOutState.Rotation;
+    bodyState.LinearVelocity = InOutState.LinearVelocity;
+    bodyState.AngularVelocity = InOutState.AngularVelocity;
+    bodyState.CenterOfMass = bodyState.Location + bodyState.Rotation.RotateVector(Body.CenterOfMass);
+
+    // --- Wheel forces, exactly as the fixed step computes them ---
+    FVector force = FVector::ZeroVector;
+    FVector torque = FVector::ZeroVector;
+    for (int32 wheelIndex = 0; wheelIndex < MVehiclePhysics::NumWheels; wheelIndex++)
+    {
+        const FMVehicleWheelSetup& setup = Sim.Wheels[wheelIndex];
+        const FVector wheelLocation = bodyState.Location + bodyState.Rotation.RotateVector(setup.LocalOffset);
+        const FVector direction = bodyState.Rotation.RotateVector(setup.LocalDirection);
+        const FMVehicleWheelContact contact = MVehiclePhysics::ReprojectContact(Contacts[wheelIndex], wheelLocation, direction, params.GetTraceLength());
+
+        const FMVehicleWheelForce wheelForce = MVehiclePhysics::ComputeWheelForce(wheelIndex, params, bodyState, controls, InOutState.Controls,
+            wheelLocation, contact, InOutState.SpringLength[wheelIndex], DeltaTime);
+        if (wheelForce.bGrounded)
+        {
+            const FVector wheelTotal = wheelForce.SuspensionForce + wheelForce.TireForce;
+            force += wheelTotal;
+            torque += FVector::CrossProduct(wheelForce.Location - bodyState.CenterOfMass, wheelTotal);
+        }
+    }
+
+    // --- Integrate the centre of mass ---
+    FVector linearVelocity = bodyState.LinearVelocity + (force * Body.InvMass + FVector(0.0f, 0.0f, Body.GravityZ)) * DeltaTime;
+    linearVelocity *= FMath::Max(0.0f, 1.0f - Body.LinearDrag * DeltaTime);
+
+    const FQuat massRotation = bodyState.Rotation * Body.RotationOfMass;
+    const FVector angularAcceleration = massRotation.RotateVector(Body.InvInertia * massRotation.UnrotateVector(torque));
+    FVector angularVelocity = bodyState.AngularVelocity + angularAcceleration * DeltaTime;
+    angularVelocity *= FMath::Max(0.0f, 1.0f - Body.AngularDrag * DeltaTime);
+
+    const FVector centerOfMass = bodyState.CenterOfMass + linearVelocity * DeltaTime;
+    FQuat rotation = bodyState.Rotation + FQuat(angularVelocity.X, angularVelocity.Y, angularVelocity.Z, 0.0f) * bodyState.Rotation * (0.5f * DeltaTime);
+    rotation.Normalize();
+
+    InOutState.Rotation = rotation;
+    InOutState.Location = centerOfMass - rotation.RotateVector(Body.CenterOfMass);
+    InOutState.LinearVelocity = linearVelocity;
+    InOutState.AngularVelocity = angularVelocity;
+    InOutState.Input = Input;
+}
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Physics/MVehiclePhysics.h"
+#include "Core/Net/MVehicleNetTypes.h"
+
+// Client side prediction for the locally driven car. Like MVehiclePhysics, nothing in here touches UObjects,
+// it runs inside the fixed step on the physics thread.
+//
+// Each client simulates its own car from live input and sends the quantized input of every physics step to the
+// server (AMVehicleBase::ServerSendInputs). The server steps that car with the same inputs and replicates the result
+// as FMVehicleNetState, labelled with the client step it belongs to. When it arrives the client compares it with what
+// it predicted for that step and, if they disagree, rewinds to the server's state and simulates the newer steps again
+// from FMVehicleNetHistory. Everybody else's car is snapped to its latest snapshot and extrapolated with its last input.
+//
+// To try it on one machine, start a dedicated server and as many clients as needed (Steam falls back to IP with -nosteam):
+//
+//   UnrealEditor MashedPotatoes.uproject /Game/Maps/Lvl_VehicleBasic -server -log -nosteam -port=7777
+//   UnrealEditor MashedPotatoes.uproject 127.0.0.1:7777 -game -log -nosteam -windowed -resx=1280 -resy=720
+//
+// Add -PktLag=100 -PktLagVariance=20 -PktLoss=2 to a client to emulate a bad connection, "stat MPVehicle" counts
+// the rollbacks.
+
+// One predicted physics step
+struct FMVehicleNetHistoryEntry
+{
+    uint32 Step = 0;
+    FMVehicleQuantizedInput Input;
+    // Suspension contacts the step was simulated against, reprojected when the step is simulated again
+    FMVehicleWheelContact Contacts[MVehiclePhysics::NumWheels];
+    // Filled in by the following step, once the solver has integrated this one
+    bool bHasState = false;
+    FMVehicleNetState State;
+};
+
+// Ring buffer of the steps that the server has not confirmed yet
+class FMVehicleNetHistory
+{
+public:
+    // About two seconds at 60 Hz, corrections older than that snap instead of rolling back
+    static constexpr int32 Capacity = 128;
+
+    FMVehicleNetHistoryEntry& Add(uint32 Step);
+    // Returns null if the step is not in the buffer anymore (or never was)
+    FMVehicleNetHistoryEntry* Find(uint32 Step);
+    uint32 GetLatestStep() const { return LatestStep; }
+    bool IsEmpty() const { return NumEntries == 0; }
+    void Reset();
+
+private:
+    FMVehicleNetHistoryEntry Entries[Capacity];
+    int32 NumEntries = 0;
+    uint32 LatestStep = 0;
+};
+
+// Mass properties of the body, read off the particle before a rollback
+struct FMVehicleNetBodyProperties
+{
+    float InvMass = 0.0f;
+    // Inverse inertia in the principal (mass) frame
+    FVector InvInertia = FVector::ZeroVector;
+    FQuat RotationOfMass = FQuat::Identity;
+    FVector CenterOfMass = FVector::ZeroVector;
+    float LinearDrag = 0.0f;
+    float AngularDrag = 0.0f;
+    float GravityZ = -980.0f;
+};
+
+namespace MVehicleNetPrediction
+{
+    // True when the predicted state has drifted far enough from the server's to roll back
+    bool NeedsCorrection(const FMVehicleNetState& Predicted, const FMVehicleNetState& Authoritative);
+
+    // Simulates one step of a lone vehicle: the same wheel force model as the fixed step, then a semi-implicit Euler
+    // integration of the body like the solver's. Collisions other than the suspension are not part of it, the next
+    // snapshot settles those.
+    void SimulateStep(const FMVehicleSimInput& Sim, const FMVehicleNetBodyProperties& Body, const FMVehicleQuantizedInput& Input,
+        const FMVehicleWheelContact (&Contacts)[MVehiclePhysics::NumWheels], FMVehicleNetState& InOutState, float DeltaTime);
+}
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MVehicleNetTypes.h"
+#include "Engine/NetSerialization.h"
+
+namespace MVehicleNetTypes
+{
+    // Fixed point helpers for the small values that do not need a packed vector
+    void SerializeFixed16(FArchive& Ar, float& Value, float Scale)
+    {
+        int16 quantized = static_cast<int16>(FMath::Clamp(FMath::RoundToInt32(Value * Scale), MIN_int16, MAX_int16));
+        Ar << quantized;
+        Value = quantized / Scale;
+    }
+}
+
+bool FMVehicleNetState::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+    Ar.SerializeIntPacked(Step);
+
+    // 0.1 cm position, 0.1 cm/s and 0.001 rad/s velocities, 16 bit angles
+    bOutSuccess = SerializePackedVector<10, 24>(Location, Ar);
+    bOutSuccess &= SerializePackedVector<10, 24>(LinearVelocity, Ar);
+    bOutSuccess &= SerializePackedVector<1000, 24>(AngularVelocity, Ar);
+
+    FRotator rotator = Rotation.Rotator();
+    rotator.SerializeCompressedShort(Ar);
+    if (Ar.IsLoading())
+    {
+        Rotation = rotator.Quaternion();
+    }
+
+    MVehicleNetTypes::SerializeFixed16(Ar, Controls.ForwardAxisValue, 32767.0f);
+    MVehicleNetTypes::SerializeFixed16(Ar, Controls.SideAxisValue, 32767.0f);
+    MVehicleNetTypes::SerializeFixed16(Ar, Controls.FrontWheelSteerAngle, 100.0f);
+    for (float& springLength : SpringLength)
+    {
+        MVehicleNetTypes::SerializeFixed16(Ar, springLength, 10.0f);
+    }
+    Ar << Input;
+
+    return bOutSuccess;
+}
+
+bool FMVehicleNetState::operator==(const FMVehicleNetState& Other) const
+{
+    return Step == Other.Step && Location == Other.Location && Rotation == Other.Rotation &&
+        LinearVelocity == Other.LinearVelocity && AngularVelocity == Other.AngularVelocity && Input == Other.Input;
+}
+
+bool FMVehicleNetInputs::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+    Ar.SerializeIntPacked(LastStep);
+
+    uint8 numInputs = static_cast<uint8>(FMath::Min(Inputs.Num(), MaxInputs));
+    Ar.SerializeBits(&numInputs, 4);
+    if (Ar.IsLoading())
+    {
+        numInputs = FMath::Min<uint8>(numInputs, MaxInputs);
+        Inputs.SetNum(numInputs);
+    }
+
+    for (int32 inputIndex = 0; inputIndex < numInputs; inputIndex++)
+    {
+        Ar << Inputs[inputIndex];
+    }
+
+    bOutSuccess = !Ar.IsError();
+    return bOutSuccess;
+}
@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Physics/MVehiclePhysics.h"
+#include "MVehicleNetTypes.generated.h"
+
+// How the fixed step treats a vehicle in a networked game
+enum class EMVehicleNetRole : uint8
+{
+    // Standalone, or owned by the server (listen server host, AI): simulated from live input
+    Local,
+    // On the server, driven by a remote client's input stream
+    ServerRemote,
+    // The locally driven car on a client: predicted from live input, rolled back on correction
+    AutonomousProxy,
+    // Somebody else's car on a client: snapped to each snapshot and extrapolated with its last input
+    SimulatedProxy,
+};
+
+// One physics step of driver input, numbered by the client that produced it
+struct FMVehicleNetInput
+{
+    uint32 Step = 0;
+    FMVehicleQuantizedInput Input;
+};
+
+// Vehicle state after a physics step, as the server sends it. Quantized in NetSerialize to roughly 50 bytes.
+USTRUCT()
+struct MASHEDPOTATOES_API FMVehicleNetState
+{
+    GENERATED_BODY()
+
+    // Step the state is the result of: the client's input step for its own car, the server step otherwise
+    uint32 Step = 0;
+    FVector Location = FVector::ZeroVector;
+    FQuat Rotation = FQuat::Identity;
+    FVector LinearVelocity = FVector::ZeroVector;
+    // Radians per second
+    FVector AngularVelocity = FVector::ZeroVector;
+    FMVehicleControlState Controls;
+    float SpringLength[MVehiclePhysics::NumWheels] = {0.0f, 0.0f, 0.0f, 0.0f};
+    // Input the step was simulated with, simulated proxies keep driving with it
+    FMVehicleQuantizedInput Input;
+
+    bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+    bool operator==(const FMVehicleNetState& Other) const;
+};
+
+template<>
+struct TStructOpsTypeTraits<FMVehicleNetState> : public TStructOpsTypeTraitsBase2<FMVehicleNetState>
+{
+    enum
+    {
+        WithNetSerializer = true,
+        WithIdenticalViaEquality = true,
+    };
+};
+
+// The newest few inputs of a client, sent every frame so a lost packet is covered by the next one
+USTRUCT()
+struct MASHEDPOTATOES_API FMVehicleNetInputs
+{
+    GENERATED_BODY()
+
+    static constexpr int32 MaxInputs = 8;
+
+    // Step of the last entry in Inputs, the ones before it are consecutive
+    uint32 LastStep = 0;
+    TArray<FMVehicleQuantizedInput, TInlineAllocator<MaxInputs>> Inputs;
+
+    bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FMVehicleNetInputs> : public TStructOpsTypeTraitsBase2<FMVehicleNetInputs>
+{
+    enum
+    {
+        WithNetSerializer = true,
+    };
+};
+
+// Network part of the snapshot the game thread hands to the fixed step
+struct FMVehicleNetSimInput
+{
+    EMVehicleNetRole Role = EMVehicleNetRole::Local;
+    // The server wants the vehicle's state back to replicate it
+    bool bOutputState = false;
+    float GravityZ = -980.0f;
+    // New authoritative state for a client's vehicle
+    bool bHasCorrection = false;
+    FMVehicleNetState Correction;
+    // Client inputs that arrived at the server since the last push
+    TArray<FMVehicleNetInput, TInlineAllocator<FMVehicleNetInputs::MaxInputs>> RemoteInputs;
+};
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MVehicleHandlingProfile.h"
+
+namespace MVehicleHandlingProfile
+{
+    // Fills Table with Curve sampled evenly from 0 to MaxX, or with a straight line of Slope when the curve is empty
+    void BakeCurve(const FRuntimeFloatCurve& Curve, float Slope, float Constant, float MaxX, float (&Table)[FMVehicleHandlingTables::NumSamples])
+    {
+        const FRichCurve* RichCurve = Curve.GetRichCurveConst();
+        const bool bHasKeys = RichCurve && RichCurve->GetNumKeys() > 0;
+        for (int32 SampleIndex = 0; SampleIndex < FMVehicleHandlingTables::NumSamples; SampleIndex++)
+        {
+            const float X = MaxX * SampleIndex / (FMVehicleHandlingTables::NumSamples - 1);
+            Table[SampleIndex] = bHasKeys ? RichCurve->Eval(X) : Constant + Slope * X;
+        }
+    }
+}
+
+TSharedPtr<const FMVehicleHandlingTables> UMVehicleHandlingProfile::GetTables()
+{
+    if (!Tables.IsValid())
+    {
+        BakeTables();
+    }
+    return Tables;
+}
+
+void UMVehicleHandlingProfile::PostLoad()
+{
+    Super::PostLoad();
+    BakeTables();
+}
+
+#if WITH_EDITOR
+void UMVehicleHandlingProfile::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+    Super::PostEditChangeProperty(PropertyChangedEvent);
+    BakeTables();
+}
+#endif
+
+void UMVehicleHandlingProfile::BakeTables()
+{
+    TSharedRef<FMVehicleHandlingTables> NewTables = MakeShared<FMVehicleHandlingTables>();
+
+    MVehicleHandlingProfile::BakeCurve(LateralGripCurve, LinearLateralGrip, 0.0f, MaxLateralSlipSpeed, NewTables->LateralGrip);
+    NewTables->LateralSlipToIndex = (FMVehicleHandlingTables::NumSamples - 1) / FMath::Max(MaxLateralSlipSpeed, 1.0f);
+    MVehicleHandlingProfile::BakeCurve(TorqueCurve, 0.0f, DriveForce, MaxDriveSpeed, NewTables->DriveForce);
+    NewTables->DriveSpeedToIndex = (FMVehicleHandlingTables::NumSamples - 1) / FMath::Max(MaxDriveSpeed, 1.0f);
+
+    // Each wheel gets its axle's share, so two driven wheels at 1 match the fixed model's rear wheel drive
+    float FrontDrive = 0.0f;
+    switch (Drivetrain)
+    {
+    case EMVehicleDrivetrain::FrontWheelDrive: FrontDrive = 1.0f; break;
+    case EMVehicleDrivetrain::RearWheelDrive: FrontDrive = 0.0f; break;
+    case EMVehicleDrivetrain::AllWheelDrive: FrontDrive = AllWheelDriveFrontSplit; break;
+    }
+    // With an even bias every wheel brakes at 1, like the fixed model
+    const float FrontBrake = 2.0f * BrakeBiasFront;
+    const float RearBrake = 2.0f * (1.0f - BrakeBiasFront);
+
+    for (int32 WheelIndex = 0; WheelIndex < MVehiclePhysics::NumWheels; WheelIndex++)
+    {
+        const bool bFront = MVehiclePhysics::IsFrontWheel(WheelIndex);
+        NewTables->DriveShare[WheelIndex] = bFront ? FrontDrive : 1.0f - FrontDrive;
+        NewTables->BrakeShare[WheelIndex] = bFront ? FrontBrake : RearBrake;
+    }
+
+    Tables = NewTables;
+}
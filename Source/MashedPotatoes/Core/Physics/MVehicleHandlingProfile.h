@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Curves/CurveFloat.h"
+#include "Core/Physics/MVehiclePhysics.h"
+#include "MVehicleHandlingProfile.generated.h"
+
+UENUM(BlueprintType)
+enum class EMVehicleDrivetrain : uint8
+{
+    FrontWheelDrive,
+    RearWheelDrive,
+    AllWheelDrive,
+};
+
+// Per car handling, assigned to AMVehicleBase::HandlingProfile. The curves are baked into FMVehicleHandlingTables
+// when the asset loads (and whenever it is edited), the force model only ever samples the tables.
+UCLASS(BlueprintType)
+class MASHEDPOTATOES_API UMVehicleHandlingProfile : public UPrimaryDataAsset
+{
+    GENERATED_BODY()
+
+public:
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Grip")
+    // Sideways friction force of one wheel (Y) by how fast it slides sideways in cm/s (X).
+    // Empty uses LinearLateralGrip, a curve that flattens out lets the car drift.
+    FRuntimeFloatCurve LateralGripCurve;
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Grip")
+    // Friction per cm/s of slip when LateralGripCurve has no keys, the same as the pawn's FrictionConst
+    float LinearLateralGrip = 1000.0f;
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Grip", meta = (ClampMin = "1.0"))
+    // Slip speed the grip table covers, faster slides use the last sample
+    float MaxLateralSlipSpeed = 3000.0f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Engine")
+    // Full throttle drive force at the road (Y) by forward speed in cm/s (X), before the drivetrain splits it.
+    // Empty uses a flat DriveForce.
+    FRuntimeFloatCurve TorqueCurve;
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Engine")
+    // Drive force when TorqueCurve has no keys, the same as the pawn's ForwardForceConst
+    float DriveForce = 300000.0f;
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Engine", meta = (ClampMin = "1.0"))
+    // Speed the torque table covers, faster uses the last sample
+    float MaxDriveSpeed = 5000.0f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Drivetrain")
+    EMVehicleDrivetrain Drivetrain = EMVehicleDrivetrain::RearWheelDrive;
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Drivetrain", meta = (ClampMin = "0.0", ClampMax = "1.0", EditCondition = "Drivetrain == EMVehicleDrivetrain::AllWheelDrive"))
+    // Share of the drive force that goes to the front axle with all wheel drive
+    float AllWheelDriveFrontSplit = 0.4f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Brakes", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+    // Share of the braking force on the front axle, 0.5 brakes all four wheels equally
+    float BrakeBiasFront = 0.5f;
+
+    // The baked tables, built on first use if the asset has not been loaded through PostLoad
+    TSharedPtr<const FMVehicleHandlingTables> GetTables();
+
+    // UObject
+    virtual void PostLoad() override;
+#if WITH_EDITOR
+    virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+private:
+    void BakeTables();
+
+    // Replaced rather than modified, so a physics step that still holds the old tables is unaffected
+    TSharedPtr<const FMVehicleHandlingTables> Tables;
+};
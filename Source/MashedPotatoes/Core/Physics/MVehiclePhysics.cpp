@@ -0,0 +1,205 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MVehiclePhysics.h"
+
+FMVehicleQuantizedInput FMVehicleQuantizedInput::Quantize(const FMVehicleControlInput& Input)
+{
+    FMVehicleQuantizedInput result;
+    result.ForwardAxis = static_cast<int8>(FMath::RoundToInt32(FMath::Clamp(Input.ForwardAxisInput, -1.0f, 1.0f) * 127.0f));
+    result.SideAxis = static_cast<int8>(FMath::RoundToInt32(FMath::Clamp(Input.SideAxisInput, -1.0f, 1.0f) * 127.0f));
+    result.bBrakeApplied = Input.bBrakeApplied ? 1 : 0;
+    return result;
+}
+
+FMVehicleControlInput FMVehicleQuantizedInput::ToControlInput() const
+{
+    return FMVehicleControlInput{ForwardAxis / 127.0f, SideAxis / 127.0f, bBrakeApplied != 0};
+}
+
+void MVehiclePhysics::UpdateControls(const FMVehicleForceParams& Params, const FMVehicleControlInput& Input, FMVehicleControlState& State, float DeltaTime)
+{
+    // Interpolate input values for smoother acceleration and steering
+    State.SideAxisValue = FMath::FInterpTo(State.SideAxisValue, Input.SideAxisInput, DeltaTime, InputInterpSpeed);
+    State.ForwardAxisValue = FMath::FInterpTo(State.ForwardAxisValue, Input.ForwardAxisInput, DeltaTime, InputInterpSpeed);
+
+    // Steering is interpolated once per step and shared by both front wheels
+    State.FrontWheelSteerAngle = FMath::FInterpTo(State.FrontWheelSteerAngle, Params.MaxSteeringAngle * Input.SideAxisInput, DeltaTime, InputInterpSpeed);
+}
+
+FMVehicleWheelForce MVehiclePhysics::ComputeWheelForce(int32 WheelIndex, const FMVehicleForceParams& Params, const FMVehicleBodyState& Body,
+    const FMVehicleControlInput& Input, const FMVehicleControlState& Control, const FVector& WheelLocation,
+    const FMVehicleWheelContact& Contact, float& InOutSpringLength, float DeltaTime)
+{
+    FMVehicleWheelForce result;
+    result.Location = WheelLocation;
+
+    // If the wheel is not on the ground, reset its spring length and apply no forces from it
+    if (!Contact.bBlockingHit)
+    {
+        InOutSpringLength = Params.GetMaxLength(); // Spring is fully extended when not touching ground
+        return result;
+    }
+    result.bGrounded = true;
+
+    // --- Suspension Force ---
+    const float currentSpringLength = Contact.Distance - Params.WheelRadius;
+
+    // Store the current spring length and calculate velocity from the previous step's length
+    const float prevSpringLength = InOutSpringLength;
+    InOutSpringLength = FMath::Clamp(currentSpringLength, Params.GetMinLength(), Params.GetMaxLength());
+
+    result.SpringVelocity = DeltaTime > 0.0f ? (prevSpringLength - InOutSpringLength) / DeltaTime : 0.0f; // Velocity of compression/extension
+
+    const float springForce = (Params.RestLength - InOutSpringLength) * Params.SpringForceConst; // Force from spring compression/extension
+    const float damperForce = result.SpringVelocity * Params.DamperForceConst; // Damping force opposes spring velocity
+    result.SuspensionForce = Body.Rotation.GetUpVector() * (springForce + damperForce);
+
+    // --- Calculate Ground-Aligned Wheel Vectors for Steering and Forces ---
+    FVector wheelForward, wheelRight;
+    GetTireFrame(WheelIndex, Params, Body.Rotation, Control.FrontWheelSteerAngle, Contact, wheelForward, wheelRight);
+
+    result.WheelForward = wheelForward;
+    result.WheelRight = wheelRight;
+
+    // Velocity of the body at this wheel: linear velocity + tangential velocity due to angular rotation
+    const FVector wheelWorldVelocityAtContact = Body.LinearVelocity + FVector::CrossProduct(Body.AngularVelocity, WheelLocation - Body.CenterOfMass);
+
+    // --- Slip Velocities using the ground-aligned vectors ---
+    result.LongitudinalVelocity = FVector::DotProduct(wheelWorldVelocityAtContact, wheelForward);
+    result.LateralVelocity = FVector::DotProduct(wheelWorldVelocityAtContact, wheelRight);
+
+    // --- PROPULSION / BRAKING FORCE (Active Force) ---
+    const FMVehicleHandlingTables* handling = Params.Handling.Get();
+    if (Input.bBrakeApplied)
+    {
+        // Braking force directly opposing the current longitudinal velocity, split between the axles by the brake bias
+        const float brakeShare = handling ? handling->BrakeShare[WheelIndex] : 1.0f;
+        result.ActiveLongitudinalForce = -result.LongitudinalVelocity * Params.BrakeConst * brakeShare;
+
+        // Strong "hold" force when braking and nearly stopped
+        if (FMath::Abs(result.LongitudinalVelocity) < Params.BrakeStopThresholdVelocity)
+        {
+            result.BrakeHoldForce = -FMath::Sign(result.LongitudinalVelocity) * Params.BrakeStopForceConst;
+            result.ActiveLongitudinalForce += result.BrakeHoldForce;
+        }
+    }
+    else if (handling)
+    {
+        // Drive force falls off with speed along the profile's curve, shared out by the drivetrain layout
+        result.ActiveLongitudinalForce = Control.ForwardAxisValue * handling->SampleDriveForce(FMath::Abs(result.LongitudinalVelocity)) * handling->DriveShare[WheelIndex];
+    }
+    else if (IsRearWheel(WheelIndex))
+    {
+        // Propulsion is applied to the rear wheels only
+        result.ActiveLongitudinalForce = Control.ForwardAxisValue * Params.ForwardForceConst;
+    }
+    FVector totalWheelForce = wheelForward * result.ActiveLongitudinalForce;
+
+    // --- FRICTION FORCES (Passive, always oppose slip) ---
+    // Lateral Friction: Opposes sideways movement (crucial for steering and preventing spin)
+    result.LateralFrictionMagnitude = handling
+        ? -FMath::Sign(result.LateralVelocity) * handling->SampleLateralGrip(FMath::Abs(result.LateralVelocity))
+        : -result.LateralVelocity * Params.FrictionConst;
+    result.LateralFrictionMagnitude *= Params.GripScale;
+    totalWheelForce += wheelRight * result.LateralFrictionMagnitude;
+
+    // Longitudinal Friction (Rolling Resistance / Drag): slows the car down when no propulsion/braking is applied
+    result.RollingResistanceMagnitude = -result.LongitudinalVelocity * Params.DragConst;
+    totalWheelForce += wheelForward * result.RollingResistanceMagnitude;
+
+    // --- Resting Drag / Low Velocity Damping ---
+    // Only apply if no active drive/brake input and car is moving very slowly
+    if (FMath::IsNearlyZero(Input.ForwardAxisInput, KINDA_SMALL_NUMBER) && !Input.bBrakeApplied && FMath::Abs(result.LongitudinalVelocity) < Params.StopThresholdVelocity)
+    {
+        result.RestingDragForceMagnitude = -result.LongitudinalVelocity * Params.RestingDragConst;
+        totalWheelForce += wheelForward * result.RestingDragForceMagnitude;
+    }
+
+    result.TireForce = totalWheelForce;
+    return result;
+}
+
+void MVehiclePhysics::GetTireFrame(int32 WheelIndex, const FMVehicleForceParams& Params, const FQuat& BodyRotation, float FrontWheelSteerAngle,
+    const FMVehicleWheelContact& Contact, FVector& OutForward, FVector& OutRight)
+{
+    // On the contact plane, so slopes and bumps push along the surface rather than into it
+    if (Params.bContactNormalFrame && Contact.bBlockingHit)
+    {
+        const FVector groundNormal = Contact.ImpactNormal;
+        const FVector forwardOnContact = FVector::VectorPlaneProject(BodyRotation.GetForwardVector(), groundNormal).GetSafeNormal();
+        // A car standing on its nose has no forward direction on the plane, use the flat frame below
+        if (!forwardOnContact.IsZero())
+        {
+            OutForward = IsFrontWheel(WheelIndex) ? forwardOnContact.RotateAngleAxis(FrontWheelSteerAngle, groundNormal).GetSafeNormal() : forwardOnContact;
+            OutRight = FVector::CrossProduct(groundNormal, OutForward).GetSafeNormal();
+            return;
+        }
+    }
+
+    // Get the car's forward vector and flatten it to the ground plane (Z=0)
+    FVector carForwardOnGround = BodyRotation.GetForwardVector();
+    carForwardOnGround.Z = 0.0f;
+    carForwardOnGround.Normalize();
+
+    // Front wheels rotate the ground-aligned forward vector by the steering angle, rear wheels follow the car
+    OutForward = IsFrontWheel(WheelIndex)
+        ? carForwardOnGround.RotateAngleAxis(FrontWheelSteerAngle, FVector::UpVector)
+        : carForwardOnGround;
+    OutForward.Normalize();
+
+    // The wheel's "right" vector, perpendicular to its ground-aligned forward direction
+    OutRight = FVector::CrossProduct(FVector::UpVector, OutForward);
+    OutRight.Normalize();
+}
+
+FMVehicleWheelContact MVehiclePhysics::ReprojectContact(const FMVehicleWheelContact& Cached, const FVector& Start, const FVector& Direction, float TraceLength)
+{
+    FMVehicleWheelContact contact;
+    if (!Cached.bBlockingHit)
+    {
+        return contact;
+    }
+
+    // The ray has to point into the surface, otherwise the plane is never reached
+    const float directionDotNormal = FVector::DotProduct(Direction, Cached.ImpactNormal);
+    if (directionDotNormal > -KINDA_SMALL_NUMBER)
+    {
+        return contact;
+    }
+
+    // A sphere touches the plane once its centre is SweepRadius above it, the wheel bottom is SweepRadius further on
+    const float centerDistance = (FVector::DotProduct(Cached.ImpactPoint - Start, Cached.ImpactNormal) + Cached.SweepRadius) / directionDotNormal;
+    const float distance = centerDistance + Cached.SweepRadius;
+    if (distance < 0.0f || distance > TraceLength)
+    {
+        return contact;
+    }
+
+    contact.bBlockingHit = true;
+    contact.Distance = distance;
+    contact.ImpactPoint = Start + Direction * centerDistance - Cached.ImpactNormal * Cached.SweepRadius;
+    contact.ImpactNormal = Cached.ImpactNormal;
+    contact.SweepRadius = Cached.SweepRadius;
+    return contact;
+}
+
+float MVehiclePhysics::GetWheelSpinDelta(float LongitudinalVelocity, float WheelRadius, float DeltaTime)
+{
+    return (-360.0f * LongitudinalVelocity * DeltaTime) / (2.0f * PI * WheelRadius);
+}
+
+FMVehicleSimOutput MVehiclePhysics::InterpolateOutput(const FMVehicleSimOutput& From, const FMVehicleSimOutput& To, float Alpha)
+{
+    FMVehicleSimOutput result = To;
+    result.Controls.ForwardAxisValue = FMath::Lerp(From.Controls.ForwardAxisValue, To.Controls.ForwardAxisValue, Alpha);
+    result.Controls.SideAxisValue = FMath::Lerp(From.Controls.SideAxisValue, To.Controls.SideAxisValue, Alpha);
+    result.Controls.FrontWheelSteerAngle = FMath::Lerp(From.Controls.FrontWheelSteerAngle, To.Controls.FrontWheelSteerAngle, Alpha);
+
+    for (int32 wheelIndex = 0; wheelIndex < NumWheels; wheelIndex++)
+    {
+        result.SpringLength[wheelIndex] = FMath::Lerp(From.SpringLength[wheelIndex], To.SpringLength[wheelIndex], Alpha);
+        result.WheelRotation[wheelIndex] = FRotator::NormalizeAxis(From.WheelRotation[wheelIndex] + FMath::FindDeltaAngleDegrees(From.WheelRotation[wheelIndex], To.WheelRotation[wheelIndex]) * Alpha);
+    }
+    return result;
+}
@@ -0,0 +1,225 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Plain data and the wheel force model shared by every place that steps a vehicle.
+// Nothing in here touches UObjects, so it is safe to run on the physics thread.
+
+namespace MVehiclePhysics
+{
+    // Wheel order used everywhere: 0=FL, 1=FR, 2=RL, 3=RR
+    constexpr int32 NumWheels = 4;
+    // Interp speed used for the input axes and the steering angle
+    constexpr float InputInterpSpeed = 5.0f;
+
+    FORCEINLINE bool IsFrontWheel(int32 WheelIndex) { return WheelIndex == 0 || WheelIndex == 1; }
+    FORCEINLINE bool IsRearWheel(int32 WheelIndex) { return WheelIndex == 2 || WheelIndex == 3; }
+}
+
+// How much work a vehicle gets, chosen by UMVehicleSignificanceSubsystem. Ordered so a higher value is more detail.
+enum class EMVehicleSimulationLOD : uint8
+{
+    // One suspension ray per axle refreshed every few frames, lowest tick rate
+    Minimal,
+    // Four suspension rays refreshed every other frame, reduced tick rate
+    Reduced,
+    // Everything every frame
+    Full,
+};
+
+// A UMVehicleHandlingProfile baked into evenly spaced samples, so a wheel pays a lerp instead of a curve evaluation.
+// Immutable once built and shared between the game and physics threads.
+struct FMVehicleHandlingTables
+{
+    static constexpr int32 NumSamples = 64;
+
+    // Lateral friction force by sideways slip speed (cm/s), sampled from 0 to MaxLateralSlipSpeed
+    float LateralGrip[NumSamples] = {};
+    float LateralSlipToIndex = 0.0f;
+    // Full throttle drive force of a wheel with a DriveShare of 1 by forward speed (cm/s), sampled from 0 to MaxDriveSpeed
+    float DriveForce[NumSamples] = {};
+    float DriveSpeedToIndex = 0.0f;
+    // Fraction of the drive force and the brake force each wheel gets. 1 everywhere matches the fixed model's braking,
+    // rear wheels at 1 and front at 0 its propulsion.
+    float DriveShare[MVehiclePhysics::NumWheels] = {0.0f, 0.0f, 1.0f, 1.0f};
+    float BrakeShare[MVehiclePhysics::NumWheels] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+    float SampleLateralGrip(float SlipSpeed) const { return Sample(LateralGrip, SlipSpeed * LateralSlipToIndex); }
+    float SampleDriveForce(float Speed) const { return Sample(DriveForce, Speed * DriveSpeedToIndex); }
+
+private:
+    static float Sample(const float (&Table)[NumSamples], float Index)
+    {
+        const float clampedIndex = FMath::Clamp(Index, 0.0f, static_cast<float>(NumSamples - 1));
+        const int32 lowerIndex = FMath::Min(static_cast<int32>(clampedIndex), NumSamples - 2);
+        return FMath::Lerp(Table[lowerIndex], Table[lowerIndex + 1], clampedIndex - lowerIndex);
+    }
+};
+
+// Tuning constants copied off the pawn so the force model does not need the actor
+struct FMVehicleForceParams
+{
+    float RestLength = 100.0f;
+    float SpringTravelLength = 150.0f;
+    float WheelRadius = 50.0f;
+    float SpringForceConst = 7000.0f;
+    float DamperForceConst = 2456.0f;
+    float ForwardForceConst = 300000.0f;
+    float FrictionConst = 1000.0f;
+    float DragConst = 100.0f;
+    float BrakeConst = 150.0f;
+    float MaxSteeringAngle = 30.0f;
+    float BrakeStopForceConst = 13000.0f;
+    float BrakeStopThresholdVelocity = 50.0f;
+    float RestingDragConst = 5000.0f;
+    float StopThresholdVelocity = 50.0f;
+    // Build the tire frame on the contact plane instead of flattening it onto world Z
+    bool bContactNormalFrame = false;
+    // Multiplies the lateral grip, lowered while the car is on an oil slick
+    float GripScale = 1.0f;
+    // Grip, drive and brake layout from a handling profile. Null keeps the linear FrictionConst/ForwardForceConst model.
+    TSharedPtr<const FMVehicleHandlingTables> Handling;
+
+    // Minimum compressed length of the spring
+    float GetMinLength() const { return RestLength - SpringTravelLength; }
+    // Maximum extended length of the spring
+    float GetMaxLength() const { return RestLength + SpringTravelLength; }
+    // Length of the suspension ray measured from the wheel arrow
+    float GetTraceLength() const { return GetMaxLength() + WheelRadius; }
+};
+
+// Raw driver input as set by the input actions
+struct FMVehicleControlInput
+{
+    float ForwardAxisInput = 0.0f;
+    float SideAxisInput = 0.0f;
+    bool bBrakeApplied = false;
+};
+
+// Driver input as the fixed step consumes and records it. The axes are stored in 1/127 steps so a recorded
+// run can be fed back bit for bit.
+struct FMVehicleQuantizedInput
+{
+    int8 ForwardAxis = 0;
+    int8 SideAxis = 0;
+    uint8 bBrakeApplied = 0;
+
+    static FMVehicleQuantizedInput Quantize(const FMVehicleControlInput& Input);
+    FMVehicleControlInput ToControlInput() const;
+
+    bool operator==(const FMVehicleQuantizedInput& Other) const
+    {
+        return ForwardAxis == Other.ForwardAxis && SideAxis == Other.SideAxis && bBrakeApplied == Other.bBrakeApplied;
+    }
+    bool operator!=(const FMVehicleQuantizedInput& Other) const { return !(*this == Other); }
+
+    friend FArchive& operator<<(FArchive& Ar, FMVehicleQuantizedInput& Input)
+    {
+        return Ar << Input.ForwardAxis << Input.SideAxis << Input.bBrakeApplied;
+    }
+};
+
+// Smoothed input that carries over from one step to the next
+struct FMVehicleControlState
+{
+    float ForwardAxisValue = 0.0f;
+    float SideAxisValue = 0.0f;
+    float FrontWheelSteerAngle = 0.0f;
+};
+
+// Rigid body state the forces are computed against
+struct FMVehicleBodyState
+{
+    FVector Location = FVector::ZeroVector;
+    FQuat Rotation = FQuat::Identity;
+    FVector LinearVelocity = FVector::ZeroVector;
+    // Radians per second
+    FVector AngularVelocity = FVector::ZeroVector;
+    // World space centre of mass
+    FVector CenterOfMass = FVector::ZeroVector;
+};
+
+// Where a wheel's suspension ray starts, relative to the body (unscaled)
+struct FMVehicleWheelSetup
+{
+    FVector LocalOffset = FVector::ZeroVector;
+    FVector LocalDirection = FVector::DownVector;
+};
+
+// Result of a suspension trace
+struct FMVehicleWheelContact
+{
+    bool bBlockingHit = false;
+    // Distance from the ray start to the impact point
+    float Distance = 0.0f;
+    FVector ImpactPoint = FVector::ZeroVector;
+    FVector ImpactNormal = FVector::UpVector;
+    // Radius of the sphere the contact was swept with, 0 for a ray. Distance is still measured to the bottom of the wheel.
+    float SweepRadius = 0.0f;
+};
+
+// Everything one wheel contributes in a step, kept around for debugging
+struct FMVehicleWheelForce
+{
+    bool bGrounded = false;
+    FVector Location = FVector::ZeroVector;
+    FVector SuspensionForce = FVector::ZeroVector;
+    FVector TireForce = FVector::ZeroVector;
+    FVector WheelForward = FVector::ForwardVector;
+    FVector WheelRight = FVector::RightVector;
+    float SpringVelocity = 0.0f;
+    float LongitudinalVelocity = 0.0f;
+    float LateralVelocity = 0.0f;
+    float ActiveLongitudinalForce = 0.0f;
+    float LateralFrictionMagnitude = 0.0f;
+    float RollingResistanceMagnitude = 0.0f;
+    float RestingDragForceMagnitude = 0.0f;
+    float BrakeHoldForce = 0.0f;
+};
+
+// Snapshot of a vehicle the fixed-step simulation consumes
+struct FMVehicleSimInput
+{
+    FMVehicleForceParams Params;
+    FMVehicleControlInput Controls;
+    FMVehicleWheelSetup Wheels[MVehiclePhysics::NumWheels];
+    FMVehicleWheelContact Contacts[MVehiclePhysics::NumWheels];
+    // Ask the step to hand back an FMVehicleDebugFrame
+    bool bRecordDebug = false;
+};
+
+// What the fixed-step simulation hands back to drive the visuals
+struct FMVehicleSimOutput
+{
+    FMVehicleControlState Controls;
+    float SpringLength[MVehiclePhysics::NumWheels] = {0.0f, 0.0f, 0.0f, 0.0f};
+    // Accumulated wheel spin in degrees, wrapped to [-180, 180)
+    float WheelRotation[MVehiclePhysics::NumWheels] = {0.0f, 0.0f, 0.0f, 0.0f};
+    bool bGrounded[MVehiclePhysics::NumWheels] = {false, false, false, false};
+};
+
+namespace MVehiclePhysics
+{
+    // Advances the smoothed input axes and the front wheel steer angle by one step
+    void UpdateControls(const FMVehicleForceParams& Params, const FMVehicleControlInput& Input, FMVehicleControlState& State, float DeltaTime);
+
+    // Suspension, propulsion/braking and friction for a single wheel. Updates the spring length in place.
+    FMVehicleWheelForce ComputeWheelForce(int32 WheelIndex, const FMVehicleForceParams& Params, const FMVehicleBodyState& Body,
+        const FMVehicleControlInput& Input, const FMVehicleControlState& Control, const FVector& WheelLocation,
+        const FMVehicleWheelContact& Contact, float& InOutSpringLength, float DeltaTime);
+
+    // Forward and right axes of a wheel's tire forces, steering applied to the front wheels
+    void GetTireFrame(int32 WheelIndex, const FMVehicleForceParams& Params, const FQuat& BodyRotation, float FrontWheelSteerAngle,
+        const FMVehicleWheelContact& Contact, FVector& OutForward, FVector& OutRight);
+
+    // Re-evaluates a cached contact from a new ray start by intersecting the ray (or sphere) with the contact plane
+    FMVehicleWheelContact ReprojectContact(const FMVehicleWheelContact& Cached, const FVector& Start, const FVector& Direction, float TraceLength);
+
+    // Degrees a wheel turns when rolling LongitudinalVelocity for DeltaTime
+    float GetWheelSpinDelta(float LongitudinalVelocity, float WheelRadius, float DeltaTime);
+
+    // Blends two simulation results for rendering between physics steps
+    FMVehicleSimOutput InterpolateOutput(const FMVehicleSimOutput& From, const FMVehicleSimOutput& To, float Alpha);
+}
@@ -0,0 +1,923 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MVehicleSimulationSubsystem.h"
+#include "Chaos/SimCallbackInput.h"
+#include "Chaos/SimCallbackObject.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "PhysicsProxy/SingleParticlePhysicsProxy.h"
+#include "PBDRigidsSolver.h"
+#include "PhysicsEngine/PhysicsSettings.h"
+#include "Core/Characters/MVehicleBase.h"
+#include "Core/Physics/MVehicleWheelBatch.h"
+#include "Core/Debug/MVehicleDebug.h"
+#include "Core/Debug/MVehicleStats.h"
+#include "Core/Replay/MVehicleInputStream.h"
+#include "Core/Net/MVehicleNetPrediction.h"
+#include "Core/Telemetry/MVehicleTelemetry.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+
+static TAutoConsoleVariable<int32> CVarVehicleTelemetryBufferSamples(
+    TEXT("mp.Vehicle.Telemetry.BufferSamples"),
+    65536,
+    TEXT("Wheel samples the telemetry ring buffer holds before the writer thread has to catch up (rounded up to a power of two).\n")
+    TEXT("8 cars at 60 Hz fill 65536 in about 34 seconds."),
+    ECVF_Default);
+
+static FAutoConsoleCommandWithWorldAndArgs CmdVehicleTelemetryStart(
+    TEXT("mp.Vehicle.Telemetry.Start"),
+    TEXT("Start streaming per wheel telemetry of every vehicle, one sample per physics step. Optional argument: file path."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+    {
+        if (UMVehicleSimulationSubsystem* SimulationSubsystem = World ? World->GetSubsystem<UMVehicleSimulationSubsystem>() : nullptr)
+        {
+            SimulationSubsystem->StartTelemetry(Args.Num() > 0 ? Args[0] : FString());
+        }
+    }));
+
+static FAutoConsoleCommandWithWorld CmdVehicleTelemetryStop(
+    TEXT("mp.Vehicle.Telemetry.Stop"),
+    TEXT("Stop the vehicle telemetry and close the file."),
+    FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+    {
+        if (UMVehicleSimulationSubsystem* SimulationSubsystem = World ? World->GetSubsystem<UMVehicleSimulationSubsystem>() : nullptr)
+        {
+            SimulationSubsystem->StopTelemetry();
+        }
+    }));
+
+// --- Game thread -> physics thread ---
+struct FMVehicleAsyncVehicleInput
+{
+    int32 SlotIndex = INDEX_NONE;
+    uint32 Generation = 0;
+    FPhysicsActorHandle Proxy = nullptr;
+    FMVehicleSimInput Sim;
+    // Track in FMVehicleAsyncInput::Replay that replaces Sim.Controls
+    int32 ReplayTrack = INDEX_NONE;
+    FMVehicleNetSimInput Net;
+};
+
+struct FMVehicleAsyncInput : public Chaos::FSimCallbackInput
+{
+    // Every physics step of a frame sees the same input. One-shot network data (corrections, client inputs) is only
+    // consumed by the first step that sees a new sequence number.
+    uint64 Sequence = 0;
+    TArray<FMVehicleAsyncVehicleInput> Vehicles;
+    TSharedPtr<const FMVehicleInputStream> Replay;
+    TSharedPtr<FMVehicleTelemetryRecorder> Telemetry;
+
+    void Reset()
+    {
+        Vehicles.Reset();
+        Replay.Reset();
+        Telemetry.Reset();
+    }
+};
+
+// --- Physics thread -> game thread ---
+struct FMVehicleAsyncVehicleOutput
+{
+    int32 SlotIndex = INDEX_NONE;
+    uint32 Generation = 0;
+    FMVehicleSimOutput Sim;
+    // Driver input the step actually used
+    FMVehicleQuantizedInput Input;
+    // State for the server to replicate, see FMVehicleNetSimInput::bOutputState
+    bool bHasNetState = false;
+    FMVehicleNetState NetState;
+#if MP_VEHICLE_DEBUG
+    bool bHasDebug = false;
+    FMVehicleDebugFrame Debug;
+#endif
+};
+
+struct FMVehicleAsyncOutput : public Chaos::FSimCallbackOutput
+{
+    TArray<FMVehicleAsyncVehicleOutput> Vehicles;
+    // Time the step took on the physics thread
+    uint64 StepCycles = 0;
+    // Time the solver took after the previous step's vehicle forces: integration, collision detection and
+    // constraint solving. One step late, the solve finishes after the output is produced.
+    uint64 SolverCycles = 0;
+    // Counts the steps the callback ran, used to line recordings and replays up with physics steps
+    uint64 StepIndex = 0;
+    // The replay ran out of recorded steps
+    bool bReplayFinished = false;
+
+    void Reset()
+    {
+        Vehicles.Reset();
+        StepCycles = 0;
+        SolverCycles = 0;
+        StepIndex = 0;
+        bReplayFinished = false;
+    }
+};
+
+// Runs the wheel force model for all vehicles once per physics step
+class FMVehicleSimCallback : public Chaos::TSimCallbackObject<FMVehicleAsyncInput, FMVehicleAsyncOutput,
+    Chaos::ESimCallbackOptions::Presimulate | Chaos::ESimCallbackOptions::PostSolve>
+{
+public:
+    virtual FName GetFNameForStatId() const override
+    {
+        const static FLazyName StaticName("FMVehicleSimCallback");
+        return StaticName;
+    }
+
+private:
+    // Per vehicle state that has to survive between physics steps, owned by the physics thread.
+    // Per wheel state lives in WheelBatch.
+    struct FVehicleState
+    {
+        uint32 Generation = 0;
+        // FMVehicleAsyncInput::Sequence of the last input whose network data was consumed
+        uint64 NetSequence = 0;
+        FMVehicleControlState Controls;
+        float WheelRotation[MVehiclePhysics::NumWheels] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+        // --- Networking ---
+        // Predicted steps of an autonomous proxy, allocated the first time the vehicle is predicted
+        TUniquePtr<FMVehicleNetHistory> History;
+        // Server: client inputs waiting for their step, oldest first
+        TArray<FMVehicleNetInput> RemoteInputs;
+        // Server: client step of the input the last step consumed. Simulated proxy: input of the last snapshot.
+        uint32 RemoteStep = 0;
+        // Server: the last step consumed a client input instead of repeating the previous one, so its result
+        // belongs to RemoteStep
+        bool bRemoteStepFresh = false;
+        FMVehicleQuantizedInput RemoteInput;
+        // Input the previous step was simulated with, replicated along with its result
+        FMVehicleQuantizedInput LastInput;
+    };
+
+    // Server inputs buffered beyond this are dropped, so a client running ahead cannot add latency
+    static constexpr int32 MaxBufferedRemoteInputs = 4;
+
+    // A vehicle that takes part in the current step
+    struct FActiveVehicle
+    {
+        const FMVehicleAsyncVehicleInput* Input = nullptr;
+        Chaos::FRigidBodyHandle_Internal* Handle = nullptr;
+        FMVehicleBodyState Body;
+        FMVehicleQuantizedInput DriverInput;
+        bool bHasNetState = false;
+        FMVehicleNetState NetState;
+    };
+
+    virtual void OnPreSimulate_Internal() override
+    {
+        SCOPE_CYCLE_COUNTER(STAT_MPVehicleSimStep);
+        MP_VEHICLE_TRACE_SCOPE(MPVehicle_SimStep);
+
+        const FMVehicleAsyncInput* Input = GetConsumerInput_Internal();
+        if (Input == nullptr)
+        {
+            return;
+        }
+
+        const uint64 StartCycles = FPlatformTime::Cycles64();
+        const float DeltaTime = GetDeltaTime_Internal();
+        FMVehicleAsyncOutput& Output = GetProducerOutputData_Internal();
+        Output.Vehicles.Reset(Input->Vehicles.Num());
+
+        const uint64 StepIndex = StepCount++;
+        Output.StepIndex = StepIndex;
+        // A replay starts on the first step that sees it
+        if (Input->Replay != ActiveReplay)
+        {
+            ActiveReplay = Input->Replay;
+            ReplayStartStep = StepIndex;
+        }
+        const int32 ReplayStep = static_cast<int32>(StepIndex - ReplayStartStep);
+        Output.bReplayFinished = ActiveReplay.IsValid() && ReplayStep >= ActiveReplay->GetNumSteps();
+
+        // --- Gather: the per body work, once per vehicle ---
+        WheelBatch.BeginStep();
+        ActiveVehicles.Reset(Input->Vehicles.Num());
+        for (const FMVehicleAsyncVehicleInput& VehicleInput : Input->Vehicles)
+        {
+            Chaos::FRigidBodyHandle_Internal* Handle = VehicleInput.Proxy ? VehicleInput.Proxy->GetPhysicsThreadAPI() : nullptr;
+            if (Handle == nullptr)
+            {
+                continue;
+            }
+
+            const int32 SlotIndex = VehicleInput.SlotIndex;
+            if (!States.IsValidIndex(SlotIndex))
+            {
+                States.SetNum(SlotIndex + 1);
+                WheelBatch.SetNumVehicles(SlotIndex + 1);
+            }
+            FVehicleState& State = States[SlotIndex];
+            if (State.Generation != VehicleInput.Generation)
+            {
+                State = FVehicleState();
+                State.Generation = VehicleInput.Generation;
+                WheelBatch.ResetVehicle(SlotIndex);
+            }
+
+            const FMVehicleSimInput& Sim = VehicleInput.Sim;
+            const FMVehicleNetSimInput& Net = VehicleInput.Net;
+            const bool bNewNetInput = State.NetSequence != Input->Sequence;
+            State.NetSequence = Input->Sequence;
+
+            // The body as the solver left it, i.e. the result of the previous step
+            FMVehicleNetState PreviousState = ReadNetState(SlotIndex, State, Handle);
+
+            // --- Network: reconcile with the server before this step's input is applied ---
+            bool bHasNetState = false;
+            FMVehicleNetState NetState;
+            if (Net.Role == EMVehicleNetRole::AutonomousProxy)
+            {
+                ReconcileAutonomousProxy(SlotIndex, State, VehicleInput, bNewNetInput, Handle, PreviousState, DeltaTime);
+            }
+            else if (Net.Role == EMVehicleNetRole::SimulatedProxy)
+            {
+                if (Net.bHasCorrection && bNewNetInput)
+                {
+                    // Snap to the snapshot and keep driving with the input it was simulated with
+                    WriteNetState(SlotIndex, State, Handle, Net.Correction);
+                    PreviousState = Net.Correction;
+                    State.RemoteInput = Net.Correction.Input;
+                }
+            }
+            else if (Net.bOutputState && (Net.Role != EMVehicleNetRole::ServerRemote || State.bRemoteStepFresh))
+            {
+                // Remote cars are labelled with the client's step so the client can find its prediction. A step that
+                // repeated a late input was not the client's step, so it is not sent.
+                bHasNetState = true;
+                NetState = PreviousState;
+                NetState.Step = Net.Role == EMVehicleNetRole::ServerRemote ? State.RemoteStep : static_cast<uint32>(StepIndex);
+            }
+
+            // Live input is quantized too, so a recording replays exactly what was simulated
+            FMVehicleQuantizedInput DriverInput;
+            if (ActiveReplay.IsValid() && VehicleInput.ReplayTrack != INDEX_NONE)
+            {
+                DriverInput = ActiveReplay->GetInput(VehicleInput.ReplayTrack, ReplayStep);
+            }
+            else if (Net.Role == EMVehicleNetRole::ServerRemote)
+            {
+                DriverInput = ConsumeRemoteInput(State, Net, bNewNetInput);
+            }
+            else if (Net.Role == EMVehicleNetRole::SimulatedProxy)
+            {
+                DriverInput = State.RemoteInput;
+            }
+            else
+            {
+                DriverInput = FMVehicleQuantizedInput::Quantize(Sim.Controls);
+            }
+
+            State.LastInput = DriverInput;
+
+            if (Net.Role == EMVehicleNetRole::AutonomousProxy)
+            {
+                FMVehicleNetHistoryEntry& Entry = State.History->Add(static_cast<uint32>(StepIndex));
+                Entry.Input = DriverInput;
+                FMemory::Memcpy(Entry.Contacts, Sim.Contacts, sizeof(Entry.Contacts));
+            }
+
+            const FMVehicleControlInput Controls = DriverInput.ToControlInput();
+            MVehiclePhysics::UpdateControls(Sim.Params, Controls, State.Controls, DeltaTime);
+
+            FMVehicleBodyState Body;
+            Body.Location = PreviousState.Location;
+            Body.Rotation = PreviousState.Rotation;
+            Body.LinearVelocity = PreviousState.LinearVelocity;
+            Body.AngularVelocity = PreviousState.AngularVelocity;
+            Body.CenterOfMass = Body.Location + Body.Rotation.RotateVector(Handle->CenterOfMass());
+
+            WheelBatch.SetVehicle(SlotIndex, Sim, Controls, State.Controls, Body);
+            ActiveVehicles.Add({&VehicleInput, Handle, Body, DriverInput, bHasNetState, NetState});
+        }
+
+        INC_DWORD_STAT_BY(STAT_MPVehicleSimulated, ActiveVehicles.Num());
+
+        // --- All wheels of all vehicles in one pass ---
+        {
+            SCOPE_CYCLE_COUNTER(STAT_MPVehicleForces);
+            MP_VEHICLE_TRACE_SCOPE(MPVehicle_WheelBatch);
+            WheelBatch.Compute(DeltaTime);
+        }
+
+        // --- Scatter: one force and torque per body ---
+        for (const FActiveVehicle& ActiveVehicle : ActiveVehicles)
+        {
+            const int32 SlotIndex = ActiveVehicle.Input->SlotIndex;
+            const FMVehicleBatchVehicle& BatchVehicle = WheelBatch.Vehicles[SlotIndex];
+            ActiveVehicle.Handle->AddForce(FVector(BatchVehicle.Force));
+            ActiveVehicle.Handle->AddTorque(FVector(BatchVehicle.Torque));
+            INC_DWORD_STAT_BY(STAT_MPVehicleAddForceCalls, 2);
+
+            FVehicleState& State = States[SlotIndex];
+            FMVehicleAsyncVehicleOutput& VehicleOutput = Output.Vehicles.AddDefaulted_GetRef();
+            VehicleOutput.SlotIndex = SlotIndex;
+            VehicleOutput.Generation = ActiveVehicle.Input->Generation;
+            VehicleOutput.Sim.Controls = State.Controls;
+            VehicleOutput.Input = ActiveVehicle.DriverInput;
+            VehicleOutput.bHasNetState = ActiveVehicle.bHasNetState;
+            VehicleOutput.NetState = ActiveVehicle.NetState;
+
+            for (int32 WheelIndex = 0; WheelIndex < MVehiclePhysics::NumWheels; WheelIndex++)
+            {
+                const int32 Lane = FMVehicleWheelBatch::GetLane(SlotIndex, WheelIndex);
+                const bool bGrounded = WheelBatch.Grounded[Lane] > 0.0f;
+                if (bGrounded)
+                {
+                    State.WheelRotation[WheelIndex] = FRotator::NormalizeAxis(State.WheelRotation[WheelIndex] +
+                        MVehiclePhysics::GetWheelSpinDelta(WheelBatch.LongitudinalVelocity[Lane], BatchVehicle.Params.WheelRadius, DeltaTime));
+                }
+
+                VehicleOutput.Sim.SpringLength[WheelIndex] = WheelBatch.SpringLength[Lane];
+                VehicleOutput.Sim.WheelRotation[WheelIndex] = State.WheelRotation[WheelIndex];
+                VehicleOutput.Sim.bGrounded[WheelIndex] = bGrounded;
+            }
+
+#if MP_VEHICLE_DEBUG
+            if (ActiveVehicle.Input->Sim.bRecordDebug)
+            {
+                RecordDebugFrame(ActiveVehicle, VehicleOutput);
+            }
+#endif
+        }
+
+        if (Input->Telemetry.IsValid())
+        {
+            // A recording counts its steps from the first step that sees it
+            if (Input->Telemetry != ActiveTelemetry)
+            {
+                ActiveTelemetry = Input->Telemetry;
+                TelemetryStartStep = StepIndex;
+            }
+            RecordTelemetry(*Input->Telemetry, static_cast<uint32>(StepIndex - TelemetryStartStep));
+        }
+        else
+        {
+            ActiveTelemetry.Reset();
+        }
+
+        Output.SolverCycles = LastSolverCycles;
+        SolveStartCycles = FPlatformTime::Cycles64();
+        Output.StepCycles = SolveStartCycles - StartCycles;
+    }
+
+    // Right after the constraints are solved, closes the solver timing started at the end of the pre-simulate step
+    virtual void OnPostSolve_Internal() override
+    {
+        if (SolveStartCycles != 0)
+        {
+            LastSolverCycles = FPlatformTime::Cycles64() - SolveStartCycles;
+            SolveStartCycles = 0;
+        }
+    }
+
+    // --- Networking ---
+    FMVehicleNetState ReadNetState(int32 SlotIndex, const FVehicleState& State, const Chaos::FRigidBodyHandle_Internal* Handle) const
+    {
+        FMVehicleNetState NetState;
+        NetState.Location = Handle->X();
+        NetState.Rotation = Handle->R();
+        NetState.LinearVelocity = Handle->V();
+        NetState.AngularVelocity = Handle->W();
+        NetState.Controls = State.Controls;
+        NetState.Input = State.LastInput;
+        for (int32 WheelIndex = 0; WheelIndex < MVehiclePhysics::NumWheels; WheelIndex++)
+        {
+            NetState.SpringLength[WheelIndex] = WheelBatch.SpringLength[FMVehicleWheelBatch::GetLane(SlotIndex, WheelIndex)];
+        }
+        return NetState;
+    }
+
+    void WriteNetState(int32 SlotIndex, FVehicleState& State, Chaos::FRigidBodyHandle_Internal* Handle, const FMVehicleNetState& NetState)
+    {
+        Handle->SetX(NetState.Location);
+        Handle->SetR(NetState.Rotation);
+        Handle->SetV(NetState.LinearVelocity);
+        Handle->SetW(NetState.AngularVelocity);
+        State.Controls = NetState.Controls;
+        for (int32 WheelIndex = 0; WheelIndex < MVehiclePhysics::NumWheels; WheelIndex++)
+        {
+            WheelBatch.SpringLength[FMVehicleWheelBatch::GetLane(SlotIndex, WheelIndex)] = NetState.SpringLength[WheelIndex];
+        }
+    }
+
+    // Stores the result of the previous predicted step and, when the server disagrees with what was predicted for
+    // the step it confirmed, rewinds to the server's state and simulates the unconfirmed steps again
+    void ReconcileAutonomousProxy(int32 SlotIndex, FVehicleState& State, const FMVehicleAsyncVehicleInput& VehicleInput,
+        bool bNewNetInput, Chaos::FRigidBodyHandle_Internal* Handle, FMVehicleNetState& InOutPreviousState, float DeltaTime)
+    {
+        if (!State.History.IsValid())
+        {
+            State.History = MakeUnique<FMVehicleNetHistory>();
+        }
+        FMVehicleNetHistory& History = *State.History;
+
+        if (!History.IsEmpty())
+        {
+            FMVehicleNetHistoryEntry* Latest = History.Find(History.GetLatestStep());
+            Latest->bHasState = true;
+            Latest->State = InOutPreviousState;
+            Latest->State.Step = Latest->Step;
+            Latest->State.Input = Latest->Input;
+        }
+
+        const FMVehicleNetSimInput& Net = VehicleInput.Net;
+        if (!Net.bHasCorrection || !bNewNetInput)
+        {
+            return;
+        }
+
+        FMVehicleNetHistoryEntry* Confirmed = History.Find(Net.Correction.Step);
+        if (Confirmed == nullptr || !Confirmed->bHasState)
+        {
+            // Too old (or from before we started predicting), nothing left to replay on top of it
+            if (Net.Correction.Step > History.GetLatestStep() || History.IsEmpty())
+            {
+                return;
+            }
+            WriteNetState(SlotIndex, State, Handle, Net.Correction);
+            InOutPreviousState = Net.Correction;
+            INC_DWORD_STAT(STAT_MPVehicleNetSnaps);
+            return;
+        }
+
+        if (!MVehicleNetPrediction::NeedsCorrection(Confirmed->State, Net.Correction))
+        {
+            return;
+        }
+
+        SCOPE_CYCLE_COUNTER(STAT_MPVehicleNetResimulate);
+        MP_VEHICLE_TRACE_SCOPE(MPVehicle_NetResimulate);
+
+        FMVehicleNetBodyProperties Body;
+        Body.InvMass = Handle->InvM();
+        Body.InvInertia = FVector(Handle->InvI());
+        Body.RotationOfMass = Handle->RotationOfMass();
+        Body.CenterOfMass = Handle->CenterOfMass();
+        Body.LinearDrag = Handle->LinearEtherDrag();
+        Body.AngularDrag = Handle->AngularEtherDrag();
+        Body.GravityZ = Handle->GravityEnabled() ? Net.GravityZ : 0.0f;
+
+        FMVehicleNetState Resimulated = Net.Correction;
+        Confirmed->State = Resimulated;
+        for (uint32 Step = Net.Correction.Step + 1; Step <= History.GetLatestStep(); Step++)
+        {
+            FMVehicleNetHistoryEntry* Entry = History.Find(Step);
+            MVehicleNetPrediction::SimulateStep(VehicleInput.Sim, Body, Entry->Input, Entry->Contacts, Resimulated, DeltaTime);
+            Resimulated.Step = Step;
+            Entry->State = Resimulated;
+            INC_DWORD_STAT(STAT_MPVehicleNetResimulatedSteps);
+        }
+
+        WriteNetState(SlotIndex, State, Handle, Resimulated);
+        InOutPreviousState = Resimulated;
+        INC_DWORD_STAT(STAT_MPVehicleNetRollbacks);
+    }
+
+    // Server: the oldest buffered client input, or the last one again when the client's inputs are late
+    FMVehicleQuantizedInput ConsumeRemoteInput(FVehicleState& State, const FMVehicleNetSimInput& Net, bool bNewNetInput) const
+    {
+        if (bNewNetInput)
+        {
+            State.RemoteInputs.Append(Net.RemoteInputs.GetData(), Net.RemoteInputs.Num());
+        }
+        if (State.RemoteInputs.Num() > MaxBufferedRemoteInputs)
+        {
+            State.RemoteInputs.RemoveAt(0, State.RemoteInputs.Num() - MaxBufferedRemoteInputs, EAllowShrinking::No);
+        }
+
+        if (State.RemoteInputs.Num() > 0)
+        {
+            State.RemoteStep = State.RemoteInputs[0].Step;
+            State.RemoteInput = State.RemoteInputs[0].Input;
+            State.RemoteInputs.RemoveAt(0, 1, EAllowShrinking::No);
+            State.bRemoteStepFresh = true;
+        }
+        else
+        {
+            State.bRemoteStepFresh = false;
+        }
+        return State.RemoteInput;
+    }
+
+    // Copies this step's wheel results out of the batch, four ring buffer writes per vehicle
+    void RecordTelemetry(FMVehicleTelemetryRecorder& Recorder, uint32 Step) const
+    {
+        for (const FActiveVehicle& ActiveVehicle : ActiveVehicles)
+        {
+            const int32 SlotIndex = ActiveVehicle.Input->SlotIndex;
+            const FVehicleState& State = States[SlotIndex];
+            for (int32 WheelIndex = 0; WheelIndex < MVehiclePhysics::NumWheels; WheelIndex++)
+            {
+                const int32 Lane = FMVehicleWheelBatch::GetLane(SlotIndex, WheelIndex);
+                const bool bGrounded = WheelBatch.Grounded[Lane] > 0.0f;
+
+                FMVehicleTelemetrySample Sample;
+                Sample.Step = Step;
+                Sample.Vehicle = static_cast<uint16>(SlotIndex);
+                Sample.Wheel = static_cast<uint8>(WheelIndex);
+                Sample.bGrounded = bGrounded ? 1 : 0;
+                Sample.SpringLength = WheelBatch.SpringLength[Lane];
+                Sample.SpringVelocity = WheelBatch.SpringVelocity[Lane];
+                Sample.LongitudinalSlip = WheelBatch.LongitudinalVelocity[Lane];
+                Sample.LateralSlip = WheelBatch.LateralVelocity[Lane];
+                Sample.LongitudinalForce = bGrounded ? WheelBatch.ActiveLongitudinalForce[Lane] + WheelBatch.RollingResistanceMagnitude[Lane] +
+                    WheelBatch.RestingDragForceMagnitude[Lane] : 0.0f;
+                Sample.LateralForce = bGrounded ? WheelBatch.LateralFrictionMagnitude[Lane] : 0.0f;
+                Sample.SuspensionForce = WheelBatch.SuspensionForceMagnitude[Lane];
+                Sample.SteerAngle = MVehiclePhysics::IsFrontWheel(WheelIndex) ? State.Controls.FrontWheelSteerAngle : 0.0f;
+                Recorder.Push(Sample);
+            }
+        }
+    }
+
+#if MP_VEHICLE_DEBUG
+    void RecordDebugFrame(const FActiveVehicle& ActiveVehicle, FMVehicleAsyncVehicleOutput& VehicleOutput) const
+    {
+        const int32 SlotIndex = ActiveVehicle.Input->SlotIndex;
+        const FMVehicleBatchVehicle& BatchVehicle = WheelBatch.Vehicles[SlotIndex];
+        VehicleOutput.bHasDebug = true;
+        VehicleOutput.Debug.SteerAngle = VehicleOutput.Sim.Controls.FrontWheelSteerAngle;
+
+        for (int32 WheelIndex = 0; WheelIndex < MVehiclePhysics::NumWheels; WheelIndex++)
+        {
+            const int32 Lane = FMVehicleWheelBatch::GetLane(SlotIndex, WheelIndex);
+            const FVector Forward(WheelBatch.ForwardX[Lane], WheelBatch.ForwardY[Lane], WheelBatch.ForwardZ[Lane]);
+            const FVector Right(WheelBatch.RightX[Lane], WheelBatch.RightY[Lane], WheelBatch.RightZ[Lane]);
+            const FVector Direction(WheelBatch.DirectionX[Lane], WheelBatch.DirectionY[Lane], WheelBatch.DirectionZ[Lane]);
+            const FVector SuspensionForce = FVector(BatchVehicle.Up) * WheelBatch.SuspensionForceMagnitude[Lane];
+
+            FMVehicleDebugWheel& Wheel = VehicleOutput.Debug.Wheels[WheelIndex];
+            Wheel.bGrounded = WheelBatch.Grounded[Lane] > 0.0f;
+            Wheel.Location = ActiveVehicle.Body.CenterOfMass + FVector(WheelBatch.LeverX[Lane], WheelBatch.LeverY[Lane], WheelBatch.LeverZ[Lane]);
+            Wheel.TraceEnd = Wheel.Location + Direction * BatchVehicle.Params.GetTraceLength();
+            Wheel.SuspensionForce = SuspensionForce;
+            Wheel.TireForce = FVector(WheelBatch.ForceX[Lane], WheelBatch.ForceY[Lane], WheelBatch.ForceZ[Lane]) - SuspensionForce;
+            Wheel.WheelForward = Forward;
+            Wheel.WheelRight = Right;
+            Wheel.LateralVelocity = WheelBatch.LateralVelocity[Lane];
+            Wheel.ActiveLongitudinalForce = WheelBatch.ActiveLongitudinalForce[Lane];
+            Wheel.LateralFrictionMagnitude = WheelBatch.LateralFrictionMagnitude[Lane];
+            Wheel.RollingResistanceMagnitude = WheelBatch.RollingResistanceMagnitude[Lane];
+            Wheel.RestingDragForceMagnitude = WheelBatch.RestingDragForceMagnitude[Lane];
+            Wheel.BrakeHoldForce = WheelBatch.BrakeHoldForce[Lane];
+        }
+    }
+#endif
+
+    TArray<FVehicleState> States;
+    TArray<FActiveVehicle> ActiveVehicles;
+    FMVehicleWheelBatch WheelBatch;
+
+    uint64 StepCount = 0;
+    TSharedPtr<const FMVehicleInputStream> ActiveReplay;
+    uint64 ReplayStartStep = 0;
+    TSharedPtr<FMVehicleTelemetryRecorder> ActiveTelemetry;
+    uint64 TelemetryStartStep = 0;
+    // See FMVehicleAsyncOutput::SolverCycles
+    uint64 SolveStartCycles = 0;
+    uint64 LastSolverCycles = 0;
+};
+
+void UMVehicleSimulationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+    Super::Initialize(Collection);
+}
+
+void UMVehicleSimulationSubsystem::Deinitialize()
+{
+    StopTelemetry();
+    UnregisterSimCallback();
+    Slots.Reset();
+    FreeSlots.Reset();
+    // Recording is left for UMVehicleInputReplaySubsystem to write out when it deinitializes
+    Replay.Reset();
+
+    Super::Deinitialize();
+}
+
+void UMVehicleSimulationSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+    Super::OnWorldBeginPlay(InWorld);
+    RegisterSimCallback();
+
+    FString TelemetryPath;
+    if (FParse::Value(FCommandLine::Get(), TEXT("MPTelemetry="), TelemetryPath))
+    {
+        StartTelemetry(TelemetryPath);
+    }
+}
+
+bool UMVehicleSimulationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+    return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UMVehicleSimulationSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UMVehicleSimulationSubsystem, STATGROUP_Tickables);
+}
+
+void UMVehicleSimulationSubsystem::RegisterSimCallback()
+{
+    if (SimCallback)
+    {
+        return;
+    }
+
+    FPhysScene* PhysScene = GetWorld()->GetPhysicsScene();
+    if (PhysScene == nullptr)
+    {
+        return;
+    }
+
+    SimCallback = PhysScene->GetSolver()->CreateAndRegisterSimCallbackObject_External<FMVehicleSimCallback>();
+    PreTickHandle = PhysScene->OnPhysScenePreTick.AddUObject(this, &UMVehicleSimulationSubsystem::OnPhysScenePreTick);
+}
+
+void UMVehicleSimulationSubsystem::UnregisterSimCallback()
+{
+    if (SimCallback == nullptr)
+    {
+        return;
+    }
+
+    if (FPhysScene* PhysScene = GetWorld()->GetPhysicsScene())
+    {
+        PhysScene->OnPhysScenePreTick.Remove(PreTickHandle);
+        PhysScene->GetSolver()->UnregisterAndFreeSimCallbackObject_External(SimCallback);
+    }
+    PreTickHandle.Reset();
+    SimCallback = nullptr;
+}
+
+int32 UMVehicleSimulationSubsystem::RegisterVehicle(AMVehicleBase* Vehicle)
+{
+    // Vehicles can begin play before the world does
+    RegisterSimCallback();
+    if (SimCallback == nullptr || Vehicle == nullptr)
+    {
+        return INDEX_NONE;
+    }
+
+    const int32 SlotIndex = FreeSlots.Num() > 0 ? FreeSlots.Pop(EAllowShrinking::No) : Slots.AddDefaulted();
+    FVehicleSlot& Slot = Slots[SlotIndex];
+    const uint32 Generation = Slot.Generation + 1;
+    Slot = FVehicleSlot();
+    Slot.Vehicle = Vehicle;
+    Slot.Generation = Generation;
+    return SlotIndex;
+}
+
+void UMVehicleSimulationSubsystem::UnregisterVehicle(AMVehicleBase* Vehicle)
+{
+    for (int32 SlotIndex = 0; SlotIndex < Slots.Num(); SlotIndex++)
+    {
+        if (Slots[SlotIndex].Vehicle == Vehicle)
+        {
+            Slots[SlotIndex].Vehicle.Reset();
+            FreeSlots.Add(SlotIndex);
+            return;
+        }
+    }
+}
+
+void UMVehicleSimulationSubsystem::OnPhysScenePreTick(FPhysScene* PhysScene, float DeltaTime)
+{
+    if (SimCallback == nullptr)
+    {
+        return;
+    }
+
+    MP_VEHICLE_TRACE_SCOPE(MPVehicle_GatherSimulationInput);
+
+    FMVehicleAsyncInput* AsyncInput = SimCallback->GetProducerInputData_External();
+    AsyncInput->Sequence = ++InputSequence;
+    AsyncInput->Vehicles.Reset(Slots.Num());
+    AsyncInput->Replay = Replay;
+    AsyncInput->Telemetry = Telemetry;
+
+    for (int32 SlotIndex = 0; SlotIndex < Slots.Num(); SlotIndex++)
+    {
+        const FVehicleSlot& Slot = Slots[SlotIndex];
+        AMVehicleBase* Vehicle = Slot.Vehicle.Get();
+        if (Vehicle == nullptr || !Vehicle->IsUsingFixedStepSimulation())
+        {
+            continue;
+        }
+
+        const FBodyInstance* BodyInstance = Vehicle->BodyMeshC ? Vehicle->BodyMeshC->GetBodyInstance() : nullptr;
+        if (BodyInstance == nullptr || BodyInstance->GetPhysicsActorHandle() == nullptr)
+        {
+            continue;
+        }
+
+        FMVehicleAsyncVehicleInput& VehicleInput = AsyncInput->Vehicles.AddDefaulted_GetRef();
+        VehicleInput.SlotIndex = SlotIndex;
+        VehicleInput.Generation = Slot.Generation;
+        VehicleInput.Proxy = BodyInstance->GetPhysicsActorHandle();
+        Vehicle->GatherSimulationInput(VehicleInput.Sim);
+        Vehicle->GatherNetworkInput(VehicleInput.Net);
+        VehicleInput.ReplayTrack = Replay.IsValid() ? Replay->FindTrack(Vehicle->GetName()) : INDEX_NONE;
+    }
+}
+
+void UMVehicleSimulationSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    if (SimCallback == nullptr)
+    {
+        return;
+    }
+
+    // Keep the two newest results per vehicle
+    uint64 StepCycles = 0;
+    uint64 SolverCycles = 0;
+    bool bReplayFinished = false;
+    while (Chaos::TSimCallbackOutputHandle<FMVehicleAsyncOutput> AsyncOutput = SimCallback->PopOutputData_External())
+    {
+        StepCycles += AsyncOutput->StepCycles;
+        SolverCycles += AsyncOutput->SolverCycles;
+        bReplayFinished |= AsyncOutput->bReplayFinished;
+        if (Recording.IsValid())
+        {
+            RecordStep(*AsyncOutput);
+        }
+
+        for (const FMVehicleAsyncVehicleOutput& VehicleOutput : AsyncOutput->Vehicles)
+        {
+            if (!Slots.IsValidIndex(VehicleOutput.SlotIndex) || Slots[VehicleOutput.SlotIndex].Generation != VehicleOutput.Generation)
+            {
+                continue;
+            }
+
+            FVehicleSlot& Slot = Slots[VehicleOutput.SlotIndex];
+            Slot.PreviousOutput = Slot.LatestOutput;
+            Slot.PreviousTime = Slot.LatestTime;
+            Slot.LatestOutput = VehicleOutput.Sim;
+            Slot.LatestTime = AsyncOutput->InternalTime;
+            Slot.NumOutputs++;
+
+            AMVehicleBase* Vehicle = Slot.Vehicle.Get();
+            if (Vehicle == nullptr)
+            {
+                continue;
+            }
+
+            Vehicle->ApplyNetworkOutput(static_cast<uint32>(AsyncOutput->StepIndex), VehicleOutput.Input,
+                VehicleOutput.bHasNetState ? &VehicleOutput.NetState : nullptr);
+
+#if MP_VEHICLE_DEBUG
+            if (VehicleOutput.bHasDebug)
+            {
+                Vehicle->RecordDebugFrame(VehicleOutput.Debug);
+            }
+#endif
+        }
+    }
+    LastFrameStepSeconds = FPlatformTime::ToSeconds64(StepCycles);
+    LastFrameSolverSeconds = FPlatformTime::ToSeconds64(SolverCycles);
+
+    if (bReplayFinished && Replay.IsValid())
+    {
+        StopReplay();
+        OnReplayFinished.Broadcast();
+    }
+
+    MP_VEHICLE_TRACE_SCOPE(MPVehicle_ApplySimulationOutputs);
+
+    if (GetWorld()->GetNetMode() == NM_Client)
+    {
+        for (const FVehicleSlot& Slot : Slots)
+        {
+            if (AMVehicleBase* Vehicle = Slot.Vehicle.Get())
+            {
+                Vehicle->SendPredictedInputs();
+            }
+        }
+    }
+
+    // Physics results are rendered slightly in the past when async physics is on, blend the wheels to match
+    const double ResultsTime = GetWorld()->GetPhysicsScene()->GetSolver()->GetPhysicsResultsTime_External();
+
+    for (FVehicleSlot& Slot : Slots)
+    {
+        AMVehicleBase* Vehicle = Slot.Vehicle.Get();
+        if (Vehicle == nullptr || Slot.NumOutputs == 0 || !Vehicle->IsUsingFixedStepSimulation())
+        {
+            continue;
+        }
+
+        float Alpha = 1.0f;
+        if (Slot.NumOutputs > 1 && Slot.LatestTime > Slot.PreviousTime)
+        {
+            Alpha = FMath::Clamp(static_cast<float>((ResultsTime - Slot.PreviousTime) / (Slot.LatestTime - Slot.PreviousTime)), 0.0f, 1.0f);
+        }
+        Vehicle->ApplySimulationOutput(MVehiclePhysics::InterpolateOutput(Slot.PreviousOutput, Slot.LatestOutput, Alpha));
+    }
+}
+
+void UMVehicleSimulationSubsystem::StartRecording()
+{
+    Recording = MakeShared<FMVehicleInputStream>();
+    Recording->MapName = GetWorld()->GetMapName();
+    Recording->FixedDeltaTime = UPhysicsSettings::Get()->AsyncFixedTimeStepSize;
+    RecordingStartStep = INDEX_NONE;
+    for (FVehicleSlot& Slot : Slots)
+    {
+        Slot.RecordingTrack = INDEX_NONE;
+    }
+}
+
+TSharedPtr<FMVehicleInputStream> UMVehicleSimulationSubsystem::StopRecording()
+{
+    TSharedPtr<FMVehicleInputStream> Result = MoveTemp(Recording);
+    Recording.Reset();
+    return Result;
+}
+
+void UMVehicleSimulationSubsystem::RecordStep(const FMVehicleAsyncOutput& AsyncOutput)
+{
+    if (RecordingStartStep == INDEX_NONE)
+    {
+        RecordingStartStep = static_cast<int64>(AsyncOutput.StepIndex);
+    }
+    const int32 Step = static_cast<int32>(static_cast<int64>(AsyncOutput.StepIndex) - RecordingStartStep);
+
+    for (const FMVehicleAsyncVehicleOutput& VehicleOutput : AsyncOutput.Vehicles)
+    {
+        if (!Slots.IsValidIndex(VehicleOutput.SlotIndex) || Slots[VehicleOutput.SlotIndex].Generation != VehicleOutput.Generation)
+        {
+            continue;
+        }
+
+        FVehicleSlot& Slot = Slots[VehicleOutput.SlotIndex];
+        const AMVehicleBase* Vehicle = Slot.Vehicle.Get();
+        if (Vehicle == nullptr)
+        {
+            continue;
+        }
+
+        if (Slot.RecordingTrack == INDEX_NONE)
+        {
+            Slot.RecordingTrack = Recording->Tracks.AddDefaulted();
+            Recording->Tracks[Slot.RecordingTrack].VehicleName = Vehicle->GetName();
+            Recording->Tracks[Slot.RecordingTrack].FirstStep = Step;
+        }
+
+        // Steps the vehicle sat out (e.g. its body was not ready) repeat its last input
+        FMVehicleInputTrack& Track = Recording->Tracks[Slot.RecordingTrack];
+        const FMVehicleQuantizedInput LastInput = Track.Inputs.Num() > 0 ? Track.Inputs.Last() : FMVehicleQuantizedInput();
+        while (Track.FirstStep + Track.Inputs.Num() < Step)
+        {
+            Track.Inputs.Add(LastInput);
+        }
+        Track.Inputs.Add(VehicleOutput.Input);
+    }
+}
+
+void UMVehicleSimulationSubsystem::StartReplay(TSharedPtr<const FMVehicleInputStream> Stream)
+{
+    Replay = MoveTemp(Stream);
+}
+
+void UMVehicleSimulationSubsystem::StopReplay()
+{
+    Replay.Reset();
+}
+
+bool UMVehicleSimulationSubsystem::StartTelemetry(const FString& FilePath)
+{
+    StopTelemetry();
+
+    FMVehicleTelemetryRecorder::FHeader Header;
+    Header.StepSeconds = UPhysicsSettings::Get()->AsyncFixedTimeStepSize;
+    Header.MapName = GetWorld()->GetMapName();
+    for (int32 SlotIndex = 0; SlotIndex < Slots.Num(); SlotIndex++)
+    {
+        const AMVehicleBase* Vehicle = Slots[SlotIndex].Vehicle.Get();
+        Header.VehicleNames.Add(Vehicle ? Vehicle->GetName() : FString::Printf(TEXT("Slot%d"), SlotIndex));
+    }
+
+    const FString TelemetryPath = FilePath.IsEmpty()
+        ? FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Telemetry"), FString::Printf(TEXT("%s_%s.mptelemetry"), *Header.MapName, *FDateTime::Now().ToString()))
+        : FilePath;
+    Telemetry = FMVehicleTelemetryRecorder::Start(TelemetryPath, Header, CVarVehicleTelemetryBufferSamples.GetValueOnGameThread());
+    return Telemetry.IsValid();
+}
+
+void UMVehicleSimulationSubsystem::StopTelemetry()
+{
+    if (Telemetry.IsValid())
+    {
+        // The physics thread may still hold a reference through an input in flight, its pushes are ignored from here on
+        Telemetry->Stop();
+        Telemetry.Reset();
+    }
+}
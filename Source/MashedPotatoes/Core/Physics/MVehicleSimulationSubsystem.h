@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PhysicsInterfaceDeclaresCore.h"
+#include "Core/Physics/MVehiclePhysics.h"
+#include "MVehicleSimulationSubsystem.generated.h"
+
+class AMVehicleBase;
+class FMVehicleSimCallback;
+class FMVehicleInputStream;
+class FMVehicleTelemetryRecorder;
+struct FMVehicleAsyncOutput;
+
+// Steps every registered vehicle's wheel force model inside Chaos' physics callback,
+// so handling runs at the fixed async physics rate (Project Settings > Physics > Tick Async Physics)
+// instead of once per rendered frame. The results come back to the game thread and are
+// interpolated to drive the wheel visuals.
+UCLASS()
+class MASHEDPOTATOES_API UMVehicleSimulationSubsystem : public UTickableWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    // USubsystem
+    virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+    virtual void Deinitialize() override;
+    // UWorldSubsystem
+    virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+    // FTickableGameObject
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+
+    // Returns the slot the vehicle is simulated in, or INDEX_NONE if there is no physics scene to step it in
+    int32 RegisterVehicle(AMVehicleBase* Vehicle);
+    void UnregisterVehicle(AMVehicleBase* Vehicle);
+
+    // Physics thread time spent in the vehicle step for the results that arrived this frame
+    double GetLastFrameStepSeconds() const { return LastFrameStepSeconds; }
+    // Physics thread time the Chaos solver spent on the same steps (integration, collisions, constraints)
+    double GetLastFrameSolverSeconds() const { return LastFrameSolverSeconds; }
+
+    // --- Input Recording and Replay (see UMVehicleInputReplaySubsystem) ---
+    // Starts capturing the quantized input every physics step consumes, per vehicle
+    void StartRecording();
+    // Stops capturing and hands back what was recorded, null if nothing was being recorded
+    TSharedPtr<FMVehicleInputStream> StopRecording();
+    bool IsRecording() const { return Recording.IsValid(); }
+    // Drives every vehicle that has a track in the stream from it, one input per physics step, ignoring live input
+    void StartReplay(TSharedPtr<const FMVehicleInputStream> Stream);
+    void StopReplay();
+    bool IsReplaying() const { return Replay.IsValid(); }
+    // Broadcast once the last step of the replay has been simulated
+    FSimpleMulticastDelegate OnReplayFinished;
+
+    // --- Telemetry (see FMVehicleTelemetryRecorder) ---
+    // Streams every wheel of every fixed-step vehicle to a file, one sample per physics step, until StopTelemetry or
+    // the end of the level. Empty FilePath picks a name in Saved/Telemetry. -MPTelemetry=<file> starts it on begin play.
+    bool StartTelemetry(const FString& FilePath);
+    void StopTelemetry();
+    bool IsRecordingTelemetry() const { return Telemetry.IsValid(); }
+
+protected:
+    virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+    struct FVehicleSlot
+    {
+        TWeakObjectPtr<AMVehicleBase> Vehicle;
+        // Bumped every time the slot is reused so the physics thread can reset its state
+        uint32 Generation = 0;
+        // The two most recent physics results, used to interpolate between steps
+        FMVehicleSimOutput PreviousOutput;
+        FMVehicleSimOutput LatestOutput;
+        double PreviousTime = 0.0;
+        double LatestTime = 0.0;
+        int32 NumOutputs = 0;
+        // Track of this vehicle in Recording, INDEX_NONE until its first recorded step
+        int32 RecordingTrack = INDEX_NONE;
+    };
+
+    // Pushes this frame's vehicle snapshots to the physics thread right before the scene is stepped
+    void OnPhysScenePreTick(FPhysScene* PhysScene, float DeltaTime);
+    void RegisterSimCallback();
+    void UnregisterSimCallback();
+    // Appends the input of one physics step to Recording
+    void RecordStep(const FMVehicleAsyncOutput& AsyncOutput);
+
+    TArray<FVehicleSlot> Slots;
+    TArray<int32> FreeSlots;
+
+    FMVehicleSimCallback* SimCallback = nullptr;
+    // Numbers the inputs pushed to SimCallback, see FMVehicleAsyncInput::Sequence
+    uint64 InputSequence = 0;
+    FDelegateHandle PreTickHandle;
+    double LastFrameStepSeconds = 0.0;
+    double LastFrameSolverSeconds = 0.0;
+
+    TSharedPtr<FMVehicleInputStream> Recording;
+    // Physics step the recording started at, INDEX_NONE until the first step arrives
+    int64 RecordingStartStep = INDEX_NONE;
+    TSharedPtr<const FMVehicleInputStream> Replay;
+    TSharedPtr<FMVehicleTelemetryRecorder> Telemetry;
+};
@@ -0,0 +1,198 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MVehicleSuspensionQuerySubsystem.h"
+#include "Engine/World.h"
+#include "Core/Characters/MVehicleBase.h"
+#include "Core/Debug/MVehicleStats.h"
+#include "Core/Significance/MVehicleSignificanceSubsystem.h"
+
+static TAutoConsoleVariable<bool> CVarAsyncSuspensionTraces(
+    TEXT("mp.Vehicle.AsyncSuspensionTraces"),
+    true,
+    TEXT("Batch all vehicle suspension rays into async traces that resolve one frame later.\n")
+    TEXT("0 makes every vehicle trace its own wheels synchronously in Tick."),
+    ECVF_Default);
+
+bool UMVehicleSuspensionQuerySubsystem::IsEnabled()
+{
+    return CVarAsyncSuspensionTraces.GetValueOnGameThread();
+}
+
+void UMVehicleSuspensionQuerySubsystem::Deinitialize()
+{
+    Vehicles.Reset();
+    FreeSlots.Reset();
+
+    Super::Deinitialize();
+}
+
+bool UMVehicleSuspensionQuerySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+    return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UMVehicleSuspensionQuerySubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UMVehicleSuspensionQuerySubsystem, STATGROUP_Tickables);
+}
+
+int32 UMVehicleSuspensionQuerySubsystem::RegisterVehicle(AMVehicleBase* Vehicle)
+{
+    if (Vehicle == nullptr)
+    {
+        return INDEX_NONE;
+    }
+
+    // A reused slot drops the previous vehicle's pending traces, their results are simply never read
+    const int32 SlotIndex = FreeSlots.Num() > 0 ? FreeSlots.Pop(EAllowShrinking::No) : Vehicles.AddDefaulted();
+    FVehicleQueries& Queries = Vehicles[SlotIndex];
+    Queries = FVehicleQueries();
+    Queries.Vehicle = Vehicle;
+    // Spread the refreshes of low LOD vehicles over frames
+    Queries.FramesUntilRefresh = SlotIndex % UMVehicleSignificanceSubsystem::GetContactRefreshInterval(EMVehicleSimulationLOD::Minimal);
+    return SlotIndex;
+}
+
+void UMVehicleSuspensionQuerySubsystem::UnregisterVehicle(AMVehicleBase* Vehicle)
+{
+    for (int32 SlotIndex = 0; SlotIndex < Vehicles.Num(); SlotIndex++)
+    {
+        if (Vehicles[SlotIndex].Vehicle == Vehicle)
+        {
+            // Outstanding traces are retired by the next ResolveQueries
+            Vehicles[SlotIndex].Vehicle.Reset();
+            Vehicles[SlotIndex].bHasResults = false;
+            FreeSlots.Add(SlotIndex);
+            return;
+        }
+    }
+}
+
+void UMVehicleSuspensionQuerySubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    // Nobody asked for last frame's results (e.g. every vehicle is paused), still retire the handles
+    ResolveQueries();
+    IssueQueries();
+}
+
+void UMVehicleSuspensionQuerySubsystem::ResolveQueries()
+{
+    if (LastResolvedFrame == GFrameCounter)
+    {
+        return;
+    }
+    LastResolvedFrame = GFrameCounter;
+
+    SCOPE_CYCLE_COUNTER(STAT_MPSuspensionQueryDispatch);
+    MP_VEHICLE_TRACE_SCOPE(MPVehicle_ResolveSuspensionQueries);
+
+    UWorld* World = GetWorld();
+    FTraceDatum TraceDatum;
+    for (FVehicleQueries& Queries : Vehicles)
+    {
+        AMVehicleBase* Vehicle = Queries.Vehicle.Get();
+        if (!Queries.bIssued)
+        {
+            // Skipped by a lower LOD, or not requested yet; the vehicle keeps the contacts it has
+            Queries.bHasResults = Queries.bHasResults && Vehicle != nullptr;
+            continue;
+        }
+        Queries.bIssued = false;
+        Queries.bHasResults = Vehicle != nullptr;
+
+        const int32 WheelsPerRay = Queries.bAxleRays ? 2 : 1;
+        for (int32 WheelIndex = 0; WheelIndex < MVehiclePhysics::NumWheels; WheelIndex += WheelsPerRay)
+        {
+            FTraceHandle& Handle = Queries.Handles[WheelIndex];
+            if (!Handle.IsValid() || !World->QueryTraceData(Handle, TraceDatum))
+            {
+                // The request got dropped; the vehicle traces on its own this frame
+                Queries.bHasResults = false;
+                Handle.Invalidate();
+                continue;
+            }
+            Handle.Invalidate();
+
+            if (Vehicle == nullptr)
+            {
+                continue;
+            }
+
+            const FMVehicleWheelContact Contact = Vehicle->MakeWheelContact(FHitResult::GetFirstBlockingHit(TraceDatum.OutHits));
+            // An axle ray stands in for both of its wheels, each one reprojects the hit plane onto its own ray
+            for (int32 RayWheelIndex = WheelIndex; RayWheelIndex < WheelIndex + WheelsPerRay; RayWheelIndex++)
+            {
+                Vehicle->SetWheelContact(RayWheelIndex, Contact);
+            }
+        }
+    }
+}
+
+void UMVehicleSuspensionQuerySubsystem::IssueQueries()
+{
+    if (!IsEnabled())
+    {
+        // Kept contacts would be stale by the time batching is turned back on
+        for (FVehicleQueries& Queries : Vehicles)
+        {
+            Queries.bHasResults = false;
+        }
+        return;
+    }
+
+    SCOPE_CYCLE_COUNTER(STAT_MPSuspensionQueryDispatch);
+    MP_VEHICLE_TRACE_SCOPE(MPVehicle_IssueSuspensionQueries);
+
+    UWorld* World = GetWorld();
+    for (FVehicleQueries& Queries : Vehicles)
+    {
+        const AMVehicleBase* Vehicle = Queries.Vehicle.Get();
+        if (Vehicle == nullptr || !Vehicle->HasActorBegunPlay())
+        {
+            continue;
+        }
+
+        // Lower LODs refresh their contacts every few frames
+        const EMVehicleSimulationLOD LOD = Vehicle->GetSimulationLOD();
+        const int32 RefreshInterval = UMVehicleSignificanceSubsystem::GetContactRefreshInterval(LOD);
+        Queries.FramesUntilRefresh = FMath::Min(Queries.FramesUntilRefresh, RefreshInterval - 1);
+        if (Queries.FramesUntilRefresh-- > 0)
+        {
+            continue;
+        }
+        Queries.FramesUntilRefresh = RefreshInterval - 1;
+
+        // A car that has barely moved since its last results keeps reprojecting them
+        if (Queries.bHasResults && Vehicle->CanReuseWheelContact(0) && Vehicle->CanReuseWheelContact(1) &&
+            Vehicle->CanReuseWheelContact(2) && Vehicle->CanReuseWheelContact(3))
+        {
+            continue;
+        }
+        Queries.bIssued = true;
+        Queries.bAxleRays = LOD == EMVehicleSimulationLOD::Minimal;
+
+        FVector Starts[MVehiclePhysics::NumWheels], Ends[MVehiclePhysics::NumWheels];
+        FCollisionShape Shape;
+        for (int32 WheelIndex = 0; WheelIndex < MVehiclePhysics::NumWheels; WheelIndex++)
+        {
+            Vehicle->GetWheelContactQuery(WheelIndex, Starts[WheelIndex], Ends[WheelIndex], Shape);
+        }
+
+        const int32 WheelsPerRay = Queries.bAxleRays ? 2 : 1;
+        for (int32 WheelIndex = 0; WheelIndex < MVehiclePhysics::NumWheels; WheelIndex += WheelsPerRay)
+        {
+            // Axle rays start halfway between the axle's two wheels (FL/FR, RL/RR)
+            const FVector Start = Queries.bAxleRays ? (Starts[WheelIndex] + Starts[WheelIndex + 1]) * 0.5 : Starts[WheelIndex];
+            const FVector End = Queries.bAxleRays ? (Ends[WheelIndex] + Ends[WheelIndex + 1]) * 0.5 : Ends[WheelIndex];
+            Queries.Handles[WheelIndex] = Shape.IsLine()
+                ? World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Start, End, ECC_Visibility,
+                    Vehicle->GetSuspensionQueryParams(), FCollisionResponseParams())
+                : World->AsyncSweepByChannel(EAsyncTraceType::Single, Start, End, FQuat::Identity, ECC_Visibility, Shape,
+                    Vehicle->GetSuspensionQueryParams(), FCollisionResponseParams());
+            INC_DWORD_STAT(STAT_MPSuspensionRays);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "Core/Physics/MVehiclePhysics.h"
+#include "MVehicleSuspensionQuerySubsystem.generated.h"
+
+class AMVehicleBase;
+
+// Issues the suspension rays (or sphere sweeps) of every vehicle as one batch of async traces at the end of the frame.
+// The results are collected once at the start of the next frame and handed to each vehicle's force step,
+// which reprojects them onto the wheel's current pose.
+UCLASS()
+class MASHEDPOTATOES_API UMVehicleSuspensionQuerySubsystem : public UTickableWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    // USubsystem
+    virtual void Deinitialize() override;
+    // FTickableGameObject
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+
+    // Returns the vehicle's slot, which it passes to HasResults
+    int32 RegisterVehicle(AMVehicleBase* Vehicle);
+    void UnregisterVehicle(AMVehicleBase* Vehicle);
+
+    // Copies last frame's trace results into the vehicles. Only does work the first time it is called in a frame.
+    void ResolveQueries();
+
+    // True if the vehicle's contacts come from this subsystem this frame, false means it should trace itself
+    bool HasResults(int32 Slot) const { return Vehicles.IsValidIndex(Slot) && Vehicles[Slot].bHasResults; }
+
+    // Whether batched async traces are enabled (mp.Vehicle.AsyncSuspensionTraces)
+    static bool IsEnabled();
+
+protected:
+    virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+    struct FVehicleQueries
+    {
+        TWeakObjectPtr<AMVehicleBase> Vehicle;
+        FTraceHandle Handles[MVehiclePhysics::NumWheels];
+        // Results from the previous frame were copied into the vehicle
+        bool bHasResults = false;
+        // Rays were requested last frame; lower LODs skip frames and keep their previous contacts
+        bool bIssued = false;
+        // One ray per axle in Handles[0] and Handles[2], shared by both wheels of the axle
+        bool bAxleRays = false;
+        // Frames left before the rays are requested again
+        int32 FramesUntilRefresh = 0;
+    };
+
+    // Requests this frame's rays for every vehicle
+    void IssueQueries();
+
+    // Indexed by slot, unregistered vehicles leave their slot to the next one
+    TArray<FVehicleQueries> Vehicles;
+    TArray<int32> FreeSlots;
+    uint64 LastResolvedFrame = 0;
+};
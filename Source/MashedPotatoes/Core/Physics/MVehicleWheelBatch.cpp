@@ -0,0 +1,308 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MVehicleWheelBatch.h"
+#include "Math/VectorRegister.h"
+#include "Async/ParallelFor.h"
+
+static TAutoConsoleVariable<bool> CVarVehicleParallelForces(
+    TEXT("mp.Vehicle.ParallelForces"),
+    false,
+    TEXT("Spread the wheel force kernel over task graph workers when enough vehicles are simulated. Off until a benchmark shows a vehicle count where it beats the physics thread alone."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarVehicleParallelForcesBatchSize(
+    TEXT("mp.Vehicle.ParallelForces.BatchSize"),
+    4,
+    TEXT("Vehicles per worker task. Below two batches the kernel runs on the physics thread alone."),
+    ECVF_Default);
+
+namespace
+{
+    template <typename FunctionType>
+    void ForEachWheelArray(FMVehicleWheelBatch& Batch, FunctionType Function)
+    {
+        FMVehicleWheelBatch::FFloatArray* Arrays[] =
+        {
+            &Batch.LeverX, &Batch.LeverY, &Batch.LeverZ,
+            &Batch.DirectionX, &Batch.DirectionY, &Batch.DirectionZ,
+            &Batch.ContactX, &Batch.ContactY, &Batch.ContactZ,
+            &Batch.NormalX, &Batch.NormalY, &Batch.NormalZ,
+            &Batch.HasContact, &Batch.SweepRadius,
+            &Batch.ForwardX, &Batch.ForwardY, &Batch.ForwardZ,
+            &Batch.RightX, &Batch.RightY, &Batch.RightZ,
+            &Batch.SpringLength,
+            &Batch.Grounded, &Batch.SpringVelocity, &Batch.SuspensionForceMagnitude, &Batch.LongitudinalVelocity, &Batch.LateralVelocity,
+            &Batch.ActiveLongitudinalForce, &Batch.BrakeHoldForce, &Batch.LateralFrictionMagnitude,
+            &Batch.RollingResistanceMagnitude, &Batch.RestingDragForceMagnitude,
+            &Batch.ForceX, &Batch.ForceY, &Batch.ForceZ,
+        };
+        for (FMVehicleWheelBatch::FFloatArray* Array : Arrays)
+        {
+            Function(*Array);
+        }
+    }
+
+    FORCEINLINE VectorRegister4Float Dot3(const VectorRegister4Float& AX, const VectorRegister4Float& AY, const VectorRegister4Float& AZ,
+        const VectorRegister4Float& BX, const VectorRegister4Float& BY, const VectorRegister4Float& BZ)
+    {
+        return VectorMultiplyAdd(AZ, BZ, VectorMultiplyAdd(AY, BY, VectorMultiply(AX, BX)));
+    }
+
+    FORCEINLINE float SumLanes(const VectorRegister4Float& Vector)
+    {
+        alignas(16) float Lanes[4];
+        VectorStoreAligned(Vector, Lanes);
+        return Lanes[0] + Lanes[1] + Lanes[2] + Lanes[3];
+    }
+}
+
+void FMVehicleWheelBatch::SetNumVehicles(int32 InNumVehicles)
+{
+    const int32 NumLanes = InNumVehicles * MVehiclePhysics::NumWheels;
+    ForEachWheelArray(*this, [NumLanes](FFloatArray& Array) { Array.SetNumZeroed(NumLanes); });
+    Vehicles.SetNum(InNumVehicles);
+}
+
+void FMVehicleWheelBatch::ResetVehicle(int32 VehicleIndex)
+{
+    const int32 FirstLane = GetLane(VehicleIndex, 0);
+    ForEachWheelArray(*this, [FirstLane](FFloatArray& Array)
+    {
+        FMemory::Memzero(&Array[FirstLane], sizeof(float) * MVehiclePhysics::NumWheels);
+    });
+    Vehicles[VehicleIndex] = FMVehicleBatchVehicle();
+}
+
+void FMVehicleWheelBatch::BeginStep()
+{
+    for (FMVehicleBatchVehicle& Vehicle : Vehicles)
+    {
+        Vehicle.bActive = false;
+    }
+}
+
+void FMVehicleWheelBatch::SetVehicle(int32 VehicleIndex, const FMVehicleSimInput& Input, const FMVehicleControlInput& DriverInput, const FMVehicleControlState& Controls,
+    const FMVehicleBodyState& Body)
+{
+    FMVehicleBatchVehicle& Vehicle = Vehicles[VehicleIndex];
+    Vehicle.bActive = true;
+    Vehicle.Params = Input.Params;
+    Vehicle.Controls = DriverInput;
+    Vehicle.ForwardAxisValue = Controls.ForwardAxisValue;
+    Vehicle.LinearVelocity = FVector3f(Body.LinearVelocity);
+    Vehicle.AngularVelocity = FVector3f(Body.AngularVelocity);
+    Vehicle.Up = FVector3f(Body.Rotation.GetUpVector());
+
+    // Ground aligned frames are the same for both front wheels and both rear wheels, work them out once
+    FVector carForwardOnGround = Body.Rotation.GetForwardVector();
+    carForwardOnGround.Z = 0.0f;
+    carForwardOnGround.Normalize();
+    const FVector frontForward = carForwardOnGround.RotateAngleAxis(Controls.FrontWheelSteerAngle, FVector::UpVector).GetSafeNormal();
+    const FVector frontRight = FVector::CrossProduct(FVector::UpVector, frontForward).GetSafeNormal();
+    const FVector rearRight = FVector::CrossProduct(FVector::UpVector, carForwardOnGround).GetSafeNormal();
+
+    for (int32 WheelIndex = 0; WheelIndex < MVehiclePhysics::NumWheels; WheelIndex++)
+    {
+        const int32 Lane = GetLane(VehicleIndex, WheelIndex);
+        const FMVehicleWheelSetup& Setup = Input.Wheels[WheelIndex];
+        const FMVehicleWheelContact& Contact = Input.Contacts[WheelIndex];
+
+        // Subtract in double precision, the kernel only ever sees body relative offsets
+        const FVector WheelLocation = Body.Location + Body.Rotation.RotateVector(Setup.LocalOffset);
+        const FVector3f Lever(WheelLocation - Body.CenterOfMass);
+        const FVector3f Direction(Body.Rotation.RotateVector(Setup.LocalDirection));
+        const FVector3f ContactOffset(Contact.ImpactPoint - WheelLocation);
+        const FVector3f Normal(Contact.ImpactNormal);
+        const bool bFront = MVehiclePhysics::IsFrontWheel(WheelIndex);
+        FVector3f Forward(bFront ? frontForward : carForwardOnGround);
+        FVector3f Right(bFront ? frontRight : rearRight);
+        if (Input.Params.bContactNormalFrame)
+        {
+            // Each wheel has its own contact plane, so the shared frames above do not apply
+            FVector WheelForward, WheelRight;
+            MVehiclePhysics::GetTireFrame(WheelIndex, Input.Params, Body.Rotation, Controls.FrontWheelSteerAngle, Contact, WheelForward, WheelRight);
+            Forward = FVector3f(WheelForward);
+            Right = FVector3f(WheelRight);
+        }
+
+        LeverX[Lane] = Lever.X; LeverY[Lane] = Lever.Y; LeverZ[Lane] = Lever.Z;
+        DirectionX[Lane] = Direction.X; DirectionY[Lane] = Direction.Y; DirectionZ[Lane] = Direction.Z;
+        ContactX[Lane] = ContactOffset.X; ContactY[Lane] = ContactOffset.Y; ContactZ[Lane] = ContactOffset.Z;
+        NormalX[Lane] = Normal.X; NormalY[Lane] = Normal.Y; NormalZ[Lane] = Normal.Z;
+        HasContact[Lane] = Contact.bBlockingHit ? 1.0f : 0.0f;
+        SweepRadius[Lane] = Contact.SweepRadius;
+        ForwardX[Lane] = Forward.X; ForwardY[Lane] = Forward.Y; ForwardZ[Lane] = Forward.Z;
+        RightX[Lane] = Right.X; RightY[Lane] = Right.Y; RightZ[Lane] = Right.Z;
+    }
+}
+
+void FMVehicleWheelBatch::Compute(float DeltaTime)
+{
+    // Every vehicle only touches its own four lanes, so vehicles can be split over workers freely and the result
+    // is the same bit for bit as the serial loop. Forces are applied to the bodies afterwards, serially, by the caller.
+    const int32 BatchSize = FMath::Max(CVarVehicleParallelForcesBatchSize.GetValueOnAnyThread(), 1);
+    if (CVarVehicleParallelForces.GetValueOnAnyThread() && Vehicles.Num() >= 2 * BatchSize)
+    {
+        ParallelFor(TEXT("MPVehicle.WheelBatch"), Vehicles.Num(), BatchSize, [this, DeltaTime](int32 VehicleIndex)
+        {
+            ComputeVehicle(VehicleIndex, DeltaTime);
+        });
+        return;
+    }
+
+    for (int32 VehicleIndex = 0; VehicleIndex < Vehicles.Num(); VehicleIndex++)
+    {
+        ComputeVehicle(VehicleIndex, DeltaTime);
+    }
+}
+
+void FMVehicleWheelBatch::ComputeVehicle(int32 VehicleIndex, float DeltaTime)
+{
+    const VectorRegister4Float Zero = VectorZeroFloat();
+    const VectorRegister4Float One = VectorOneFloat();
+    const VectorRegister4Float MinusOne = VectorNegate(One);
+    const VectorRegister4Float ParallelLimit = VectorSetFloat1(-KINDA_SMALL_NUMBER);
+    const VectorRegister4Float InvDeltaTime = VectorSetFloat1(DeltaTime > 0.0f ? 1.0f / DeltaTime : 0.0f);
+    // Propulsion only goes to the rear wheels (lanes 2 and 3)
+    const VectorRegister4Float RearMask = VectorCompareGT(MakeVectorRegister(0.0f, 0.0f, 1.0f, 1.0f), Zero);
+
+    FMVehicleBatchVehicle& Vehicle = Vehicles[VehicleIndex];
+    Vehicle.Force = FVector3f::ZeroVector;
+    Vehicle.Torque = FVector3f::ZeroVector;
+    if (!Vehicle.bActive)
+    {
+        return;
+    }
+
+    const int32 Lane = GetLane(VehicleIndex, 0);
+    const FMVehicleForceParams& Params = Vehicle.Params;
+
+    // --- Contact: intersect this step's ray (or sphere) with the cached contact plane ---
+    const VectorRegister4Float NormX = VectorLoadAligned(&NormalX[Lane]);
+    const VectorRegister4Float NormY = VectorLoadAligned(&NormalY[Lane]);
+    const VectorRegister4Float NormZ = VectorLoadAligned(&NormalZ[Lane]);
+    const VectorRegister4Float DirectionDotNormal = Dot3(VectorLoadAligned(&DirectionX[Lane]), VectorLoadAligned(&DirectionY[Lane]), VectorLoadAligned(&DirectionZ[Lane]), NormX, NormY, NormZ);
+    const VectorRegister4Float ContactDotNormal = Dot3(VectorLoadAligned(&ContactX[Lane]), VectorLoadAligned(&ContactY[Lane]), VectorLoadAligned(&ContactZ[Lane]), NormX, NormY, NormZ);
+    // Clamp the divisor so parallel rays do not divide by zero, those lanes are masked out below.
+    // Swept contacts are offset by their radius on both ends, ray lanes add zero.
+    const VectorRegister4Float Radius = VectorLoadAligned(&SweepRadius[Lane]);
+    const VectorRegister4Float Distance = VectorAdd(VectorDivide(VectorAdd(ContactDotNormal, Radius), VectorMin(DirectionDotNormal, ParallelLimit)), Radius);
+
+    VectorRegister4Float GroundedMask = VectorCompareGT(VectorLoadAligned(&HasContact[Lane]), Zero);
+    GroundedMask = VectorBitwiseAnd(GroundedMask, VectorCompareLE(DirectionDotNormal, ParallelLimit));
+    GroundedMask = VectorBitwiseAnd(GroundedMask, VectorCompareGE(Distance, Zero));
+    GroundedMask = VectorBitwiseAnd(GroundedMask, VectorCompareLE(Distance, VectorSetFloat1(Params.GetTraceLength())));
+
+    // --- Suspension Force ---
+    const VectorRegister4Float MaxLength = VectorSetFloat1(Params.GetMaxLength());
+    const VectorRegister4Float PrevSpringLength = VectorLoadAligned(&SpringLength[Lane]);
+    const VectorRegister4Float ClampedSpringLength = VectorMin(VectorMax(VectorSubtract(Distance, VectorSetFloat1(Params.WheelRadius)), VectorSetFloat1(Params.GetMinLength())), MaxLength);
+    const VectorRegister4Float NewSpringLength = VectorSelect(GroundedMask, ClampedSpringLength, MaxLength);
+    const VectorRegister4Float NewSpringVelocity = VectorSelect(GroundedMask, VectorMultiply(VectorSubtract(PrevSpringLength, NewSpringLength), InvDeltaTime), Zero);
+    const VectorRegister4Float SuspensionMagnitude = VectorMultiplyAdd(NewSpringVelocity, VectorSetFloat1(Params.DamperForceConst),
+        VectorMultiply(VectorSubtract(VectorSetFloat1(Params.RestLength), NewSpringLength), VectorSetFloat1(Params.SpringForceConst)));
+
+    // --- Slip Velocities: body velocity at the wheel is v + w x r ---
+    const VectorRegister4Float RX = VectorLoadAligned(&LeverX[Lane]);
+    const VectorRegister4Float RY = VectorLoadAligned(&LeverY[Lane]);
+    const VectorRegister4Float RZ = VectorLoadAligned(&LeverZ[Lane]);
+    const VectorRegister4Float WX = VectorSetFloat1(Vehicle.AngularVelocity.X);
+    const VectorRegister4Float WY = VectorSetFloat1(Vehicle.AngularVelocity.Y);
+    const VectorRegister4Float WZ = VectorSetFloat1(Vehicle.AngularVelocity.Z);
+    const VectorRegister4Float VelX = VectorAdd(VectorSetFloat1(Vehicle.LinearVelocity.X), VectorSubtract(VectorMultiply(WY, RZ), VectorMultiply(WZ, RY)));
+    const VectorRegister4Float VelY = VectorAdd(VectorSetFloat1(Vehicle.LinearVelocity.Y), VectorSubtract(VectorMultiply(WZ, RX), VectorMultiply(WX, RZ)));
+    const VectorRegister4Float VelZ = VectorAdd(VectorSetFloat1(Vehicle.LinearVelocity.Z), VectorSubtract(VectorMultiply(WX, RY), VectorMultiply(WY, RX)));
+
+    const VectorRegister4Float FwdX = VectorLoadAligned(&ForwardX[Lane]);
+    const VectorRegister4Float FwdY = VectorLoadAligned(&ForwardY[Lane]);
+    const VectorRegister4Float FwdZ = VectorLoadAligned(&ForwardZ[Lane]);
+    const VectorRegister4Float RgtX = VectorLoadAligned(&RightX[Lane]);
+    const VectorRegister4Float RgtY = VectorLoadAligned(&RightY[Lane]);
+    const VectorRegister4Float RgtZ = VectorLoadAligned(&RightZ[Lane]);
+    const VectorRegister4Float Longitudinal = Dot3(VelX, VelY, VelZ, FwdX, FwdY, FwdZ);
+    const VectorRegister4Float Lateral = Dot3(VelX, VelY, VelZ, RgtX, RgtY, RgtZ);
+    const VectorRegister4Float AbsLongitudinal = VectorAbs(Longitudinal);
+
+    // --- Propulsion / Braking (branch per vehicle, not per wheel) ---
+    const FMVehicleHandlingTables* Handling = Params.Handling.Get();
+    VectorRegister4Float Active = Zero;
+    VectorRegister4Float BrakeHold = Zero;
+    if (Vehicle.Controls.bBrakeApplied)
+    {
+        const VectorRegister4Float Sign = VectorSelect(VectorCompareGT(Longitudinal, Zero), One, VectorSelect(VectorCompareLT(Longitudinal, Zero), MinusOne, Zero));
+        const VectorRegister4Float NearlyStopped = VectorCompareLT(AbsLongitudinal, VectorSetFloat1(Params.BrakeStopThresholdVelocity));
+        const VectorRegister4Float BrakeShare = Handling ? VectorLoad(Handling->BrakeShare) : One;
+        BrakeHold = VectorSelect(NearlyStopped, VectorMultiply(Sign, VectorSetFloat1(-Params.BrakeStopForceConst)), Zero);
+        Active = VectorAdd(VectorMultiply(VectorMultiply(Longitudinal, VectorSetFloat1(-Params.BrakeConst)), BrakeShare), BrakeHold);
+    }
+    else if (Handling)
+    {
+        // Table lookups do not vectorise, four scalar samples per vehicle
+        alignas(16) float DriveForce[4];
+        VectorStoreAligned(AbsLongitudinal, DriveForce);
+        for (int32 WheelIndex = 0; WheelIndex < MVehiclePhysics::NumWheels; WheelIndex++)
+        {
+            DriveForce[WheelIndex] = Handling->SampleDriveForce(DriveForce[WheelIndex]) * Handling->DriveShare[WheelIndex];
+        }
+        Active = VectorMultiply(VectorLoadAligned(DriveForce), VectorSetFloat1(Vehicle.ForwardAxisValue));
+    }
+    else
+    {
+        Active = VectorSelect(RearMask, VectorSetFloat1(Vehicle.ForwardAxisValue * Params.ForwardForceConst), Zero);
+    }
+
+    // --- Friction ---
+    VectorRegister4Float LateralFriction;
+    if (Handling)
+    {
+        alignas(16) float Grip[4];
+        VectorStoreAligned(Lateral, Grip);
+        for (int32 WheelIndex = 0; WheelIndex < MVehiclePhysics::NumWheels; WheelIndex++)
+        {
+            Grip[WheelIndex] = -FMath::Sign(Grip[WheelIndex]) * Handling->SampleLateralGrip(FMath::Abs(Grip[WheelIndex]));
+        }
+        LateralFriction = VectorLoadAligned(Grip);
+    }
+    else
+    {
+        LateralFriction = VectorMultiply(Lateral, VectorSetFloat1(-Params.FrictionConst));
+    }
+    LateralFriction = VectorMultiply(LateralFriction, VectorSetFloat1(Params.GripScale));
+    const VectorRegister4Float RollingResistance = VectorMultiply(Longitudinal, VectorSetFloat1(-Params.DragConst));
+    VectorRegister4Float RestingDrag = Zero;
+    if (FMath::IsNearlyZero(Vehicle.Controls.ForwardAxisInput, KINDA_SMALL_NUMBER) && !Vehicle.Controls.bBrakeApplied)
+    {
+        RestingDrag = VectorSelect(VectorCompareLT(AbsLongitudinal, VectorSetFloat1(Params.StopThresholdVelocity)),
+            VectorMultiply(Longitudinal, VectorSetFloat1(-Params.RestingDragConst)), Zero);
+    }
+    const VectorRegister4Float LongitudinalTotal = VectorAdd(Active, VectorAdd(RollingResistance, RestingDrag));
+
+    // --- Combined force, airborne wheels push nothing ---
+    const VectorRegister4Float FX = VectorSelect(GroundedMask, VectorMultiplyAdd(RgtX, LateralFriction, VectorMultiplyAdd(FwdX, LongitudinalTotal, VectorMultiply(VectorSetFloat1(Vehicle.Up.X), SuspensionMagnitude))), Zero);
+    const VectorRegister4Float FY = VectorSelect(GroundedMask, VectorMultiplyAdd(RgtY, LateralFriction, VectorMultiplyAdd(FwdY, LongitudinalTotal, VectorMultiply(VectorSetFloat1(Vehicle.Up.Y), SuspensionMagnitude))), Zero);
+    const VectorRegister4Float FZ = VectorSelect(GroundedMask, VectorMultiplyAdd(RgtZ, LateralFriction, VectorMultiplyAdd(FwdZ, LongitudinalTotal, VectorMultiply(VectorSetFloat1(Vehicle.Up.Z), SuspensionMagnitude))), Zero);
+
+    // Torque around the centre of mass: r x F
+    const VectorRegister4Float TX = VectorSubtract(VectorMultiply(RY, FZ), VectorMultiply(RZ, FY));
+    const VectorRegister4Float TY = VectorSubtract(VectorMultiply(RZ, FX), VectorMultiply(RX, FZ));
+    const VectorRegister4Float TZ = VectorSubtract(VectorMultiply(RX, FY), VectorMultiply(RY, FX));
+
+    VectorStoreAligned(NewSpringLength, &SpringLength[Lane]);
+    VectorStoreAligned(VectorSelect(GroundedMask, One, Zero), &Grounded[Lane]);
+    VectorStoreAligned(NewSpringVelocity, &SpringVelocity[Lane]);
+    VectorStoreAligned(VectorSelect(GroundedMask, SuspensionMagnitude, Zero), &SuspensionForceMagnitude[Lane]);
+    VectorStoreAligned(Longitudinal, &LongitudinalVelocity[Lane]);
+    VectorStoreAligned(Lateral, &LateralVelocity[Lane]);
+    VectorStoreAligned(Active, &ActiveLongitudinalForce[Lane]);
+    VectorStoreAligned(BrakeHold, &BrakeHoldForce[Lane]);
+    VectorStoreAligned(LateralFriction, &LateralFrictionMagnitude[Lane]);
+    VectorStoreAligned(RollingResistance, &RollingResistanceMagnitude[Lane]);
+    VectorStoreAligned(RestingDrag, &RestingDragForceMagnitude[Lane]);
+    VectorStoreAligned(FX, &ForceX[Lane]);
+    VectorStoreAligned(FY, &ForceY[Lane]);
+    VectorStoreAligned(FZ, &ForceZ[Lane]);
+
+    Vehicle.Force = FVector3f(SumLanes(FX), SumLanes(FY), SumLanes(FZ));
+    Vehicle.Torque = FVector3f(SumLanes(TX), SumLanes(TY), SumLanes(TZ));
+}
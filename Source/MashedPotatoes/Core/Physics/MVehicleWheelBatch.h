@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Physics/MVehiclePhysics.h"
+
+// Per vehicle data of FMVehicleWheelBatch, everything that is shared by the four wheels
+struct FMVehicleBatchVehicle
+{
+    bool bActive = false;
+    FMVehicleForceParams Params;
+    FMVehicleControlInput Controls;
+    float ForwardAxisValue = 0.0f;
+    FVector3f LinearVelocity = FVector3f::ZeroVector;
+    // Radians per second
+    FVector3f AngularVelocity = FVector3f::ZeroVector;
+    FVector3f Up = FVector3f::UpVector;
+
+    // Sum of all wheel forces and the torque they produce around the centre of mass
+    FVector3f Force = FVector3f::ZeroVector;
+    FVector3f Torque = FVector3f::ZeroVector;
+};
+
+// Wheel state of every simulated vehicle as structure-of-arrays, four lanes (FL, FR, RL, RR) per vehicle,
+// so one VectorRegister4Float holds a whole vehicle. Positions are stored relative to the body
+// so the kernel can stay in single precision.
+struct FMVehicleWheelBatch
+{
+    using FFloatArray = TArray<float, TAlignedHeapAllocator<16>>;
+
+    // --- Per wheel inputs, refreshed every step ---
+    // Ray start relative to the centre of mass
+    FFloatArray LeverX, LeverY, LeverZ;
+    // Suspension ray direction
+    FFloatArray DirectionX, DirectionY, DirectionZ;
+    // Cached contact point relative to the ray start, and its surface normal
+    FFloatArray ContactX, ContactY, ContactZ;
+    FFloatArray NormalX, NormalY, NormalZ;
+    // 1 if the cached trace hit something, 0 otherwise
+    FFloatArray HasContact;
+    // Radius the contact was swept with, 0 for rays
+    FFloatArray SweepRadius;
+    // Ground aligned wheel frame, steering already applied
+    FFloatArray ForwardX, ForwardY, ForwardZ;
+    FFloatArray RightX, RightY, RightZ;
+
+    // --- Per wheel state kept between steps ---
+    FFloatArray SpringLength;
+
+    // --- Per wheel results ---
+    FFloatArray Grounded;
+    FFloatArray SpringVelocity;
+    FFloatArray SuspensionForceMagnitude;
+    FFloatArray LongitudinalVelocity;
+    FFloatArray LateralVelocity;
+    FFloatArray ActiveLongitudinalForce;
+    FFloatArray BrakeHoldForce;
+    FFloatArray LateralFrictionMagnitude;
+    FFloatArray RollingResistanceMagnitude;
+    FFloatArray RestingDragForceMagnitude;
+    FFloatArray ForceX, ForceY, ForceZ;
+
+    TArray<FMVehicleBatchVehicle> Vehicles;
+
+    int32 NumVehicles() const { return Vehicles.Num(); }
+    // Grows the arrays, new vehicles start inactive with zeroed state
+    void SetNumVehicles(int32 InNumVehicles);
+    // Clears the persistent state of a slot that is reused by another vehicle
+    void ResetVehicle(int32 VehicleIndex);
+    // Marks every vehicle inactive; call before filling this step's vehicles
+    void BeginStep();
+    // Does the per body work once and fills the vehicle's four lanes. DriverInput replaces Input.Controls (quantized or replayed).
+    void SetVehicle(int32 VehicleIndex, const FMVehicleSimInput& Input, const FMVehicleControlInput& DriverInput, const FMVehicleControlState& Controls,
+        const FMVehicleBodyState& Body);
+    // Suspension, propulsion/braking and friction for all active wheels in one vectorised pass, spread over
+    // task graph workers when there are enough vehicles (mp.Vehicle.ParallelForces)
+    void Compute(float DeltaTime);
+    // Compute for one vehicle, safe to run concurrently for different vehicles
+    void ComputeVehicle(int32 VehicleIndex, float DeltaTime);
+
+    // Lane of a wheel in the per wheel arrays
+    static int32 GetLane(int32 VehicleIndex, int32 WheelIndex) { return VehicleIndex * MVehiclePhysics::NumWheels + WheelIndex; }
+};
@@ -0,0 +1,293 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MRaceProgressComponent.h"
+#include "Components/SplineComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Core/Characters/MVehicleBase.h"
+#include "Core/Debug/MVehicleStats.h"
+#include "Core/Spatial/MVehicleSpatialSubsystem.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMPRace, Log, All);
+
+namespace MRaceProgress
+{
+    // Components that began play, for GetRaceProgress. Several worlds can be running in PIE.
+    TArray<TWeakObjectPtr<UMRaceProgressComponent>> ActiveComponents;
+}
+
+UMRaceProgressComponent::UMRaceProgressComponent()
+{
+    PrimaryComponentTick.bCanEverTick = true;
+    // After physics, so the cars are where this frame's step put them
+    PrimaryComponentTick.TickGroup = TG_PostPhysics;
+}
+
+void UMRaceProgressComponent::BeginPlay()
+{
+    Super::BeginPlay();
+
+    const USplineComponent* Spline = GetOwner()->FindComponentByClass<USplineComponent>();
+    if (Spline == nullptr)
+    {
+        UE_LOG(LogMPRace, Warning, TEXT("%s has no spline component, race progress is disabled"), *GetOwner()->GetName());
+        SetComponentTickEnabled(false);
+        return;
+    }
+
+    Track.Build(*Spline, SampleSpacing);
+    StartDistance = Track.WrapDistance(StartDistance);
+    MRaceProgress::ActiveComponents.Add(this);
+    UE_LOG(LogMPRace, Display, TEXT("Baked %s into %d samples over %.0f m"), *GetOwner()->GetName(), Track.NumSamples(), Track.GetLength() / 100.0f);
+
+    if (bStartRaceOnBeginPlay)
+    {
+        StartRace();
+    }
+}
+
+void UMRaceProgressComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    MRaceProgress::ActiveComponents.RemoveAll([this](const TWeakObjectPtr<UMRaceProgressComponent>& Component)
+    {
+        return !Component.IsValid() || Component.Get() == this;
+    });
+    Track.Reset();
+    Cars.Reset();
+    Standings.Reset();
+
+    Super::EndPlay(EndPlayReason);
+}
+
+UMRaceProgressComponent* UMRaceProgressComponent::GetRaceProgress(const UObject* WorldContextObject)
+{
+    const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+    for (const TWeakObjectPtr<UMRaceProgressComponent>& Component : MRaceProgress::ActiveComponents)
+    {
+        if (Component.IsValid() && Component->GetWorld() == World)
+        {
+            return Component.Get();
+        }
+    }
+    return nullptr;
+}
+
+void UMRaceProgressComponent::StartRace()
+{
+    bRaceRunning = true;
+    RaceStartTime = GetWorld()->GetTimeSeconds();
+    NumFinished = 0;
+    for (FCarState& Car : Cars)
+    {
+        const TWeakObjectPtr<AMVehicleBase> Vehicle = Car.Vehicle;
+        Car = FCarState();
+        Car.Vehicle = Vehicle;
+        Car.Progress.Vehicle = Vehicle.Get();
+    }
+}
+
+float UMRaceProgressComponent::GetRaceTime() const
+{
+    return bRaceRunning ? GetWorld()->GetTimeSeconds() - RaceStartTime : 0.0f;
+}
+
+bool UMRaceProgressComponent::GetVehicleProgress(const AMVehicleBase* Vehicle, FMRaceProgress& OutProgress) const
+{
+    for (const FCarState& Car : Cars)
+    {
+        if (Vehicle && Car.bTracked && Car.Vehicle.Get() == Vehicle)
+        {
+            OutProgress = Car.Progress;
+            return true;
+        }
+    }
+    return false;
+}
+
+void UMRaceProgressComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+    Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+    UMVehicleSpatialSubsystem* VehicleQueries = GetWorld()->GetSubsystem<UMVehicleSpatialSubsystem>();
+    if (!Track.IsValid() || VehicleQueries == nullptr)
+    {
+        return;
+    }
+
+    SCOPE_CYCLE_COUNTER(STAT_MPRaceProgress);
+    MP_VEHICLE_TRACE_SCOPE(MPRace_Progress);
+
+    const float Now = GetWorld()->GetTimeSeconds();
+    const float MaxAdvance = MaxPlausibleSpeed * DeltaTime;
+    Cars.SetNum(VehicleQueries->GetMaxVehicles());
+    for (int32 Id = 0; Id < Cars.Num(); Id++)
+    {
+        AMVehicleBase* Vehicle = VehicleQueries->GetVehicle(Id);
+        FCarState& Car = Cars[Id];
+        // The Id was freed or handed to another car
+        if (Car.Vehicle.Get() != Vehicle || (Vehicle == nullptr && Car.bTracked))
+        {
+            Car = FCarState();
+            Car.Vehicle = Vehicle;
+            Car.Progress.Vehicle = Vehicle;
+        }
+        if (Vehicle == nullptr)
+        {
+            continue;
+        }
+
+        const float LapDistance = Track.WrapDistance(Track.Project(Vehicle->GetActorLocation(), Car.HintSample) - StartDistance);
+        UpdateCar(Car, LapDistance, Now, MaxAdvance);
+    }
+
+    UpdateStandings();
+}
+
+void UMRaceProgressComponent::UpdateCar(FCarState& Car, float LapDistance, float Now, float MaxAdvance)
+{
+    FMRaceProgress& Progress = Car.Progress;
+    const float Length = Track.GetLength();
+    const float CheckpointLength = Length / NumCheckpoints;
+
+    if (!Car.bTracked)
+    {
+        // A car on the grid sits just behind the line and starts its first lap when it crosses it
+        Car.bTracked = true;
+        Progress.Lap = Track.IsClosedLoop() && LapDistance > Length * 0.5f ? 0 : 1;
+        Progress.Checkpoint = 0;
+        Car.LapStartTime = RaceStartTime;
+    }
+    else if (bRaceRunning && !Progress.bFinished)
+    {
+        const float Delta = LapDistance - Progress.LapDistance;
+        // Driven from inside the last stretch it has, so every stretch it skipped was covered since the last update
+        const int32 PreviousStretch = FMath::Min(FMath::FloorToInt32(Progress.LapDistance / CheckpointLength), NumCheckpoints - 1);
+        const bool bFromCheckpoint = PreviousStretch == Progress.Checkpoint;
+        if (Track.IsClosedLoop() && Delta < -Length * 0.5f)
+        {
+            // Forwards over the line
+            if (Progress.Lap == 0)
+            {
+                Progress.Lap = 1;
+                Progress.Checkpoint = 0;
+            }
+            else if (Progress.Checkpoint == NumCheckpoints - 1 || (bFromCheckpoint && Delta + Length <= MaxAdvance))
+            {
+                CompleteLap(Car, Now);
+            }
+            else
+            {
+                // Jumped over stretches (respawned or cut across), the same lap starts over
+                Progress.Checkpoint = 0;
+            }
+        }
+        else if (Track.IsClosedLoop() && Delta > Length * 0.5f)
+        {
+            // Backwards over the line, back into the previous lap
+            if (Progress.Lap > 0 && Progress.Checkpoint == 0)
+            {
+                Progress.Lap--;
+                Progress.Checkpoint = Progress.Lap > 0 ? NumCheckpoints - 1 : 0;
+            }
+        }
+        else if (Progress.Lap > 0)
+        {
+            // Checkpoints only count in order, each one has to be driven through. More than one at once only when the
+            // car got there from its last checkpoint at a speed it can drive, a car put further ahead gets none
+            const int32 Stretch = FMath::Min(FMath::FloorToInt32(LapDistance / CheckpointLength), NumCheckpoints - 1);
+            if (Stretch == Progress.Checkpoint + 1 || (Stretch > Progress.Checkpoint && bFromCheckpoint && Delta > 0.0f && Delta <= MaxAdvance))
+            {
+                Progress.Checkpoint = Stretch;
+            }
+
+            // Point to point tracks finish at the end of the spline instead of the line
+            if (!Track.IsClosedLoop() && Progress.Checkpoint == NumCheckpoints - 1 && LapDistance >= Length - SampleSpacing)
+            {
+                CompleteLap(Car, Now);
+            }
+        }
+    }
+
+    if (!Progress.bFinished)
+    {
+        Progress.LapDistance = LapDistance;
+        Progress.RaceDistance = (Progress.Lap - 1) * Length + LapDistance;
+        Progress.CurrentLapTime = bRaceRunning && Progress.Lap > 0 ? Now - Car.LapStartTime : 0.0f;
+    }
+}
+
+void UMRaceProgressComponent::CompleteLap(FCarState& Car, float Now)
+{
+    FMRaceProgress& Progress = Car.Progress;
+    Progress.Checkpoint = 0;
+
+    // Already reported before the car reversed over the line
+    if (Progress.Lap <= Car.LapsReported)
+    {
+        Progress.Lap++;
+        return;
+    }
+
+    const float LapTime = Now - Car.LapStartTime;
+    Car.LapsReported = Progress.Lap;
+    Car.LapStartTime = Now;
+    Progress.LastLapTime = LapTime;
+    Progress.BestLapTime = Progress.BestLapTime > 0.0f ? FMath::Min(Progress.BestLapTime, LapTime) : LapTime;
+    OnLapCompleted.Broadcast(Progress.Vehicle, Progress.Lap, LapTime);
+
+    if (!Track.IsClosedLoop() || Progress.Lap >= NumLaps)
+    {
+        NumFinished++;
+        Progress.bFinished = true;
+        Progress.FinishTime = Now - RaceStartTime;
+        Progress.Position = NumFinished;
+        Progress.CurrentLapTime = 0.0f;
+        OnVehicleFinished.Broadcast(Progress.Vehicle, Progress.Position, Progress.FinishTime);
+        return;
+    }
+    Progress.Lap++;
+}
+
+void UMRaceProgressComponent::UpdateStandings()
+{
+    SortedCars.Reset();
+    for (int32 CarIndex = 0; CarIndex < Cars.Num(); CarIndex++)
+    {
+        if (Cars[CarIndex].bTracked && Cars[CarIndex].Vehicle.IsValid())
+        {
+            SortedCars.Add(CarIndex);
+        }
+    }
+
+    // Finished cars in the order they finished, then everyone else by how far they got
+    SortedCars.Sort([this](int32 A, int32 B)
+    {
+        const FMRaceProgress& ProgressA = Cars[A].Progress;
+        const FMRaceProgress& ProgressB = Cars[B].Progress;
+        if (ProgressA.bFinished != ProgressB.bFinished)
+        {
+            return ProgressA.bFinished;
+        }
+        if (ProgressA.bFinished)
+        {
+            return ProgressA.Position < ProgressB.Position;
+        }
+        return ProgressA.RaceDistance > ProgressB.RaceDistance;
+    });
+
+    bool bOrderChanged = SortedCars.Num() != Standings.Num();
+    Standings.SetNum(SortedCars.Num());
+    for (int32 Position = 0; Position < SortedCars.Num(); Position++)
+    {
+        FMRaceProgress& Progress = Cars[SortedCars[Position]].Progress;
+        Progress.Position = Position + 1;
+        bOrderChanged |= Standings[Position].Vehicle != Progress.Vehicle;
+        Standings[Position] = Progress;
+    }
+
+    if (bOrderChanged)
+    {
+        OnStandingsChanged.Broadcast();
+    }
+}
@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Core/Race/MTrackSampleTable.h"
+#include "MRaceProgressComponent.generated.h"
+
+class AMVehicleBase;
+
+// Where one car is in the race
+USTRUCT(BlueprintType)
+struct FMRaceProgress
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category = "Race")
+    TObjectPtr<AMVehicleBase> Vehicle = nullptr;
+    // 1 is leading
+    UPROPERTY(BlueprintReadOnly, Category = "Race")
+    int32 Position = 0;
+    // Lap being driven, 0 until the car first crosses the start line
+    UPROPERTY(BlueprintReadOnly, Category = "Race")
+    int32 Lap = 0;
+    // Checkpoints reached this lap, all of them are needed for the lap to count
+    UPROPERTY(BlueprintReadOnly, Category = "Race")
+    int32 Checkpoint = 0;
+    // Distance from the start line along the track, within the lap
+    UPROPERTY(BlueprintReadOnly, Category = "Race")
+    float LapDistance = 0.0f;
+    // Distance covered since the start of the race, what positions are ranked by
+    UPROPERTY(BlueprintReadOnly, Category = "Race")
+    float RaceDistance = 0.0f;
+    UPROPERTY(BlueprintReadOnly, Category = "Race")
+    float CurrentLapTime = 0.0f;
+    // 0 until a lap was completed
+    UPROPERTY(BlueprintReadOnly, Category = "Race")
+    float LastLapTime = 0.0f;
+    UPROPERTY(BlueprintReadOnly, Category = "Race")
+    float BestLapTime = 0.0f;
+    UPROPERTY(BlueprintReadOnly, Category = "Race")
+    bool bFinished = false;
+    UPROPERTY(BlueprintReadOnly, Category = "Race")
+    float FinishTime = 0.0f;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FMRaceLapSignature, AMVehicleBase*, Vehicle, int32, Lap, float, LapTime);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FMRaceFinishSignature, AMVehicleBase*, Vehicle, int32, Position, float, RaceTime);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FMRaceStandingsSignature);
+
+// Lap, checkpoint and position tracking for every car, added to the track spline actor (bp_TrackSpline).
+// The spline is baked into a sample table at BeginPlay and every car is projected onto it once per tick, after
+// physics; checkpoints are equal stretches of the track that have to be driven through in order, so nothing
+// depends on overlap volumes. The HUD reads Standings when OnStandingsChanged or OnLapCompleted fire instead of
+// polling every frame.
+UCLASS(ClassGroup = (Race), meta = (BlueprintSpawnableComponent))
+class MASHEDPOTATOES_API UMRaceProgressComponent : public UActorComponent
+{
+    GENERATED_BODY()
+
+public:
+    UMRaceProgressComponent();
+
+    // UActorComponent
+    virtual void BeginPlay() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+    virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+    // The race progress of the world the object is in, null if the level has no track
+    UFUNCTION(BlueprintPure, Category = "Race", meta = (WorldContext = "WorldContextObject"))
+    static UMRaceProgressComponent* GetRaceProgress(const UObject* WorldContextObject);
+
+    // Resets every car's laps and times and starts the race clock
+    UFUNCTION(BlueprintCallable, Category = "Race")
+    void StartRace();
+
+    UFUNCTION(BlueprintPure, Category = "Race")
+    bool GetVehicleProgress(const AMVehicleBase* Vehicle, FMRaceProgress& OutProgress) const;
+
+    UFUNCTION(BlueprintPure, Category = "Race")
+    float GetRaceTime() const;
+
+    const FMTrackSampleTable& GetTrack() const { return Track; }
+    // Distance along the spline where laps start and end
+    float GetStartDistance() const { return StartDistance; }
+
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Race", meta = (ClampMin = "1"))
+    int32 NumLaps = 3;
+    // Stretches the track is split into for the lap to count, more catches smaller shortcuts
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Race", meta = (ClampMin = "1"))
+    int32 NumCheckpoints = 8;
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Race", meta = (ClampMin = "0"))
+    float StartDistance = 0.0f;
+    // Fastest a car can drive along the track, in cm/s. A hitch can carry a car over whole stretches in one frame,
+    // those still count while the distance covered is within this speed, anything further was a teleport
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Race", meta = (ClampMin = "0"))
+    float MaxPlausibleSpeed = 10000.0f;
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Race")
+    bool bStartRaceOnBeginPlay = true;
+    // Arc length between two samples of the track table, in cm
+    UPROPERTY(EditAnywhere, Category = "Race", meta = (ClampMin = "10"))
+    float SampleSpacing = 100.0f;
+
+    // Every car, sorted by position
+    UPROPERTY(BlueprintReadOnly, Category = "Race")
+    TArray<FMRaceProgress> Standings;
+
+    UPROPERTY(BlueprintAssignable, Category = "Race")
+    FMRaceLapSignature OnLapCompleted;
+    UPROPERTY(BlueprintAssignable, Category = "Race")
+    FMRaceFinishSignature OnVehicleFinished;
+    // The order of Standings changed, or a car joined or left
+    UPROPERTY(BlueprintAssignable, Category = "Race")
+    FMRaceStandingsSignature OnStandingsChanged;
+
+private:
+    struct FCarState
+    {
+        TWeakObjectPtr<AMVehicleBase> Vehicle;
+        FMRaceProgress Progress;
+        int32 HintSample = INDEX_NONE;
+        bool bTracked = false;
+        float LapStartTime = 0.0f;
+        // Highest lap OnLapCompleted was broadcast for, driving back over the line and across again does not repeat it
+        int32 LapsReported = 0;
+    };
+
+    // Moves one car along the track and counts its checkpoints and laps
+    // MaxAdvance is the furthest the car can have driven since the last update
+    void UpdateCar(FCarState& Car, float LapDistance, float Now, float MaxAdvance);
+    void CompleteLap(FCarState& Car, float Now);
+    // One sort of every car by race distance into Standings
+    void UpdateStandings();
+
+    FMTrackSampleTable Track;
+    // Per car, indexed by the car's spatial subsystem Id
+    TArray<FCarState> Cars;
+    TArray<int32> SortedCars;
+    bool bRaceRunning = false;
+    float RaceStartTime = 0.0f;
+    int32 NumFinished = 0;
+};
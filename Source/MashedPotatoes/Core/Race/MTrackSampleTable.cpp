@@ -0,0 +1,168 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MTrackSampleTable.h"
+#include "Components/SplineComponent.h"
+
+namespace MTrackSampleTable
+{
+    // Samples searched on either side of the hint, covers a car at several hundred km/h with the default spacing
+    constexpr int32 HintWindow = 16;
+}
+
+void FMTrackSampleTable::Reset()
+{
+    Locations.Reset();
+    Directions.Reset();
+    Length = 0.0f;
+    Spacing = 0.0f;
+    bClosedLoop = false;
+}
+
+void FMTrackSampleTable::Build(const USplineComponent& Spline, float SampleSpacing)
+{
+    Reset();
+
+    Length = Spline.GetSplineLength();
+    bClosedLoop = Spline.IsClosedLoop();
+    if (Length <= UE_KINDA_SMALL_NUMBER)
+    {
+        return;
+    }
+
+    // Closed loops do not repeat the first sample at the end
+    const int32 NumSegments = FMath::Max(FMath::CeilToInt32(Length / FMath::Max(SampleSpacing, 1.0f)), 1);
+    const int32 NumPoints = bClosedLoop ? NumSegments : NumSegments + 1;
+    Spacing = Length / NumSegments;
+
+    Locations.Reserve(NumPoints);
+    Directions.Reserve(NumPoints);
+    for (int32 SampleIndex = 0; SampleIndex < NumPoints; SampleIndex++)
+    {
+        const float Distance = SampleIndex * Spacing;
+        Locations.Add(Spline.GetLocationAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::World));
+        Directions.Add(Spline.GetDirectionAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::World));
+    }
+}
+
+int32 FMTrackSampleTable::GetNextSample(int32 SampleIndex) const
+{
+    if (SampleIndex + 1 < Locations.Num())
+    {
+        return SampleIndex + 1;
+    }
+    return bClosedLoop ? 0 : SampleIndex;
+}
+
+float FMTrackSampleTable::ProjectOntoSegment(int32 SampleIndex, const FVector& Location, float& OutDistanceSquared) const
+{
+    const FVector& Start = Locations[SampleIndex];
+    const FVector Segment = Locations[GetNextSample(SampleIndex)] - Start;
+    const float SegmentLengthSquared = Segment.SizeSquared();
+    const float Alpha = SegmentLengthSquared > UE_KINDA_SMALL_NUMBER
+        ? FMath::Clamp(FVector::DotProduct(Location - Start, Segment) / SegmentLengthSquared, 0.0f, 1.0f)
+        : 0.0f;
+    OutDistanceSquared = FVector::DistSquared(Start + Segment * Alpha, Location);
+    return (SampleIndex + Alpha) * Spacing;
+}
+
+float FMTrackSampleTable::Project(const FVector& Location, int32& HintSample, float MaxHintDistance) const
+{
+    if (!IsValid())
+    {
+        HintSample = INDEX_NONE;
+        return 0.0f;
+    }
+
+    const int32 NumPoints = Locations.Num();
+    const int32 NumSegments = bClosedLoop ? NumPoints : NumPoints - 1;
+    float BestDistance = 0.0f;
+    float BestDistanceSquared = MAX_flt;
+    int32 BestSample = INDEX_NONE;
+
+    auto SearchSegment = [this, &Location, &BestDistance, &BestDistanceSquared, &BestSample](int32 SampleIndex)
+    {
+        float DistanceSquared;
+        const float Distance = ProjectOntoSegment(SampleIndex, Location, DistanceSquared);
+        if (DistanceSquared < BestDistanceSquared)
+        {
+            BestDistance = Distance;
+            BestDistanceSquared = DistanceSquared;
+            BestSample = SampleIndex;
+        }
+    };
+
+    if (HintSample != INDEX_NONE && HintSample < NumSegments)
+    {
+        for (int32 Offset = -MTrackSampleTable::HintWindow; Offset <= MTrackSampleTable::HintWindow; Offset++)
+        {
+            int32 SampleIndex = HintSample + Offset;
+            if (bClosedLoop)
+            {
+                SampleIndex = (SampleIndex + NumSegments) % NumSegments;
+            }
+            else if (SampleIndex < 0 || SampleIndex >= NumSegments)
+            {
+                continue;
+            }
+            SearchSegment(SampleIndex);
+        }
+    }
+
+    // No hint, or the car was teleported (respawn, reset) somewhere the window does not reach
+    if (BestSample == INDEX_NONE || BestDistanceSquared > FMath::Square(MaxHintDistance))
+    {
+        for (int32 SampleIndex = 0; SampleIndex < NumSegments; SampleIndex++)
+        {
+            SearchSegment(SampleIndex);
+        }
+    }
+
+    HintSample = BestSample;
+    return WrapDistance(BestDistance);
+}
+
+float FMTrackSampleTable::WrapDistance(float Distance) const
+{
+    if (Length <= 0.0f)
+    {
+        return 0.0f;
+    }
+    if (bClosedLoop)
+    {
+        const float Wrapped = FMath::Fmod(Distance, Length);
+        return Wrapped < 0.0f ? Wrapped + Length : Wrapped;
+    }
+    return FMath::Clamp(Distance, 0.0f, Length);
+}
+
+int32 FMTrackSampleTable::GetSegment(float Distance, float& OutAlpha) const
+{
+    const float Position = WrapDistance(Distance) / Spacing;
+    const int32 NumSegments = bClosedLoop ? Locations.Num() : Locations.Num() - 1;
+    const int32 SampleIndex = FMath::Clamp(FMath::FloorToInt32(Position), 0, NumSegments - 1);
+    OutAlpha = FMath::Clamp(Position - SampleIndex, 0.0f, 1.0f);
+    return SampleIndex;
+}
+
+FVector FMTrackSampleTable::GetLocationAtDistance(float Distance) const
+{
+    if (!IsValid())
+    {
+        return FVector::ZeroVector;
+    }
+    float Alpha;
+    const int32 SampleIndex = GetSegment(Distance, Alpha);
+    return FMath::Lerp(Locations[SampleIndex], Locations[GetNextSample(SampleIndex)], Alpha);
+}
+
+FVector FMTrackSampleTable::GetDirectionAtDistance(float Distance) const
+{
+    if (!IsValid())
+    {
+        return FVector::ForwardVector;
+    }
+    float Alpha;
+    const int32 SampleIndex = GetSegment(Distance, Alpha);
+    return FMath::Lerp(Directions[SampleIndex], Directions[GetNextSample(SampleIndex)], Alpha).GetSafeNormal();
+}
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class USplineComponent;
+
+// A track spline baked into points at equal arc length. Finding the distance along the track of a car is then a
+// search over a few neighbouring samples around where the car was last frame, instead of the spline's own closest
+// point solve, and the table can be read from any thread.
+class FMTrackSampleTable
+{
+public:
+    // Samples the spline in world space every SampleSpacing cm
+    void Build(const USplineComponent& Spline, float SampleSpacing);
+    void Reset();
+
+    bool IsValid() const { return Locations.Num() >= 2; }
+    float GetLength() const { return Length; }
+    bool IsClosedLoop() const { return bClosedLoop; }
+    int32 NumSamples() const { return Locations.Num(); }
+    const FVector& GetSampleLocation(int32 SampleIndex) const { return Locations[SampleIndex]; }
+
+    // Distance along the track of the point closest to Location. HintSample is the sample returned for the same car
+    // last time (INDEX_NONE if there is none) and is updated; only when the result is further away than
+    // MaxHintDistance from the track is the whole table searched.
+    float Project(const FVector& Location, int32& HintSample, float MaxHintDistance = 2000.0f) const;
+
+    // Wrapped on closed loops, clamped otherwise
+    FVector GetLocationAtDistance(float Distance) const;
+    FVector GetDirectionAtDistance(float Distance) const;
+    // Distance with laps wrapped away, or clamped to the track on open splines
+    float WrapDistance(float Distance) const;
+
+private:
+    // Sample at or before Distance and how far towards the next one it is
+    int32 GetSegment(float Distance, float& OutAlpha) const;
+    int32 GetNextSample(int32 SampleIndex) const;
+    // Distance along the segment that starts at SampleIndex of the point closest to Location
+    float ProjectOntoSegment(int32 SampleIndex, const FVector& Location, float& OutDistanceSquared) const;
+
+    TArray<FVector> Locations;
+    TArray<FVector> Directions;
+    float Length = 0.0f;
+    // Arc length between two samples
+    float Spacing = 0.0f;
+    bool bClosedLoop = false;
+};
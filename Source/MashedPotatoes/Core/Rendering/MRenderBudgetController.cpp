@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MRenderBudgetController.h"
+
+namespace MRenderBudgetController
+{
+    struct FGPULevel
+    {
+        float ScreenPercentage;
+        int32 GlobalIlluminationQuality;
+    };
+
+    struct FCPULevel
+    {
+        float ShadowDistanceScale;
+        float FoliageDensityScale;
+    };
+
+    constexpr FGPULevel GPULevels[FMRenderBudgetController::NumGPULevels] =
+    {
+        {100.0f, 3},
+        {90.0f, 3},
+        {80.0f, 2},
+        {70.0f, 2},
+        {60.0f, 1},
+        {50.0f, 1},
+    };
+
+    constexpr FCPULevel CPULevels[FMRenderBudgetController::NumCPULevels] =
+    {
+        {1.0f, 1.0f},
+        {0.8f, 0.75f},
+        {0.6f, 0.5f},
+        {0.4f, 0.3f},
+    };
+}
+
+int32 FMRenderBudgetController::GetStartGPULevel(int32 InNumViews)
+{
+    // Every view renders at a fraction of the screen but pays Lumen and shadow setup in full
+    return InNumViews >= 3 ? 2 : InNumViews == 2 ? 1 : 0;
+}
+
+int32 FMRenderBudgetController::GetStartCPULevel(int32 InNumViews)
+{
+    return InNumViews >= 3 ? 1 : 0;
+}
+
+void FMRenderBudgetController::Reset(int32 InNumViews)
+{
+    NumViews = FMath::Max(InNumViews, 1);
+    GPULadder = FLadder();
+    GPULadder.Level = GetStartGPULevel(NumViews);
+    CPULadder = FLadder();
+    CPULadder.Level = GetStartCPULevel(NumViews);
+    bHasSamples = false;
+    UpdateBudget();
+}
+
+bool FMRenderBudgetController::Update(const FMRenderFrameTiming& Timing, float TargetFrameMs)
+{
+    if (Timing.NumViews != NumViews)
+    {
+        Reset(Timing.NumViews);
+        return true;
+    }
+
+    const float CPUMs = FMath::Max(Timing.GameThreadMs, Timing.RenderThreadMs);
+    if (!bHasSamples)
+    {
+        SmoothedGPUMs = Timing.GPUMs;
+        SmoothedCPUMs = CPUMs;
+        bHasSamples = true;
+    }
+    else
+    {
+        const float Alpha = 1.0f - FMath::Exp(-Timing.DeltaSeconds / SmoothingTime);
+        SmoothedGPUMs = FMath::Lerp(SmoothedGPUMs, Timing.GPUMs, Alpha);
+        SmoothedCPUMs = FMath::Lerp(SmoothedCPUMs, CPUMs, Alpha);
+    }
+
+    bool bChanged = false;
+    // Without GPU timings (-nullrhi, some RHIs) the GPU ladder stays where it is
+    if (Timing.GPUMs > 0.0f)
+    {
+        bChanged |= StepLadder(GPULadder, NumGPULevels, SmoothedGPUMs, TargetFrameMs, Timing.DeltaSeconds);
+    }
+    bChanged |= StepLadder(CPULadder, NumCPULevels, SmoothedCPUMs, TargetFrameMs, Timing.DeltaSeconds);
+
+    if (bChanged)
+    {
+        UpdateBudget();
+    }
+    return bChanged;
+}
+
+bool FMRenderBudgetController::StepLadder(FLadder& Ladder, int32 NumLevels, float SmoothedMs, float TargetMs, float DeltaSeconds)
+{
+    Ladder.OverSeconds = SmoothedMs > TargetMs * DownThreshold ? Ladder.OverSeconds + DeltaSeconds : 0.0f;
+    Ladder.UnderSeconds = SmoothedMs < TargetMs * UpThreshold ? Ladder.UnderSeconds + DeltaSeconds : 0.0f;
+
+    if (Ladder.OverSeconds >= DownDelay && Ladder.Level < NumLevels - 1)
+    {
+        Ladder.Level++;
+        Ladder.OverSeconds = 0.0f;
+        Ladder.UnderSeconds = 0.0f;
+        return true;
+    }
+    if (Ladder.UnderSeconds >= UpDelay && Ladder.Level > 0)
+    {
+        Ladder.Level--;
+        Ladder.OverSeconds = 0.0f;
+        Ladder.UnderSeconds = 0.0f;
+        return true;
+    }
+    return false;
+}
+
+void FMRenderBudgetController::UpdateBudget()
+{
+    const MRenderBudgetController::FGPULevel& GPULevel = MRenderBudgetController::GPULevels[GPULadder.Level];
+    const MRenderBudgetController::FCPULevel& CPULevel = MRenderBudgetController::CPULevels[CPULadder.Level];
+    Budget.GPULevel = GPULadder.Level;
+    Budget.CPULevel = CPULadder.Level;
+    Budget.ScreenPercentage = GPULevel.ScreenPercentage;
+    Budget.GlobalIlluminationQuality = GPULevel.GlobalIlluminationQuality;
+    Budget.ShadowDistanceScale = CPULevel.ShadowDistanceScale;
+    Budget.FoliageDensityScale = CPULevel.FoliageDensityScale;
+}
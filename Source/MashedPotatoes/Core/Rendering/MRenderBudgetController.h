@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// One frame as the budget controller sees it
+struct FMRenderFrameTiming
+{
+    int32 NumViews = 1;
+    float DeltaSeconds = 0.0f;
+    float GameThreadMs = 0.0f;
+    float RenderThreadMs = 0.0f;
+    // 0 when the RHI does not report it (-nullrhi)
+    float GPUMs = 0.0f;
+};
+
+// Render settings picked by the controller
+struct FMRenderBudget
+{
+    // Index into the GPU and CPU level tables, 0 is full quality
+    int32 GPULevel = 0;
+    int32 CPULevel = 0;
+    float ScreenPercentage = 100.0f;
+    // sg.GlobalIlluminationQuality, drives Lumen
+    int32 GlobalIlluminationQuality = 3;
+    float ShadowDistanceScale = 1.0f;
+    float FoliageDensityScale = 1.0f;
+};
+
+// Picks render settings that hold a target frame time. Two independent ladders: GPU time trades screen
+// percentage and Lumen quality, render/game thread time trades shadow distance and foliage density (draw calls).
+// Each ladder starts lower the more split-screen views there are, steps down quickly when over budget and climbs
+// back slowly when there is clear headroom. No engine state is touched here, so recorded traces can be fed through
+// it headless (see UMRenderBudgetSubsystem).
+class FMRenderBudgetController
+{
+public:
+    static constexpr int32 NumGPULevels = 6;
+    static constexpr int32 NumCPULevels = 4;
+
+    // Over budget this fraction above the target...
+    static constexpr float DownThreshold = 1.05f;
+    // ...for this long steps quality down
+    static constexpr float DownDelay = 0.5f;
+    // Under this fraction of the target...
+    static constexpr float UpThreshold = 0.8f;
+    // ...for this long steps quality up
+    static constexpr float UpDelay = 3.0f;
+    // Time constant of the frame time smoothing, in seconds
+    static constexpr float SmoothingTime = 0.25f;
+
+    // Starts over at the levels for a view count
+    void Reset(int32 NumViews);
+    // Feeds one frame. True if the budget changed.
+    bool Update(const FMRenderFrameTiming& Timing, float TargetFrameMs);
+
+    const FMRenderBudget& GetBudget() const { return Budget; }
+    int32 GetNumViews() const { return NumViews; }
+    float GetSmoothedGPUMs() const { return SmoothedGPUMs; }
+    float GetSmoothedCPUMs() const { return SmoothedCPUMs; }
+
+    static int32 GetStartGPULevel(int32 InNumViews);
+    static int32 GetStartCPULevel(int32 InNumViews);
+
+private:
+    struct FLadder
+    {
+        int32 Level = 0;
+        float OverSeconds = 0.0f;
+        float UnderSeconds = 0.0f;
+    };
+
+    // Moves the ladder at most one level, true if it moved
+    static bool StepLadder(FLadder& Ladder, int32 NumLevels, float SmoothedMs, float TargetMs, float DeltaSeconds);
+    void UpdateBudget();
+
+    int32 NumViews = 0;
+    FLadder GPULadder;
+    FLadder CPULadder;
+    float SmoothedGPUMs = 0.0f;
+    float SmoothedCPUMs = 0.0f;
+    bool bHasSamples = false;
+    FMRenderBudget Budget;
+};
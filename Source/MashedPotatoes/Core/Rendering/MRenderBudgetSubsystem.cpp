@@ -0,0 +1,404 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MRenderBudgetSubsystem.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "RenderCore.h"
+#include "RHI.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMPRenderBudget, Log, All);
+
+static TAutoConsoleVariable<bool> CVarRenderBudget(
+    TEXT("mp.Render.Budget"),
+    true,
+    TEXT("Scale render settings with the number of split-screen views and the measured frame time."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarRenderBudgetTargetFPS(
+    TEXT("mp.Render.Budget.TargetFPS"),
+    60.0f,
+    TEXT("Frame rate the render budget controller holds."),
+    ECVF_Default);
+
+static FAutoConsoleCommandWithWorldAndArgs CmdRenderBudgetRecordStart(
+    TEXT("mp.Render.Budget.Record.Start"),
+    TEXT("Start recording per frame view count and thread times. Optional argument: file path."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+    {
+        if (UMRenderBudgetSubsystem* BudgetSubsystem = World ? World->GetSubsystem<UMRenderBudgetSubsystem>() : nullptr)
+        {
+            BudgetSubsystem->StartRecording(Args.Num() > 0 ? Args[0] : FString());
+        }
+    }));
+
+static FAutoConsoleCommandWithWorld CmdRenderBudgetRecordStop(
+    TEXT("mp.Render.Budget.Record.Stop"),
+    TEXT("Stop recording frame times and write the trace."),
+    FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+    {
+        if (UMRenderBudgetSubsystem* BudgetSubsystem = World ? World->GetSubsystem<UMRenderBudgetSubsystem>() : nullptr)
+        {
+            BudgetSubsystem->StopRecording();
+        }
+    }));
+
+namespace MRenderBudget
+{
+    const TCHAR* TraceHeader = TEXT("NumViews,DeltaSeconds,GameThreadMs,RenderThreadMs,GPUMs");
+    // Grace on top of DownDelay before an unanswered overload counts as a failure, covers a frame or two of jitter
+    constexpr float OverloadGrace = 0.1f;
+}
+
+bool UMRenderBudgetSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+    return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UMRenderBudgetSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UMRenderBudgetSubsystem, STATGROUP_Tickables);
+}
+
+float UMRenderBudgetSubsystem::GetTargetFrameMs()
+{
+    return 1000.0f / FMath::Max(CVarRenderBudgetTargetFPS.GetValueOnGameThread(), 1.0f);
+}
+
+void UMRenderBudgetSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+    Super::OnWorldBeginPlay(InWorld);
+
+    FString TracePath;
+    if (FParse::Value(FCommandLine::Get(), TEXT("MPRenderBudgetTrace="), TracePath))
+    {
+        const bool bPassed = VerifyTrace(TracePath, GetTargetFrameMs());
+        if (FApp::IsUnattended())
+        {
+            FPlatformMisc::RequestExitWithStatus(false, bPassed ? 0 : 1);
+        }
+        return;
+    }
+
+    // Nothing to budget without a renderer
+    bActive = FApp::CanEverRender() && InWorld.GetNetMode() != NM_DedicatedServer;
+    const UGameInstance* GameInstance = InWorld.GetGameInstance();
+    Controller.Reset(GameInstance ? GameInstance->GetNumLocalPlayers() : 1);
+}
+
+void UMRenderBudgetSubsystem::Deinitialize()
+{
+    StopRecording();
+    RestoreSettings();
+    bActive = false;
+
+    Super::Deinitialize();
+}
+
+void UMRenderBudgetSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    if (!CVarRenderBudget.GetValueOnGameThread())
+    {
+        if (bApplied)
+        {
+            RestoreSettings();
+        }
+        return;
+    }
+
+    FMRenderFrameTiming Timing;
+    const UGameInstance* GameInstance = GetWorld()->GetGameInstance();
+    Timing.NumViews = FMath::Max(GameInstance ? GameInstance->GetNumLocalPlayers() : 1, 1);
+    // Real frame time, not dilated game time
+    Timing.DeltaSeconds = static_cast<float>(FApp::GetDeltaTime());
+    // Previous frame's thread times, as shown by "stat unit"
+    Timing.GameThreadMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+    Timing.RenderThreadMs = FPlatformTime::ToMilliseconds(GRenderThreadTime);
+    Timing.GPUMs = FPlatformTime::ToMilliseconds(RHIGetGPUFrameCycles());
+
+    if (bRecording)
+    {
+        Recording.Add(Timing);
+    }
+
+    if (Controller.Update(Timing, GetTargetFrameMs()) || !bApplied)
+    {
+        ApplyBudget(Controller.GetBudget());
+    }
+}
+
+void UMRenderBudgetSubsystem::ApplyBudget(const FMRenderBudget& Budget)
+{
+    SetSetting(TEXT("r.ScreenPercentage"), FString::SanitizeFloat(Budget.ScreenPercentage));
+    SetSetting(TEXT("sg.GlobalIlluminationQuality"), FString::FromInt(Budget.GlobalIlluminationQuality));
+    SetSetting(TEXT("sg.ReflectionQuality"), FString::FromInt(Budget.GlobalIlluminationQuality));
+    SetSetting(TEXT("r.Shadow.DistanceScale"), FString::SanitizeFloat(Budget.ShadowDistanceScale));
+    SetSetting(TEXT("foliage.DensityScale"), FString::SanitizeFloat(Budget.FoliageDensityScale));
+    bApplied = true;
+
+    UE_LOG(LogMPRenderBudget, Verbose, TEXT("%d views: GPU level %d (%.0f%%, GI %d), CPU level %d (shadows %.2f, foliage %.2f)"),
+        Controller.GetNumViews(), Budget.GPULevel, Budget.ScreenPercentage, Budget.GlobalIlluminationQuality,
+        Budget.CPULevel, Budget.ShadowDistanceScale, Budget.FoliageDensityScale);
+}
+
+void UMRenderBudgetSubsystem::SetSetting(const TCHAR* Name, const FString& Value)
+{
+    IConsoleVariable* Variable = IConsoleManager::Get().FindConsoleVariable(Name);
+    if (Variable == nullptr)
+    {
+        return;
+    }
+    if (!OriginalSettings.Contains(Name))
+    {
+        OriginalSettings.Add(Name, {Variable->GetString(), static_cast<EConsoleVariableFlags>(Variable->GetFlags() & ECVF_SetByMask)});
+    }
+    if (Variable->GetString() != Value)
+    {
+        Variable->Set(*Value, ECVF_SetByCode);
+    }
+}
+
+void UMRenderBudgetSubsystem::RestoreSettings()
+{
+    for (const TPair<FString, FOriginalSetting>& Setting : OriginalSettings)
+    {
+        IConsoleVariable* Variable = IConsoleManager::Get().FindConsoleVariable(*Setting.Key);
+        // Left alone when something with a higher priority than ours (the console, say) has set it since
+        if (Variable == nullptr || (Variable->GetFlags() & ECVF_SetByMask) != ECVF_SetByCode)
+        {
+            continue;
+        }
+        // Set() refuses a lower priority than the current one, so the flag is lowered first
+        Variable->SetFlags(static_cast<EConsoleVariableFlags>((Variable->GetFlags() & ~ECVF_SetByMask) | Setting.Value.SetBy));
+        Variable->Set(*Setting.Value.Value, Setting.Value.SetBy);
+    }
+    OriginalSettings.Reset();
+    bApplied = false;
+}
+
+// --- Traces ---
+
+void UMRenderBudgetSubsystem::StartRecording(const FString& FilePath)
+{
+    RecordingFilePath = FilePath.IsEmpty()
+        ? FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("RenderBudget"), FString::Printf(TEXT("%s_%s.csv"), *GetWorld()->GetMapName(), *FDateTime::Now().ToString()))
+        : FilePath;
+    Recording.Reset();
+    bRecording = true;
+    UE_LOG(LogMPRenderBudget, Display, TEXT("Recording frame times to %s"), *RecordingFilePath);
+}
+
+void UMRenderBudgetSubsystem::StopRecording()
+{
+    if (!bRecording)
+    {
+        return;
+    }
+    bRecording = false;
+
+    TArray<FString> Lines;
+    Lines.Reserve(Recording.Num() + 1);
+    Lines.Add(MRenderBudget::TraceHeader);
+    for (const FMRenderFrameTiming& Timing : Recording)
+    {
+        Lines.Add(FString::Printf(TEXT("%d,%.6f,%.3f,%.3f,%.3f"), Timing.NumViews, Timing.DeltaSeconds, Timing.GameThreadMs, Timing.RenderThreadMs, Timing.GPUMs));
+    }
+    if (FFileHelper::SaveStringArrayToFile(Lines, *RecordingFilePath))
+    {
+        UE_LOG(LogMPRenderBudget, Display, TEXT("Wrote %d frames to %s"), Recording.Num(), *RecordingFilePath);
+    }
+    else
+    {
+        UE_LOG(LogMPRenderBudget, Error, TEXT("Could not write %s"), *RecordingFilePath);
+    }
+    Recording.Reset();
+}
+
+bool UMRenderBudgetSubsystem::LoadTrace(const FString& FilePath, TArray<FMRenderFrameTiming>& OutTrace)
+{
+    TArray<FString> Lines;
+    if (!FFileHelper::LoadFileToStringArray(Lines, *FilePath) || Lines.Num() == 0 || Lines[0] != MRenderBudget::TraceHeader)
+    {
+        return false;
+    }
+
+    OutTrace.Reset(Lines.Num() - 1);
+    TArray<FString> Columns;
+    for (int32 LineIndex = 1; LineIndex < Lines.Num(); LineIndex++)
+    {
+        Lines[LineIndex].ParseIntoArray(Columns, TEXT(","));
+        if (Columns.Num() != 5)
+        {
+            continue;
+        }
+        FMRenderFrameTiming& Timing = OutTrace.AddDefaulted_GetRef();
+        Timing.NumViews = FCString::Atoi(*Columns[0]);
+        Timing.DeltaSeconds = FCString::Atof(*Columns[1]);
+        Timing.GameThreadMs = FCString::Atof(*Columns[2]);
+        Timing.RenderThreadMs = FCString::Atof(*Columns[3]);
+        Timing.GPUMs = FCString::Atof(*Columns[4]);
+    }
+    return true;
+}
+
+bool UMRenderBudgetSubsystem::VerifyTrace(const FString& FilePath, float TargetFrameMs)
+{
+    TArray<FMRenderFrameTiming> Trace;
+    if (!LoadTrace(FilePath, Trace) || Trace.Num() == 0)
+    {
+        UE_LOG(LogMPRenderBudget, Error, TEXT("%s is not a render budget trace"), *FilePath);
+        return false;
+    }
+
+    struct FLadderCheck
+    {
+        int32 Level = 0;
+        float OverloadSeconds = 0.0f;
+        // Direction (+1 lowers quality) and time of the last step
+        int32 LastStep = 0;
+        float LastStepSeconds = -MAX_flt;
+        int32 NumSteps = 0;
+        TArray<float> SecondsAtLevel;
+    };
+
+    TArray<TSharedPtr<FJsonValue>> Violations;
+    auto AddViolation = [&Violations](int32 Frame, const FString& Message)
+    {
+        UE_LOG(LogMPRenderBudget, Warning, TEXT("Frame %d: %s"), Frame, *Message);
+        TSharedRef<FJsonObject> Violation = MakeShared<FJsonObject>();
+        Violation->SetNumberField(TEXT("Frame"), Frame);
+        Violation->SetStringField(TEXT("Message"), Message);
+        Violations.Add(MakeShared<FJsonValueObject>(Violation));
+    };
+
+    // One ladder's decision this frame against the smoothed time it was made on
+    auto CheckLadder = [&AddViolation, TargetFrameMs](FLadderCheck& Check, const TCHAR* Name, int32 Level, int32 NumLevels, float SmoothedMs,
+        float Seconds, float DeltaSeconds, int32 Frame)
+    {
+        Check.SecondsAtLevel.SetNumZeroed(NumLevels);
+        Check.SecondsAtLevel[Level] += DeltaSeconds;
+
+        const int32 Step = FMath::Sign(Level - Check.Level);
+        if (Step != 0)
+        {
+            if (Step < 0 && SmoothedMs > TargetFrameMs)
+            {
+                AddViolation(Frame, FString::Printf(TEXT("%s quality raised at %.2f ms, over the %.2f ms target"), Name, SmoothedMs, TargetFrameMs));
+            }
+            // Dropping again right after a raise is the controller probing for headroom, raising right after a drop is oscillation
+            if (Step < 0 && Check.LastStep > 0 && Seconds - Check.LastStepSeconds < FMRenderBudgetController::UpDelay)
+            {
+                AddViolation(Frame, FString::Printf(TEXT("%s quality raised %.2f s after it was lowered"), Name, Seconds - Check.LastStepSeconds));
+            }
+            Check.LastStep = Step;
+            Check.LastStepSeconds = Seconds;
+            Check.NumSteps++;
+            Check.OverloadSeconds = 0.0f;
+        }
+        else if (SmoothedMs > TargetFrameMs * FMRenderBudgetController::DownThreshold && Level < NumLevels - 1)
+        {
+            Check.OverloadSeconds += DeltaSeconds;
+            if (Check.OverloadSeconds > FMRenderBudgetController::DownDelay + MRenderBudget::OverloadGrace)
+            {
+                AddViolation(Frame, FString::Printf(TEXT("%s over budget for %.2f s without lowering quality"), Name, Check.OverloadSeconds));
+                Check.OverloadSeconds = 0.0f;
+            }
+        }
+        else
+        {
+            Check.OverloadSeconds = 0.0f;
+        }
+        Check.Level = Level;
+    };
+
+    FMRenderBudgetController TraceController;
+    TraceController.Reset(Trace[0].NumViews);
+    FLadderCheck GPUCheck;
+    FLadderCheck CPUCheck;
+    GPUCheck.Level = TraceController.GetBudget().GPULevel;
+    CPUCheck.Level = TraceController.GetBudget().CPULevel;
+    float Seconds = 0.0f;
+
+    for (int32 Frame = 0; Frame < Trace.Num(); Frame++)
+    {
+        const FMRenderFrameTiming& Timing = Trace[Frame];
+        const bool bViewsChanged = Timing.NumViews != TraceController.GetNumViews();
+        TraceController.Update(Timing, TargetFrameMs);
+        Seconds += Timing.DeltaSeconds;
+        const FMRenderBudget& Budget = TraceController.GetBudget();
+
+        if (bViewsChanged)
+        {
+            // A new view count starts over at its own levels, no history carries across
+            if (Budget.GPULevel != FMRenderBudgetController::GetStartGPULevel(Timing.NumViews) ||
+                Budget.CPULevel != FMRenderBudgetController::GetStartCPULevel(Timing.NumViews))
+            {
+                AddViolation(Frame, FString::Printf(TEXT("%d views did not start at their levels"), Timing.NumViews));
+            }
+            GPUCheck.Level = Budget.GPULevel;
+            GPUCheck.LastStep = 0;
+            GPUCheck.OverloadSeconds = 0.0f;
+            CPUCheck.Level = Budget.CPULevel;
+            CPUCheck.LastStep = 0;
+            CPUCheck.OverloadSeconds = 0.0f;
+            continue;
+        }
+
+        if (Timing.GPUMs > 0.0f)
+        {
+            CheckLadder(GPUCheck, TEXT("GPU"), Budget.GPULevel, FMRenderBudgetController::NumGPULevels, TraceController.GetSmoothedGPUMs(),
+                Seconds, Timing.DeltaSeconds, Frame);
+        }
+        CheckLadder(CPUCheck, TEXT("CPU"), Budget.CPULevel, FMRenderBudgetController::NumCPULevels, TraceController.GetSmoothedCPUMs(),
+            Seconds, Timing.DeltaSeconds, Frame);
+    }
+
+    // --- Report ---
+    auto LadderReport = [](const FLadderCheck& Check)
+    {
+        TSharedRef<FJsonObject> Ladder = MakeShared<FJsonObject>();
+        Ladder->SetNumberField(TEXT("Steps"), Check.NumSteps);
+        Ladder->SetNumberField(TEXT("FinalLevel"), Check.Level);
+        TArray<TSharedPtr<FJsonValue>> SecondsAtLevel;
+        for (const float LevelSeconds : Check.SecondsAtLevel)
+        {
+            SecondsAtLevel.Add(MakeShared<FJsonValueNumber>(LevelSeconds));
+        }
+        Ladder->SetArrayField(TEXT("SecondsAtLevel"), SecondsAtLevel);
+        return Ladder;
+    };
+
+    const bool bPassed = Violations.Num() == 0;
+    TSharedRef<FJsonObject> Report = MakeShared<FJsonObject>();
+    Report->SetStringField(TEXT("Trace"), FilePath);
+    Report->SetNumberField(TEXT("Frames"), Trace.Num());
+    Report->SetNumberField(TEXT("Seconds"), Seconds);
+    Report->SetNumberField(TEXT("TargetFrameMs"), TargetFrameMs);
+    Report->SetObjectField(TEXT("GPU"), LadderReport(GPUCheck));
+    Report->SetObjectField(TEXT("CPU"), LadderReport(CPUCheck));
+    Report->SetArrayField(TEXT("Violations"), Violations);
+    Report->SetBoolField(TEXT("Passed"), bPassed);
+
+    FString Json;
+    const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+    FJsonSerializer::Serialize(Report, Writer);
+    const FString ReportPath = FPaths::ChangeExtension(FilePath, TEXT("report.json"));
+    if (!FFileHelper::SaveStringToFile(Json, *ReportPath))
+    {
+        UE_LOG(LogMPRenderBudget, Error, TEXT("Could not write %s"), *ReportPath);
+    }
+
+    UE_LOG(LogMPRenderBudget, Display, TEXT("%s: %d frames, %d GPU and %d CPU steps, %d violations, %s"), *FilePath, Trace.Num(),
+        GPUCheck.NumSteps, CPUCheck.NumSteps, Violations.Num(), bPassed ? TEXT("passed") : TEXT("FAILED"));
+    return bPassed;
+}
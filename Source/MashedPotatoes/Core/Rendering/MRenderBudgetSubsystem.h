@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HAL/IConsoleManager.h"
+#include "Core/Rendering/MRenderBudgetController.h"
+#include "MRenderBudgetSubsystem.generated.h"
+
+// Holds mp.Render.Budget.TargetFPS by scaling screen percentage, Lumen quality, shadow distance and foliage density
+// with the number of split-screen views and the measured GPU and render/game thread times (FMRenderBudgetController).
+// The settings it drives are put back when the level ends or mp.Render.Budget is turned off.
+//
+// Record a frame time trace while playing, written to Saved/RenderBudget:
+//   mp.Render.Budget.Record.Start [file]  /  mp.Render.Budget.Record.Stop
+// Check the controller's decisions against a trace without rendering:
+//   UnrealEditor-Cmd MashedPotatoes.uproject /Game/Maps/Lvl_VehicleBasic -game -nullrhi -unattended
+//       -MPRenderBudgetTrace=Saved/RenderBudget/Trace.csv
+// The JSON report goes next to the trace and the process exits with 1 if a check failed: staying over budget without
+// lowering quality, raising quality while over budget, or raising it again within UpDelay of lowering it.
+UCLASS()
+class MASHEDPOTATOES_API UMRenderBudgetSubsystem : public UTickableWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    // USubsystem
+    virtual void Deinitialize() override;
+    // UWorldSubsystem
+    virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+    // FTickableGameObject
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+    virtual bool IsTickable() const override { return bActive; }
+
+    // Empty FilePath picks a name in Saved/RenderBudget
+    void StartRecording(const FString& FilePath);
+    void StopRecording();
+
+    // Feeds a recorded trace through a fresh controller and checks every decision it makes. Writes a JSON report
+    // next to the trace, true if every check passed.
+    static bool VerifyTrace(const FString& FilePath, float TargetFrameMs);
+
+    const FMRenderBudget& GetBudget() const { return Controller.GetBudget(); }
+
+protected:
+    virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+    struct FOriginalSetting
+    {
+        FString Value;
+        // Who had set it (ECVF_SetByScalability, ECVF_SetByConsole...), it goes back to that priority
+        EConsoleVariableFlags SetBy = ECVF_SetByConstructor;
+    };
+
+    static bool LoadTrace(const FString& FilePath, TArray<FMRenderFrameTiming>& OutTrace);
+    static float GetTargetFrameMs();
+
+    void ApplyBudget(const FMRenderBudget& Budget);
+    void SetSetting(const TCHAR* Name, const FString& Value);
+    void RestoreSettings();
+
+    bool bActive = false;
+    bool bApplied = false;
+    FMRenderBudgetController Controller;
+    // Values of the console variables the controller drives, from before it first changed them
+    TMap<FString, FOriginalSetting> OriginalSettings;
+
+    bool bRecording = false;
+    FString RecordingFilePath;
+    TArray<FMRenderFrameTiming> Recording;
+};
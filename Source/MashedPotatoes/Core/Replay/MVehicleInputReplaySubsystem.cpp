@@ -0,0 +1,160 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MVehicleInputReplaySubsystem.h"
+#include "Engine/World.h"
+#include "PhysicsEngine/PhysicsSettings.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Core/Physics/MVehicleSimulationSubsystem.h"
+#include "Core/Replay/MVehicleInputStream.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMPVehicleReplay, Log, All);
+
+static FAutoConsoleCommandWithWorldAndArgs CmdVehicleRecordStart(
+    TEXT("mp.Vehicle.Record.Start"),
+    TEXT("Start recording the input of every vehicle. Optional argument: file path."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+    {
+        if (UMVehicleInputReplaySubsystem* ReplaySubsystem = World ? World->GetSubsystem<UMVehicleInputReplaySubsystem>() : nullptr)
+        {
+            ReplaySubsystem->StartRecording(Args.Num() > 0 ? Args[0] : FString());
+        }
+    }));
+
+static FAutoConsoleCommandWithWorld CmdVehicleRecordStop(
+    TEXT("mp.Vehicle.Record.Stop"),
+    TEXT("Stop recording vehicle input and write the file."),
+    FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+    {
+        if (UMVehicleInputReplaySubsystem* ReplaySubsystem = World ? World->GetSubsystem<UMVehicleInputReplaySubsystem>() : nullptr)
+        {
+            ReplaySubsystem->StopRecording();
+        }
+    }));
+
+static FAutoConsoleCommandWithWorldAndArgs CmdVehicleReplay(
+    TEXT("mp.Vehicle.Replay"),
+    TEXT("Drive the vehicles from a recorded input file. Argument: file path."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+    {
+        UMVehicleInputReplaySubsystem* ReplaySubsystem = World ? World->GetSubsystem<UMVehicleInputReplaySubsystem>() : nullptr;
+        if (ReplaySubsystem && Args.Num() > 0)
+        {
+            ReplaySubsystem->StartReplay(Args[0]);
+        }
+    }));
+
+bool UMVehicleInputReplaySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+    return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UMVehicleInputReplaySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+    Super::Initialize(Collection);
+    Collection.InitializeDependency<UMVehicleSimulationSubsystem>();
+}
+
+void UMVehicleInputReplaySubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+    Super::OnWorldBeginPlay(InWorld);
+
+    FString FilePath;
+    if (FParse::Value(FCommandLine::Get(), TEXT("MPReplayInput="), FilePath))
+    {
+        StartReplay(FilePath);
+    }
+    else if (FParse::Value(FCommandLine::Get(), TEXT("MPRecordInput="), FilePath))
+    {
+        StartRecording(FilePath);
+    }
+}
+
+void UMVehicleInputReplaySubsystem::Deinitialize()
+{
+    // Leaving the level finishes the recording
+    StopRecording();
+
+    if (UMVehicleSimulationSubsystem* SimulationSubsystem = GetWorld()->GetSubsystem<UMVehicleSimulationSubsystem>())
+    {
+        SimulationSubsystem->OnReplayFinished.Remove(ReplayFinishedHandle);
+    }
+    ReplayFinishedHandle.Reset();
+
+    Super::Deinitialize();
+}
+
+void UMVehicleInputReplaySubsystem::StartRecording(const FString& FilePath)
+{
+    UMVehicleSimulationSubsystem* SimulationSubsystem = GetWorld()->GetSubsystem<UMVehicleSimulationSubsystem>();
+    if (SimulationSubsystem == nullptr)
+    {
+        return;
+    }
+
+    RecordingFilePath = FilePath.IsEmpty()
+        ? FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("VehicleInput"), FString::Printf(TEXT("%s_%s.mpinput"), *GetWorld()->GetMapName(), *FDateTime::Now().ToString()))
+        : FilePath;
+    SimulationSubsystem->StartRecording();
+    UE_LOG(LogMPVehicleReplay, Display, TEXT("Recording vehicle input to %s"), *RecordingFilePath);
+}
+
+void UMVehicleInputReplaySubsystem::StopRecording()
+{
+    UMVehicleSimulationSubsystem* SimulationSubsystem = GetWorld()->GetSubsystem<UMVehicleSimulationSubsystem>();
+    if (SimulationSubsystem == nullptr || !SimulationSubsystem->IsRecording())
+    {
+        return;
+    }
+
+    if (TSharedPtr<FMVehicleInputStream> Recording = SimulationSubsystem->StopRecording())
+    {
+        Recording->SaveToFile(RecordingFilePath);
+    }
+    RecordingFilePath.Reset();
+}
+
+bool UMVehicleInputReplaySubsystem::StartReplay(const FString& FilePath)
+{
+    UMVehicleSimulationSubsystem* SimulationSubsystem = GetWorld()->GetSubsystem<UMVehicleSimulationSubsystem>();
+    if (SimulationSubsystem == nullptr)
+    {
+        return false;
+    }
+
+    TSharedRef<FMVehicleInputStream> Stream = MakeShared<FMVehicleInputStream>();
+    if (!Stream->LoadFromFile(FilePath))
+    {
+        return false;
+    }
+
+    if (Stream->MapName != GetWorld()->GetMapName())
+    {
+        UE_LOG(LogMPVehicleReplay, Warning, TEXT("%s was recorded on %s, replaying on %s"), *FilePath, *Stream->MapName, *GetWorld()->GetMapName());
+    }
+    if (!FMath::IsNearlyEqual(Stream->FixedDeltaTime, UPhysicsSettings::Get()->AsyncFixedTimeStepSize))
+    {
+        UE_LOG(LogMPVehicleReplay, Warning, TEXT("%s was recorded with a %.4fs physics step, this run uses %.4fs; the replay will diverge"),
+            *FilePath, Stream->FixedDeltaTime, UPhysicsSettings::Get()->AsyncFixedTimeStepSize);
+    }
+
+    if (!ReplayFinishedHandle.IsValid())
+    {
+        ReplayFinishedHandle = SimulationSubsystem->OnReplayFinished.AddUObject(this, &UMVehicleInputReplaySubsystem::HandleReplayFinished);
+    }
+    SimulationSubsystem->StartReplay(Stream);
+    UE_LOG(LogMPVehicleReplay, Display, TEXT("Replaying %d steps of %d vehicles from %s"), Stream->GetNumSteps(), Stream->Tracks.Num(), *FilePath);
+    return true;
+}
+
+void UMVehicleInputReplaySubsystem::HandleReplayFinished()
+{
+    UE_LOG(LogMPVehicleReplay, Display, TEXT("Replay finished"));
+    if (FApp::IsUnattended())
+    {
+        FPlatformMisc::RequestExit(false, TEXT("UMVehicleInputReplaySubsystem"));
+    }
+}
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MVehicleInputReplaySubsystem.generated.h"
+
+class FMVehicleInputStream;
+
+// Records the per physics step input of every vehicle to a file, and drives the vehicles from such a file.
+//
+// Record a run from the start of the level:
+//   MashedPotatoes /Game/Maps/Lvl_VehicleBasic -MPRecordInput=Saved/VehicleInput/Spike.mpinput
+// Replay it as fast as the machine allows, without rendering, and quit at the end:
+//   UnrealEditor-Cmd MashedPotatoes.uproject /Game/Maps/Lvl_VehicleBasic -game -nullrhi -unattended -benchmark -fps=60
+//       -MPReplayInput=Saved/VehicleInput/Spike.mpinput
+// With -fps matching the async physics step every frame runs exactly one step, so the replay is repeatable.
+// Recordings can also be started and stopped from the console (mp.Vehicle.Record.Start/Stop, mp.Vehicle.Replay),
+// those only reproduce a run if the vehicles start from the same state.
+UCLASS()
+class MASHEDPOTATOES_API UMVehicleInputReplaySubsystem : public UWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    // USubsystem
+    virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+    virtual void Deinitialize() override;
+    // UWorldSubsystem
+    virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+    // Empty FilePath picks a name in Saved/VehicleInput
+    void StartRecording(const FString& FilePath);
+    void StopRecording();
+    bool StartReplay(const FString& FilePath);
+
+protected:
+    virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+    void HandleReplayFinished();
+
+    FString RecordingFilePath;
+    FDelegateHandle ReplayFinishedHandle;
+};
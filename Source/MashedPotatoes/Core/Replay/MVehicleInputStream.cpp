@@ -0,0 +1,171 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MVehicleInputStream.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMPVehicleInput, Log, All);
+
+namespace MVehicleInputStream
+{
+    // "MPIR"
+    constexpr uint32 Magic = 0x5249504D;
+    constexpr uint32 Version = 1;
+    // Longest track a file may hold, four hours at 60 Hz. Runs can expand to far more than the file size, so
+    // they are bounded by this instead.
+    constexpr int64 MaxSteps = 4 * 60 * 60 * 60;
+}
+
+int32 FMVehicleInputStream::GetNumSteps() const
+{
+    int32 numSteps = 0;
+    for (const FMVehicleInputTrack& track : Tracks)
+    {
+        numSteps = FMath::Max(numSteps, track.FirstStep + track.Inputs.Num());
+    }
+    return numSteps;
+}
+
+int32 FMVehicleInputStream::FindTrack(const FString& VehicleName) const
+{
+    return Tracks.IndexOfByPredicate([&VehicleName](const FMVehicleInputTrack& Track) { return Track.VehicleName == VehicleName; });
+}
+
+FMVehicleQuantizedInput FMVehicleInputStream::GetInput(int32 TrackIndex, int32 Step) const
+{
+    if (!Tracks.IsValidIndex(TrackIndex))
+    {
+        return FMVehicleQuantizedInput();
+    }
+
+    const FMVehicleInputTrack& track = Tracks[TrackIndex];
+    const int32 inputIndex = Step - track.FirstStep;
+    return track.Inputs.IsValidIndex(inputIndex) ? track.Inputs[inputIndex] : FMVehicleQuantizedInput();
+}
+
+void FMVehicleInputStream::Serialize(FArchive& Ar)
+{
+    uint32 magic = MVehicleInputStream::Magic;
+    uint32 version = MVehicleInputStream::Version;
+    Ar << magic << version;
+    if (magic != MVehicleInputStream::Magic || version != MVehicleInputStream::Version)
+    {
+        Ar.SetError();
+        return;
+    }
+
+    Ar << MapName << FixedDeltaTime;
+
+    int32 numTracks = Tracks.Num();
+    Ar << numTracks;
+    if (Ar.IsLoading())
+    {
+        // Every track takes at least a byte
+        if (numTracks < 0 || numTracks > Ar.TotalSize() - Ar.Tell())
+        {
+            Ar.SetError();
+            return;
+        }
+        Tracks.SetNum(numTracks);
+    }
+
+    for (FMVehicleInputTrack& track : Tracks)
+    {
+        Ar << track.VehicleName << track.FirstStep;
+        if (Ar.IsLoading() && (track.FirstStep < 0 || track.FirstStep > MVehicleInputStream::MaxSteps))
+        {
+            Ar.SetError();
+            return;
+        }
+
+        // Inputs change rarely compared to the step rate, store runs of equal inputs
+        if (Ar.IsSaving())
+        {
+            TArray<TPair<uint32, FMVehicleQuantizedInput>> runs;
+            for (const FMVehicleQuantizedInput& input : track.Inputs)
+            {
+                if (runs.Num() > 0 && runs.Last().Value == input)
+                {
+                    runs.Last().Key++;
+                }
+                else
+                {
+                    runs.Emplace(1, input);
+                }
+            }
+
+            uint32 numRuns = runs.Num();
+            Ar.SerializeIntPacked(numRuns);
+            for (TPair<uint32, FMVehicleQuantizedInput>& run : runs)
+            {
+                Ar.SerializeIntPacked(run.Key);
+                Ar << run.Value;
+            }
+        }
+        else
+        {
+            uint32 numRuns = 0;
+            Ar.SerializeIntPacked(numRuns);
+            track.Inputs.Reset();
+            if (numRuns > Ar.TotalSize() - Ar.Tell())
+            {
+                Ar.SetError();
+                return;
+            }
+            for (uint32 runIndex = 0; runIndex < numRuns && !Ar.IsError(); runIndex++)
+            {
+                uint32 runLength = 0;
+                FMVehicleQuantizedInput input;
+                Ar.SerializeIntPacked(runLength);
+                Ar << input;
+                if (track.Inputs.Num() + static_cast<int64>(runLength) > MVehicleInputStream::MaxSteps)
+                {
+                    Ar.SetError();
+                    return;
+                }
+                track.Inputs.Reserve(track.Inputs.Num() + runLength);
+                for (uint32 repeat = 0; repeat < runLength; repeat++)
+                {
+                    track.Inputs.Add(input);
+                }
+            }
+        }
+    }
+}
+
+bool FMVehicleInputStream::SaveToFile(const FString& FilePath)
+{
+    TArray<uint8> bytes;
+    FMemoryWriter writer(bytes);
+    Serialize(writer);
+
+    if (!FFileHelper::SaveArrayToFile(bytes, *FilePath))
+    {
+        UE_LOG(LogMPVehicleInput, Error, TEXT("Could not write %s"), *FilePath);
+        return false;
+    }
+    UE_LOG(LogMPVehicleInput, Display, TEXT("Wrote %d steps of %d vehicles (%d bytes) to %s"), GetNumSteps(), Tracks.Num(), bytes.Num(), *FilePath);
+    return true;
+}
+
+bool FMVehicleInputStream::LoadFromFile(const FString& FilePath)
+{
+    TArray<uint8> bytes;
+    if (!FFileHelper::LoadFileToArray(bytes, *FilePath))
+    {
+        UE_LOG(LogMPVehicleInput, Error, TEXT("Could not read %s"), *FilePath);
+        return false;
+    }
+
+    FMemoryReader reader(bytes);
+    Serialize(reader);
+    if (reader.IsError())
+    {
+        UE_LOG(LogMPVehicleInput, Error, TEXT("%s is not a vehicle input stream of version %u"), *FilePath, MVehicleInputStream::Version);
+        Tracks.Reset();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Physics/MVehiclePhysics.h"
+
+// Input of one vehicle, one entry per physics step starting at FirstStep
+struct FMVehicleInputTrack
+{
+    // Vehicles are matched up by actor name when the stream is replayed
+    FString VehicleName;
+    int32 FirstStep = 0;
+    TArray<FMVehicleQuantizedInput> Inputs;
+};
+
+// Per physics step driver input of every vehicle in a run, as recorded by UMVehicleSimulationSubsystem.
+// Stored as run-length encoded tracks, a few bytes per input change.
+class MASHEDPOTATOES_API FMVehicleInputStream
+{
+public:
+    FString MapName;
+    // Physics step the stream was recorded with, replays are only exact at the same step size
+    float FixedDeltaTime = 0.0f;
+    TArray<FMVehicleInputTrack> Tracks;
+
+    // Steps until the last track ends
+    int32 GetNumSteps() const;
+    // Track recorded for a vehicle, INDEX_NONE if there is none
+    int32 FindTrack(const FString& VehicleName) const;
+    // Input of a track at a step, released controls outside of the recorded range
+    FMVehicleQuantizedInput GetInput(int32 TrackIndex, int32 Step) const;
+
+    bool SaveToFile(const FString& FilePath);
+    bool LoadFromFile(const FString& FilePath);
+
+    void Serialize(FArchive& Ar);
+};
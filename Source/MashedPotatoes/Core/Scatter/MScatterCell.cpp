@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MScatterCell.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace MScatterCell
+{
+    // "MPSC"
+    constexpr uint32 Magic = 0x4353504D;
+    constexpr uint32 Version = 1;
+}
+
+void FMScatterCell::Serialize(FArchive& Ar)
+{
+    uint32 magic = MScatterCell::Magic;
+    uint32 version = MScatterCell::Version;
+    Ar << magic << version;
+    if (magic != MScatterCell::Magic || version != MScatterCell::Version)
+    {
+        Ar.SetError();
+        return;
+    }
+
+    int32 numInstances = Instances.Num();
+    Ar << numInstances;
+    if (Ar.IsLoading())
+    {
+        if (numInstances < 0 || numInstances > Ar.TotalSize() / 20)
+        {
+            Ar.SetError();
+            return;
+        }
+        Instances.SetNum(numInstances);
+    }
+
+    for (FMScatterInstance& instance : Instances)
+    {
+        Ar << instance.Location << instance.Yaw << instance.Scale << instance.MeshIndex;
+    }
+}
+
+bool FMScatterCell::SaveToFile(const FString& FilePath)
+{
+    TArray<uint8> bytes;
+    FMemoryWriter writer(bytes);
+    Serialize(writer);
+    return FFileHelper::SaveArrayToFile(bytes, *FilePath);
+}
+
+bool FMScatterCell::LoadFromFile(const FString& FilePath)
+{
+    TArray<uint8> bytes;
+    if (!FFileHelper::LoadFileToArray(bytes, *FilePath, FILEREAD_Silent))
+    {
+        return false;
+    }
+
+    FMemoryReader reader(bytes);
+    Serialize(reader);
+    if (reader.IsError())
+    {
+        Instances.Reset();
+        return false;
+    }
+    return true;
+}
+
+FString FMScatterCell::GetCachePath(uint64 Key)
+{
+    return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("ScatterCache"), FString::Printf(TEXT("%016llx.mpscatter"), Key));
+}
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// One generated scatter instance, kept small since whole cells of them are cached on disk
+struct FMScatterInstance
+{
+    FVector3f Location = FVector3f::ZeroVector;
+    float Yaw = 0.0f;
+    float Scale = 1.0f;
+    // Into the scatter component's mesh list
+    uint8 MeshIndex = 0;
+
+    FTransform ToTransform() const
+    {
+        return FTransform(FRotator(0.0f, Yaw, 0.0f), FVector(Location), FVector(Scale));
+    }
+};
+
+// Generation result of one scatter grid cell. Saved under Saved/ScatterCache, named after the hash of everything that
+// went into generating it, so a changed track or setting only misses the cache for the cells it touches.
+struct FMScatterCell
+{
+    TArray<FMScatterInstance> Instances;
+
+    void Serialize(FArchive& Ar);
+    // Safe to call from any thread
+    bool SaveToFile(const FString& FilePath);
+    bool LoadFromFile(const FString& FilePath);
+
+    static FString GetCachePath(uint64 Key);
+};
@@ -0,0 +1,453 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MTrackScatterComponent.h"
+#include "Async/Async.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Components/SplineComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Hash/CityHash.h"
+#include "Serialization/MemoryWriter.h"
+#include "WorldPartition/WorldPartitionSubsystem.h"
+#include "Core/Debug/MVehicleStats.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMPScatter, Log, All);
+
+static TAutoConsoleVariable<int32> CVarScatterGenerateCellsPerFrame(
+    TEXT("mp.Scatter.GenerateCellsPerFrame"),
+    1,
+    TEXT("Scatter cells generated on the game thread per frame when they are not in the disk cache."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<bool> CVarScatterDiskCache(
+    TEXT("mp.Scatter.DiskCache"),
+    true,
+    TEXT("Load scatter cells from Saved/ScatterCache and save newly generated ones there."),
+    ECVF_Default);
+
+namespace MTrackScatter
+{
+    // Bump when generation changes in a way the settings hash does not see
+    constexpr uint32 GeneratorVersion = 1;
+    constexpr float SquareCmPerHectare = 10000.0f * 10000.0f;
+    // Before a cell whose ground is missing is generated again, in seconds
+    constexpr float GroundRetryInterval = 2.0f;
+}
+
+UMTrackScatterComponent::UMTrackScatterComponent()
+{
+    PrimaryComponentTick.bCanEverTick = true;
+    // Streaming decisions do not need to be made every frame
+    PrimaryComponentTick.TickInterval = 0.2f;
+}
+
+void UMTrackScatterComponent::BeginPlay()
+{
+    Super::BeginPlay();
+
+    if (GetWorld()->GetNetMode() == NM_DedicatedServer)
+    {
+        SetComponentTickEnabled(false);
+        return;
+    }
+
+    LoadedMeshes.Reset();
+    for (const FMScatterMesh& ScatterMesh : Meshes)
+    {
+        LoadedMeshes.Add(ScatterMesh.Mesh.LoadSynchronous());
+    }
+    BuildCells();
+}
+
+void UMTrackScatterComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    for (TPair<FIntPoint, FCell>& CellPair : Cells)
+    {
+        HideCell(CellPair.Value);
+    }
+    Cells.Reset();
+    for (UHierarchicalInstancedStaticMeshComponent* Component : Components)
+    {
+        if (Component)
+        {
+            Component->DestroyComponent();
+        }
+    }
+    Components.Reset();
+    ComponentMeshIndices.Reset();
+    FreeComponents.Reset();
+    Track.Reset();
+
+    Super::EndPlay(EndPlayReason);
+}
+
+void UMTrackScatterComponent::Regenerate()
+{
+    for (TPair<FIntPoint, FCell>& CellPair : Cells)
+    {
+        HideCell(CellPair.Value);
+    }
+    BuildCells();
+}
+
+void UMTrackScatterComponent::BuildCells()
+{
+    // Loads still in flight finish on their worker and are dropped with their cell
+    Cells.Reset();
+
+    const USplineComponent* Spline = GetOwner()->FindComponentByClass<USplineComponent>();
+    if (Spline == nullptr || LoadedMeshes.Num() == 0)
+    {
+        UE_LOG(LogMPScatter, Warning, TEXT("%s has no spline or no meshes to scatter"), *GetOwner()->GetName());
+        return;
+    }
+    Track.Build(*Spline, TrackSampleSpacing);
+    SettingsHash = HashSettings();
+
+    // Every cell within MaxTrackDistance of a sample, with the samples that can affect it
+    for (int32 SampleIndex = 0; SampleIndex < Track.NumSamples(); SampleIndex++)
+    {
+        const FVector& Sample = Track.GetSampleLocation(SampleIndex);
+        const int32 MinX = FMath::FloorToInt32((Sample.X - MaxTrackDistance) / CellSize);
+        const int32 MaxX = FMath::FloorToInt32((Sample.X + MaxTrackDistance) / CellSize);
+        const int32 MinY = FMath::FloorToInt32((Sample.Y - MaxTrackDistance) / CellSize);
+        const int32 MaxY = FMath::FloorToInt32((Sample.Y + MaxTrackDistance) / CellSize);
+        for (int32 CellX = MinX; CellX <= MaxX; CellX++)
+        {
+            for (int32 CellY = MinY; CellY <= MaxY; CellY++)
+            {
+                FCell& Cell = Cells.FindOrAdd(FIntPoint(CellX, CellY));
+                Cell.Coord = FIntPoint(CellX, CellY);
+                Cell.Samples.Add(SampleIndex);
+            }
+        }
+    }
+    for (TPair<FIntPoint, FCell>& CellPair : Cells)
+    {
+        CellPair.Value.Key = HashCell(CellPair.Value);
+    }
+    UE_LOG(LogMPScatter, Display, TEXT("%s: %d scatter cells along %.0f m of track"), *GetOwner()->GetName(), Cells.Num(), Track.GetLength() / 100.0f);
+}
+
+uint64 UMTrackScatterComponent::HashSettings() const
+{
+    TArray<uint8> Bytes;
+    FMemoryWriter Writer(Bytes);
+
+    uint32 Version = MTrackScatter::GeneratorVersion;
+    // The ground the instances are traced onto belongs to the map
+    FString MapName = UWorld::RemovePIEPrefix(GetWorld()->GetMapName());
+    int32 SeedValue = Seed;
+    float Values[] = {InstancesPerHectare, TrackClearance, MaxTrackDistance, TraceHeight, CellSize};
+    Writer << Version << MapName << SeedValue;
+    Writer.Serialize(Values, sizeof(Values));
+    for (const FMScatterMesh& ScatterMesh : Meshes)
+    {
+        FString MeshPath = ScatterMesh.Mesh.ToString();
+        float Weight = ScatterMesh.Weight;
+        FVector2D ScaleRange = ScatterMesh.ScaleRange;
+        Writer << MeshPath << Weight << ScaleRange;
+    }
+    return CityHash64(reinterpret_cast<const char*>(Bytes.GetData()), Bytes.Num());
+}
+
+uint64 UMTrackScatterComponent::HashCell(const FCell& Cell) const
+{
+    // The samples at whole cm, so rebaking an unchanged spline gives the same key
+    TArray<int32> Values;
+    Values.Reserve(2 + Cell.Samples.Num() * 3);
+    Values.Add(Cell.Coord.X);
+    Values.Add(Cell.Coord.Y);
+    for (const int32 SampleIndex : Cell.Samples)
+    {
+        const FVector& Sample = Track.GetSampleLocation(SampleIndex);
+        Values.Add(FMath::RoundToInt32(Sample.X));
+        Values.Add(FMath::RoundToInt32(Sample.Y));
+        Values.Add(FMath::RoundToInt32(Sample.Z));
+    }
+    return CityHash64WithSeed(reinterpret_cast<const char*>(Values.GetData()), Values.Num() * sizeof(int32), SettingsHash);
+}
+
+TSharedPtr<FMScatterCell> UMTrackScatterComponent::GenerateCell(const FCell& Cell) const
+{
+    TSharedPtr<FMScatterCell> Data = MakeShared<FMScatterCell>();
+
+    float TotalWeight = 0.0f;
+    for (const FMScatterMesh& ScatterMesh : Meshes)
+    {
+        TotalWeight += ScatterMesh.Weight;
+    }
+    if (TotalWeight <= 0.0f)
+    {
+        return Data;
+    }
+
+    FRandomStream Random(HashCombine(GetTypeHash(Seed), GetTypeHash(Cell.Coord)));
+    const int32 NumCandidates = FMath::RoundToInt32(InstancesPerHectare * FMath::Square(CellSize) / MTrackScatter::SquareCmPerHectare);
+    const FVector2D CellMin(Cell.Coord.X * CellSize, Cell.Coord.Y * CellSize);
+
+    FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(MPScatter), false, GetOwner());
+    const FCollisionObjectQueryParams ObjectParams(ECC_WorldStatic);
+    int32 NumTraces = 0;
+    int32 NumHits = 0;
+
+    for (int32 Candidate = 0; Candidate < NumCandidates; Candidate++)
+    {
+        // Every candidate draws the same numbers whether it is kept or not, so the result only depends on the seed
+        const FVector2D Location2D = CellMin + FVector2D(Random.FRand(), Random.FRand()) * CellSize;
+        const float Yaw = Random.FRand() * 360.0f;
+        const float ScaleAlpha = Random.FRand();
+        float MeshPick = Random.FRand() * TotalWeight;
+
+        // Distance to the track from the baked samples around the cell
+        float NearestDistanceSquared = MAX_flt;
+        float NearestZ = 0.0f;
+        for (const int32 SampleIndex : Cell.Samples)
+        {
+            const FVector& Sample = Track.GetSampleLocation(SampleIndex);
+            const float DistanceSquared = FVector2D::DistSquared(FVector2D(Sample), Location2D);
+            if (DistanceSquared < NearestDistanceSquared)
+            {
+                NearestDistanceSquared = DistanceSquared;
+                NearestZ = Sample.Z;
+            }
+        }
+        if (NearestDistanceSquared < FMath::Square(TrackClearance) || NearestDistanceSquared > FMath::Square(MaxTrackDistance))
+        {
+            continue;
+        }
+
+        FHitResult Hit;
+        const FVector TraceStart(Location2D, NearestZ + TraceHeight);
+        const FVector TraceEnd(Location2D, NearestZ - TraceHeight);
+        NumTraces++;
+        if (!GetWorld()->LineTraceSingleByObjectType(Hit, TraceStart, TraceEnd, ObjectParams, QueryParams))
+        {
+            continue;
+        }
+        NumHits++;
+
+        int32 MeshIndex = 0;
+        while (MeshIndex < Meshes.Num() - 1 && MeshPick > Meshes[MeshIndex].Weight)
+        {
+            MeshPick -= Meshes[MeshIndex].Weight;
+            MeshIndex++;
+        }
+
+        FMScatterInstance& Instance = Data->Instances.AddDefaulted_GetRef();
+        Instance.Location = FVector3f(Hit.ImpactPoint);
+        Instance.Yaw = Yaw;
+        Instance.Scale = FMath::Lerp(Meshes[MeshIndex].ScaleRange.X, Meshes[MeshIndex].ScaleRange.Y, ScaleAlpha);
+        Instance.MeshIndex = static_cast<uint8>(MeshIndex);
+    }
+
+    // Ground next to the track that nothing hits has not streamed in (or lost its collision), an empty result
+    // here would be cached as if the cell really were bare
+    if (NumTraces > 0 && NumHits == 0)
+    {
+        return nullptr;
+    }
+    return Data;
+}
+
+bool UMTrackScatterComponent::IsGroundLoaded(const FCell& Cell) const
+{
+    const UWorldPartitionSubsystem* WorldPartitionSubsystem = GetWorld()->GetSubsystem<UWorldPartitionSubsystem>();
+    if (WorldPartitionSubsystem == nullptr)
+    {
+        return true;
+    }
+
+    // Streaming cells that overlap this scatter cell, other levels' cells do not matter
+    FWorldPartitionStreamingQuerySource QuerySource;
+    QuerySource.bSpatialQuery = true;
+    QuerySource.bUseGridLoadingRange = false;
+    QuerySource.Location = FVector((FVector2D(Cell.Coord) + 0.5f) * CellSize, Track.GetSampleLocation(Cell.Samples[0]).Z);
+    QuerySource.Radius = CellSize * UE_HALF_SQRT_2;
+    return WorldPartitionSubsystem->IsStreamingCompleted(EWorldPartitionRuntimeCellState::Activated, {QuerySource}, false);
+}
+
+void UMTrackScatterComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+    Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+    if (Cells.Num() == 0)
+    {
+        return;
+    }
+
+    SCOPE_CYCLE_COUNTER(STAT_MPScatterStreaming);
+
+    Viewpoints.Reset();
+    for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+    {
+        const APlayerController* PlayerController = It->Get();
+        if (PlayerController && PlayerController->IsLocalController())
+        {
+            FVector ViewLocation;
+            FRotator ViewRotation;
+            PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+            Viewpoints.Add(ViewLocation);
+        }
+    }
+
+    const bool bUseCache = CVarScatterDiskCache.GetValueOnGameThread();
+    const double Now = GetWorld()->GetTimeSeconds();
+    int32 GenerateBudget = CVarScatterGenerateCellsPerFrame.GetValueOnGameThread();
+    int32 NumLoaded = 0;
+    for (TPair<FIntPoint, FCell>& CellPair : Cells)
+    {
+        FCell& Cell = CellPair.Value;
+        const FVector2D CellCenter = (FVector2D(Cell.Coord) + 0.5f) * CellSize;
+        float ViewDistanceSquared = MAX_flt;
+        for (const FVector& Viewpoint : Viewpoints)
+        {
+            ViewDistanceSquared = FMath::Min(ViewDistanceSquared, FVector2D::DistSquared(FVector2D(Viewpoint), CellCenter));
+        }
+        const bool bWanted = ViewDistanceSquared < FMath::Square(StreamingRadius);
+        const bool bKeep = ViewDistanceSquared < FMath::Square(StreamingRadius + CellSize);
+
+        switch (Cell.State)
+        {
+        case ECellState::Unloaded:
+            if (bWanted)
+            {
+                if (bUseCache)
+                {
+                    const FString CachePath = FMScatterCell::GetCachePath(Cell.Key);
+                    Cell.PendingLoad = Async(EAsyncExecution::ThreadPool, [CachePath]() -> TSharedPtr<FMScatterCell>
+                    {
+                        TSharedPtr<FMScatterCell> Data = MakeShared<FMScatterCell>();
+                        return Data->LoadFromFile(CachePath) ? Data : nullptr;
+                    });
+                    Cell.State = ECellState::Loading;
+                }
+                else
+                {
+                    Cell.State = ECellState::Generating;
+                }
+            }
+            break;
+
+        case ECellState::Loading:
+            if (Cell.PendingLoad.IsReady())
+            {
+                const TSharedPtr<FMScatterCell> Data = Cell.PendingLoad.Get();
+                Cell.PendingLoad = TFuture<TSharedPtr<FMScatterCell>>();
+                if (Data.IsValid())
+                {
+                    ShowCell(Cell, *Data);
+                }
+                else
+                {
+                    Cell.State = ECellState::Generating;
+                }
+            }
+            break;
+
+        case ECellState::Generating:
+            if (!bKeep)
+            {
+                Cell.State = ECellState::Unloaded;
+            }
+            else if (GenerateBudget > 0 && Now >= Cell.NextGenerateTime && IsGroundLoaded(Cell))
+            {
+                GenerateBudget--;
+                const TSharedPtr<FMScatterCell> Data = GenerateCell(Cell);
+                if (!Data.IsValid())
+                {
+                    // Neither shown nor cached, stays Generating and tries again once the ground is there
+                    Cell.NextGenerateTime = Now + MTrackScatter::GroundRetryInterval;
+                    break;
+                }
+                ShowCell(Cell, *Data);
+                if (bUseCache)
+                {
+                    Async(EAsyncExecution::ThreadPool, [Data, CachePath = FMScatterCell::GetCachePath(Cell.Key)]()
+                    {
+                        Data->SaveToFile(CachePath);
+                    });
+                }
+            }
+            break;
+
+        case ECellState::Loaded:
+            if (!bKeep)
+            {
+                HideCell(Cell);
+            }
+            break;
+        }
+        NumLoaded += Cell.State == ECellState::Loaded ? 1 : 0;
+    }
+    SET_DWORD_STAT(STAT_MPScatterCells, NumLoaded);
+}
+
+int32 UMTrackScatterComponent::AcquireComponent(int32 MeshIndex)
+{
+    FreeComponents.SetNum(LoadedMeshes.Num());
+    if (FreeComponents[MeshIndex].Num() > 0)
+    {
+        return FreeComponents[MeshIndex].Pop(EAllowShrinking::No);
+    }
+
+    // Movable: created after BeginPlay, where static components can no longer have their mesh set
+    UHierarchicalInstancedStaticMeshComponent* Component = NewObject<UHierarchicalInstancedStaticMeshComponent>(GetOwner());
+    Component->SetMobility(EComponentMobility::Movable);
+    Component->SetStaticMesh(LoadedMeshes[MeshIndex]);
+    Component->SetCollisionEnabled(bCollision ? ECollisionEnabled::QueryAndPhysics : ECollisionEnabled::NoCollision);
+    Component->SetCastShadow(bCastShadow);
+    Component->SetCullDistances(0, FMath::RoundToInt32(CullDistance));
+    // Thinned by foliage.DensityScale, which the render budget lowers under load
+    Component->bEnableDensityScaling = true;
+    Component->SetupAttachment(GetOwner()->GetRootComponent());
+    Component->RegisterComponent();
+    ComponentMeshIndices.Add(MeshIndex);
+    return Components.Add(Component);
+}
+
+void UMTrackScatterComponent::ShowCell(FCell& Cell, const FMScatterCell& Data)
+{
+    MeshTransforms.SetNum(LoadedMeshes.Num());
+    for (TArray<FTransform>& Transforms : MeshTransforms)
+    {
+        Transforms.Reset();
+    }
+    for (const FMScatterInstance& Instance : Data.Instances)
+    {
+        if (MeshTransforms.IsValidIndex(Instance.MeshIndex))
+        {
+            MeshTransforms[Instance.MeshIndex].Add(Instance.ToTransform());
+        }
+    }
+
+    for (int32 MeshIndex = 0; MeshIndex < LoadedMeshes.Num(); MeshIndex++)
+    {
+        if (MeshTransforms[MeshIndex].Num() == 0 || LoadedMeshes[MeshIndex] == nullptr)
+        {
+            continue;
+        }
+        const int32 ComponentIndex = AcquireComponent(MeshIndex);
+        UHierarchicalInstancedStaticMeshComponent* Component = Components[ComponentIndex];
+        Component->AddInstances(MeshTransforms[MeshIndex], false, true);
+        Cell.ComponentIndices.Add(ComponentIndex);
+    }
+    Cell.State = ECellState::Loaded;
+}
+
+void UMTrackScatterComponent::HideCell(FCell& Cell)
+{
+    for (const int32 ComponentIndex : Cell.ComponentIndices)
+    {
+        if (UHierarchicalInstancedStaticMeshComponent* Component = Components[ComponentIndex])
+        {
+            Component->ClearInstances();
+        }
+        FreeComponents[ComponentMeshIndices[ComponentIndex]].Add(ComponentIndex);
+    }
+    Cell.ComponentIndices.Reset();
+    Cell.PendingLoad = TFuture<TSharedPtr<FMScatterCell>>();
+    Cell.State = ECellState::Unloaded;
+}
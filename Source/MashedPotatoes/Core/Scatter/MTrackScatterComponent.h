@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Async/Future.h"
+#include "Core/Race/MTrackSampleTable.h"
+#include "Core/Scatter/MScatterCell.h"
+#include "MTrackScatterComponent.generated.h"
+
+class UStaticMesh;
+class UHierarchicalInstancedStaticMeshComponent;
+
+USTRUCT(BlueprintType)
+struct FMScatterMesh
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, Category = "Scatter")
+    TSoftObjectPtr<UStaticMesh> Mesh;
+    // Relative to the other meshes
+    UPROPERTY(EditAnywhere, Category = "Scatter", meta = (ClampMin = "0"))
+    float Weight = 1.0f;
+    UPROPERTY(EditAnywhere, Category = "Scatter")
+    FVector2D ScaleRange = FVector2D(0.8f, 1.2f);
+};
+
+// Trees (or any other scenery) scattered along the track spline of the actor it is added to (bp_TrackSpline), at
+// runtime, in grid cells that stream in and out around the local players' cameras. Each cell becomes one
+// hierarchical instanced mesh per mesh type and its generation result is cached on disk, keyed by a hash of the
+// seed, the settings and the part of the track near the cell: editing one corner of the track regenerates only the
+// cells there, everything else loads from the cache on a worker thread. Nothing is spawned on dedicated servers.
+// Not built on PCG runtime generation: that executes the graph again every time a partition cell comes into range
+// and keeps no results between sessions, and its partitioned graph has to be authored as content.
+UCLASS(ClassGroup = (Scatter), meta = (BlueprintSpawnableComponent))
+class MASHEDPOTATOES_API UMTrackScatterComponent : public UActorComponent
+{
+    GENERATED_BODY()
+
+public:
+    UMTrackScatterComponent();
+
+    // UActorComponent
+    virtual void BeginPlay() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+    virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+    // Rebakes the track and reloads every cell, only cells whose inputs changed are generated again
+    UFUNCTION(BlueprintCallable, Category = "Scatter")
+    void Regenerate();
+
+    UPROPERTY(EditAnywhere, Category = "Scatter")
+    TArray<FMScatterMesh> Meshes;
+    UPROPERTY(EditAnywhere, Category = "Scatter")
+    int32 Seed = 0;
+    UPROPERTY(EditAnywhere, Category = "Scatter", meta = (ClampMin = "0"))
+    float InstancesPerHectare = 120.0f;
+    // Nothing closer to the track centre line than this, in cm
+    UPROPERTY(EditAnywhere, Category = "Scatter", meta = (ClampMin = "0"))
+    float TrackClearance = 1500.0f;
+    // Nothing further from the track than this, in cm
+    UPROPERTY(EditAnywhere, Category = "Scatter", meta = (ClampMin = "0"))
+    float MaxTrackDistance = 15000.0f;
+    // How far above and below the track the ground is searched for
+    UPROPERTY(EditAnywhere, Category = "Scatter", meta = (ClampMin = "0"))
+    float TraceHeight = 20000.0f;
+    // Arc length between two samples of the baked track, in cm
+    UPROPERTY(EditAnywhere, Category = "Scatter", meta = (ClampMin = "10"))
+    float TrackSampleSpacing = 500.0f;
+
+    UPROPERTY(EditAnywhere, Category = "Scatter|Streaming", meta = (ClampMin = "100"))
+    float CellSize = 10000.0f;
+    // Cells within this distance of a local player's camera are loaded, they unload one cell further out
+    UPROPERTY(EditAnywhere, Category = "Scatter|Streaming", meta = (ClampMin = "0"))
+    float StreamingRadius = 40000.0f;
+
+    UPROPERTY(EditAnywhere, Category = "Scatter|Rendering", meta = (ClampMin = "0"))
+    float CullDistance = 40000.0f;
+    UPROPERTY(EditAnywhere, Category = "Scatter|Rendering")
+    bool bCastShadow = true;
+    UPROPERTY(EditAnywhere, Category = "Scatter|Rendering")
+    bool bCollision = false;
+
+private:
+    enum class ECellState : uint8
+    {
+        Unloaded,
+        // Reading the cache on a worker
+        Loading,
+        // Not in the cache, waiting for its turn to be generated and for the ground under it to stream in
+        Generating,
+        Loaded,
+    };
+
+    struct FCell
+    {
+        FIntPoint Coord = FIntPoint::ZeroValue;
+        // Track samples within MaxTrackDistance of the cell
+        TArray<int32> Samples;
+        uint64 Key = 0;
+        ECellState State = ECellState::Unloaded;
+        TFuture<TSharedPtr<FMScatterCell>> PendingLoad;
+        // World time before which generation is not tried again, after the ground under the cell was missing
+        double NextGenerateTime = 0.0;
+        // Into Components
+        TArray<int32> ComponentIndices;
+    };
+
+    // Bakes the track and works out which cells are near it and what they are keyed by
+    void BuildCells();
+    uint64 HashSettings() const;
+    uint64 HashCell(const FCell& Cell) const;
+    // Null when no trace found the ground, the cell must then be neither shown nor cached
+    TSharedPtr<FMScatterCell> GenerateCell(const FCell& Cell) const;
+    // Whether the world partition cells under the scatter cell have finished streaming in
+    bool IsGroundLoaded(const FCell& Cell) const;
+    void ShowCell(FCell& Cell, const FMScatterCell& Data);
+    void HideCell(FCell& Cell);
+    // A pooled component that already shows LoadedMeshes[MeshIndex], created on demand
+    int32 AcquireComponent(int32 MeshIndex);
+
+    FMTrackSampleTable Track;
+    TMap<FIntPoint, FCell> Cells;
+    uint64 SettingsHash = 0;
+
+    UPROPERTY(Transient)
+    TArray<TObjectPtr<UStaticMesh>> LoadedMeshes;
+    // Every instanced mesh created so far, hidden cells give theirs back to FreeComponents
+    UPROPERTY(Transient)
+    TArray<TObjectPtr<UHierarchicalInstancedStaticMeshComponent>> Components;
+    // Mesh index of each of Components, a component keeps its mesh for its whole life
+    TArray<int32> ComponentMeshIndices;
+    // Unused components per mesh index
+    TArray<TArray<int32>> FreeComponents;
+
+    // Scratch
+    TArray<FVector> Viewpoints;
+    TArray<TArray<FTransform>> MeshTransforms;
+};
@@ -0,0 +1,170 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MVehicleSignificanceSubsystem.h"
+#include "SignificanceManager.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Core/Characters/MVehicleBase.h"
+
+static const FName VehicleSignificanceTag(TEXT("MPVehicle"));
+
+static TAutoConsoleVariable<bool> CVarVehicleLOD(
+    TEXT("mp.Vehicle.LOD"),
+    true,
+    TEXT("Run vehicles far from every local player's camera at a reduced simulation LOD."),
+    ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarVehicleLODReducedDistance(
+    TEXT("mp.Vehicle.LOD.ReducedDistance"),
+    5000.0f,
+    TEXT("Vehicles further than this from every camera run at the Reduced LOD."),
+    ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarVehicleLODMinimalDistance(
+    TEXT("mp.Vehicle.LOD.MinimalDistance"),
+    15000.0f,
+    TEXT("Vehicles further than this from every camera run at the Minimal LOD (one suspension ray per axle)."),
+    ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarVehicleLODReducedTickInterval(
+    TEXT("mp.Vehicle.LOD.ReducedTickInterval"),
+    0.1f,
+    TEXT("Actor tick interval of Reduced LOD vehicles, in seconds."),
+    ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarVehicleLODMinimalTickInterval(
+    TEXT("mp.Vehicle.LOD.MinimalTickInterval"),
+    0.25f,
+    TEXT("Actor tick interval of Minimal LOD vehicles, in seconds."),
+    ECVF_Scalability);
+
+void UMVehicleSignificanceSubsystem::Deinitialize()
+{
+    if (USignificanceManager* SignificanceManager = USignificanceManager::Get(GetWorld()))
+    {
+        SignificanceManager->UnregisterAll(VehicleSignificanceTag);
+    }
+
+    Super::Deinitialize();
+}
+
+bool UMVehicleSignificanceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+    return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UMVehicleSignificanceSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UMVehicleSignificanceSubsystem, STATGROUP_Tickables);
+}
+
+float UMVehicleSignificanceSubsystem::GetTickInterval(EMVehicleSimulationLOD LOD)
+{
+    switch (LOD)
+    {
+    case EMVehicleSimulationLOD::Reduced: return CVarVehicleLODReducedTickInterval.GetValueOnGameThread();
+    case EMVehicleSimulationLOD::Minimal: return CVarVehicleLODMinimalTickInterval.GetValueOnGameThread();
+    default: return 0.0f;
+    }
+}
+
+int32 UMVehicleSignificanceSubsystem::GetContactRefreshInterval(EMVehicleSimulationLOD LOD)
+{
+    switch (LOD)
+    {
+    case EMVehicleSimulationLOD::Reduced: return 2;
+    case EMVehicleSimulationLOD::Minimal: return 4;
+    default: return 1;
+    }
+}
+
+void UMVehicleSignificanceSubsystem::RegisterVehicle(AMVehicleBase* Vehicle)
+{
+    USignificanceManager* SignificanceManager = USignificanceManager::Get(GetWorld());
+    if (SignificanceManager == nullptr || Vehicle == nullptr)
+    {
+        return;
+    }
+
+    auto Significance = [](USignificanceManager::FManagedObjectInfo* ObjectInfo, const FTransform& Viewpoint)
+    {
+        return CalculateSignificance(Cast<AMVehicleBase>(ObjectInfo->GetObject()), Viewpoint);
+    };
+    // Sequential so the LOD is applied on the game thread
+    auto PostSignificance = [](USignificanceManager::FManagedObjectInfo* ObjectInfo, float OldSignificance, float NewSignificance, bool bFinal)
+    {
+        if (AMVehicleBase* Vehicle = Cast<AMVehicleBase>(ObjectInfo->GetObject()))
+        {
+            Vehicle->SetSimulationLOD(static_cast<EMVehicleSimulationLOD>(FMath::Clamp(FMath::RoundToInt32(NewSignificance), 0, 2)));
+        }
+    };
+    SignificanceManager->RegisterObject(Vehicle, VehicleSignificanceTag, Significance, USignificanceManager::EPostSignificanceType::Sequential, PostSignificance);
+}
+
+void UMVehicleSignificanceSubsystem::UnregisterVehicle(AMVehicleBase* Vehicle)
+{
+    if (USignificanceManager* SignificanceManager = USignificanceManager::Get(GetWorld()))
+    {
+        SignificanceManager->UnregisterObject(Vehicle);
+    }
+}
+
+float UMVehicleSignificanceSubsystem::CalculateSignificance(const AMVehicleBase* Vehicle, const FTransform& Viewpoint)
+{
+    // EMVehicleSimulationLOD counts down from Full, so the most significant view wins
+    if (Vehicle == nullptr || !CVarVehicleLOD.GetValueOnAnyThread() || Vehicle->IsLocallyControlled())
+    {
+        return static_cast<float>(EMVehicleSimulationLOD::Full);
+    }
+
+    const double DistanceSquared = FVector::DistSquared(Viewpoint.GetLocation(), Vehicle->GetActorLocation());
+    if (DistanceSquared > FMath::Square(CVarVehicleLODMinimalDistance.GetValueOnAnyThread()))
+    {
+        return static_cast<float>(EMVehicleSimulationLOD::Minimal);
+    }
+    if (DistanceSquared > FMath::Square(CVarVehicleLODReducedDistance.GetValueOnAnyThread()))
+    {
+        return static_cast<float>(EMVehicleSimulationLOD::Reduced);
+    }
+    return static_cast<float>(EMVehicleSimulationLOD::Full);
+}
+
+void UMVehicleSignificanceSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    USignificanceManager* SignificanceManager = USignificanceManager::Get(GetWorld());
+    if (SignificanceManager == nullptr)
+    {
+        return;
+    }
+
+    Viewpoints.Reset();
+    for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+    {
+        const APlayerController* PlayerController = Iterator->Get();
+        if (PlayerController && PlayerController->IsLocalController() && PlayerController->PlayerCameraManager)
+        {
+            Viewpoints.Emplace(PlayerController->PlayerCameraManager->GetCameraRotation(), PlayerController->PlayerCameraManager->GetCameraLocation());
+        }
+    }
+
+    if (Viewpoints.Num() > 0)
+    {
+        SignificanceManager->Update(Viewpoints);
+    }
+    else if (bHadViewpoints)
+    {
+        // Nobody is looking any more (e.g. the last local player left), nothing to save on
+        for (const USignificanceManager::FManagedObjectInfo* ObjectInfo : SignificanceManager->GetManagedObjects(VehicleSignificanceTag))
+        {
+            if (AMVehicleBase* Vehicle = Cast<AMVehicleBase>(ObjectInfo->GetObject()))
+            {
+                Vehicle->SetSimulationLOD(EMVehicleSimulationLOD::Full);
+            }
+        }
+    }
+    bHadViewpoints = Viewpoints.Num() > 0;
+}
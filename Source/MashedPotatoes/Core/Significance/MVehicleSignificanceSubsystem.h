@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Core/Physics/MVehiclePhysics.h"
+#include "MVehicleSignificanceSubsystem.generated.h"
+
+class AMVehicleBase;
+
+// Feeds every local player's camera (one per split-screen view) to the SignificanceManager and hands each
+// registered vehicle the simulation LOD it earned: the best LOD over all views, full fidelity for cars a
+// local player drives. Without any local view (dedicated server, headless) every vehicle stays at full LOD.
+UCLASS()
+class MASHEDPOTATOES_API UMVehicleSignificanceSubsystem : public UTickableWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    // USubsystem
+    virtual void Deinitialize() override;
+    // FTickableGameObject
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+
+    void RegisterVehicle(AMVehicleBase* Vehicle);
+    void UnregisterVehicle(AMVehicleBase* Vehicle);
+
+    // Actor tick interval for a LOD (mp.Vehicle.LOD.*TickInterval)
+    static float GetTickInterval(EMVehicleSimulationLOD LOD);
+    // Every how many frames the suspension rays of a LOD are refreshed
+    static int32 GetContactRefreshInterval(EMVehicleSimulationLOD LOD);
+
+protected:
+    virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+    // Significance of a vehicle seen from one view, the LOD it should run at as a float
+    static float CalculateSignificance(const AMVehicleBase* Vehicle, const FTransform& Viewpoint);
+
+    TArray<FTransform> Viewpoints;
+    bool bHadViewpoints = false;
+};
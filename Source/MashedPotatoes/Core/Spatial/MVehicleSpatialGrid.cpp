@@ -0,0 +1,173 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MVehicleSpatialGrid.h"
+#include "Algo/BinarySearch.h"
+#include "Algo/StableSort.h"
+
+void FMVehicleSpatialGrid::Reset()
+{
+    Keys.Reset();
+    Entries.Reset();
+    EntryIndexById.Reset();
+}
+
+void FMVehicleSpatialGrid::Add(int32 Id, const FVector& Location, const FVector& Velocity)
+{
+    const FIntPoint Cell = GetCell(Location);
+    Keys.Add(MakeKey(Cell.X, Cell.Y));
+    Entries.Add({Location, Velocity, Id});
+}
+
+void FMVehicleSpatialGrid::Build()
+{
+    SortOrder.Reset(Keys.Num());
+    for (int32 EntryIndex = 0; EntryIndex < Keys.Num(); EntryIndex++)
+    {
+        SortOrder.Add(EntryIndex);
+    }
+    // Stable, so entries in a cell keep the order they were added in and queries are deterministic
+    Algo::StableSortBy(SortOrder, [this](int32 EntryIndex) { return Keys[EntryIndex]; });
+
+    SortedKeys.Reset(Keys.Num());
+    SortedEntries.Reset(Entries.Num());
+    for (const int32 EntryIndex : SortOrder)
+    {
+        SortedKeys.Add(Keys[EntryIndex]);
+        SortedEntries.Add(Entries[EntryIndex]);
+    }
+    Swap(Keys, SortedKeys);
+    Swap(Entries, SortedEntries);
+
+    EntryIndexById.Reset();
+    MinOccupiedCell = FIntPoint(MAX_int32, MAX_int32);
+    MaxOccupiedCell = FIntPoint(MIN_int32, MIN_int32);
+    for (int32 EntryIndex = 0; EntryIndex < Entries.Num(); EntryIndex++)
+    {
+        // Moves stay in their cell, so these hold until the next Build
+        const FIntPoint Cell = GetCell(Entries[EntryIndex].Location);
+        MinOccupiedCell = FIntPoint(FMath::Min(MinOccupiedCell.X, Cell.X), FMath::Min(MinOccupiedCell.Y, Cell.Y));
+        MaxOccupiedCell = FIntPoint(FMath::Max(MaxOccupiedCell.X, Cell.X), FMath::Max(MaxOccupiedCell.Y, Cell.Y));
+
+        const int32 Id = Entries[EntryIndex].Id;
+        while (EntryIndexById.Num() <= Id)
+        {
+            EntryIndexById.Add(INDEX_NONE);
+        }
+        EntryIndexById[Id] = EntryIndex;
+    }
+}
+
+bool FMVehicleSpatialGrid::Move(int32 Id, const FVector& Location, const FVector& Velocity)
+{
+    if (!EntryIndexById.IsValidIndex(Id) || EntryIndexById[Id] == INDEX_NONE)
+    {
+        return false;
+    }
+    const int32 EntryIndex = EntryIndexById[Id];
+    const FIntPoint Cell = GetCell(Location);
+    if (Keys[EntryIndex] != MakeKey(Cell.X, Cell.Y))
+    {
+        return false;
+    }
+    Entries[EntryIndex].Location = Location;
+    Entries[EntryIndex].Velocity = Velocity;
+    return true;
+}
+
+int32 FMVehicleSpatialGrid::FindFirstInCell(int32 CellX, int32 CellY) const
+{
+    return Algo::LowerBound(Keys, MakeKey(CellX, CellY));
+}
+
+template <typename AllocatorType>
+void FMVehicleSpatialGrid::FindNearestEntries(const FVector& Center, float MaxRadius, int32 Count, TFunctionRef<bool(const FEntry&)> Filter,
+    TArray<FNearestEntry, AllocatorType>& OutNearest) const
+{
+    OutNearest.Reset();
+    if (Count <= 0 || Entries.Num() == 0)
+    {
+        return;
+    }
+    MaxRadius = FMath::Min(MaxRadius, MaxQueryRadius);
+    const float MaxRadiusSquared = FMath::Square(MaxRadius);
+
+    auto VisitCell = [&](int32 CellX, int32 CellY)
+    {
+        for (int32 EntryIndex = FindFirstInCell(CellX, CellY); EntryIndex < Keys.Num() && Keys[EntryIndex] == MakeKey(CellX, CellY); EntryIndex++)
+        {
+            const FEntry& Entry = Entries[EntryIndex];
+            const float DistanceSquared = FVector::DistSquared(Entry.Location, Center);
+            const float CutoffSquared = OutNearest.Num() == Count ? OutNearest.Last().DistanceSquared : MaxRadiusSquared;
+            if (DistanceSquared > CutoffSquared || !Filter(Entry))
+            {
+                continue;
+            }
+
+            // Count is small, a sorted insert beats a heap
+            int32 InsertIndex = OutNearest.Num();
+            while (InsertIndex > 0 && OutNearest[InsertIndex - 1].DistanceSquared > DistanceSquared)
+            {
+                InsertIndex--;
+            }
+            if (OutNearest.Num() == Count)
+            {
+                OutNearest.Pop(EAllowShrinking::No);
+            }
+            OutNearest.Insert({&Entry, DistanceSquared}, InsertIndex);
+        }
+    };
+
+    // Rings before the first occupied cell or beyond the last one are empty, skip them
+    const FIntPoint CenterCell = GetCell(Center);
+    const int32 FirstRing = FMath::Max3(0,
+        FMath::Max(MinOccupiedCell.X - CenterCell.X, CenterCell.X - MaxOccupiedCell.X),
+        FMath::Max(MinOccupiedCell.Y - CenterCell.Y, CenterCell.Y - MaxOccupiedCell.Y));
+    const int32 LastRing = FMath::Min(FMath::CeilToInt32(MaxRadius / CellSize), FMath::Max(
+        FMath::Max(CenterCell.X - MinOccupiedCell.X, MaxOccupiedCell.X - CenterCell.X),
+        FMath::Max(CenterCell.Y - MinOccupiedCell.Y, MaxOccupiedCell.Y - CenterCell.Y)));
+    for (int32 Ring = FirstRing; Ring <= LastRing; Ring++)
+    {
+        // Everything in this ring is at least (Ring - 1) cells away in XY, nothing here can beat what we have
+        if (OutNearest.Num() == Count && FMath::Square((Ring - 1) * CellSize) > OutNearest.Last().DistanceSquared)
+        {
+            break;
+        }
+
+        const int32 MinY = FMath::Max(CenterCell.Y - Ring, MinOccupiedCell.Y);
+        const int32 MaxY = FMath::Min(CenterCell.Y + Ring, MaxOccupiedCell.Y);
+        const int32 MaxX = FMath::Min(CenterCell.X + Ring, MaxOccupiedCell.X);
+        for (int32 CellX = FMath::Max(CenterCell.X - Ring, MinOccupiedCell.X); CellX <= MaxX; CellX++)
+        {
+            // Only the border of the ring, the inside was searched already
+            if (CellX == CenterCell.X - Ring || CellX == CenterCell.X + Ring)
+            {
+                for (int32 CellY = MinY; CellY <= MaxY; CellY++)
+                {
+                    VisitCell(CellX, CellY);
+                }
+                continue;
+            }
+            if (CenterCell.Y - Ring >= MinOccupiedCell.Y)
+            {
+                VisitCell(CellX, CenterCell.Y - Ring);
+            }
+            if (CenterCell.Y + Ring <= MaxOccupiedCell.Y)
+            {
+                VisitCell(CellX, CenterCell.Y + Ring);
+            }
+        }
+    }
+}
+
+const FMVehicleSpatialGrid::FEntry* FMVehicleSpatialGrid::FindNearest(const FVector& Center, float MaxRadius, TFunctionRef<bool(const FEntry&)> Filter) const
+{
+    TArray<FNearestEntry, TInlineAllocator<1>> Nearest;
+    FindNearestEntries(Center, MaxRadius, 1, Filter, Nearest);
+    return Nearest.Num() > 0 ? Nearest[0].Entry : nullptr;
+}
+
+void FMVehicleSpatialGrid::FindNearest(const FVector& Center, float MaxRadius, int32 Count, TFunctionRef<bool(const FEntry&)> Filter, TArray<FNearestEntry>& OutNearest) const
+{
+    FindNearestEntries(Center, MaxRadius, Count, Filter, OutNearest);
+}
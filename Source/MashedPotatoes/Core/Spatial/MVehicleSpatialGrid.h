@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Uniform grid over the XY plane for a few dozen moving points. Entries are sorted by cell, so the whole grid is
+// two flat arrays: no per cell allocations, and a rebuild reuses the memory of the previous one. Points that stay
+// in their cell are moved in place, only a cell change needs a rebuild. Distances are checked in 3D, only the
+// bucketing ignores Z.
+class FMVehicleSpatialGrid
+{
+public:
+    struct FEntry
+    {
+        FVector Location = FVector::ZeroVector;
+        FVector Velocity = FVector::ZeroVector;
+        // Whatever the owner uses to find the object again, small and non-negative
+        int32 Id = INDEX_NONE;
+    };
+
+    struct FNearestEntry
+    {
+        const FEntry* Entry = nullptr;
+        float DistanceSquared = 0.0f;
+    };
+
+    explicit FMVehicleSpatialGrid(float InCellSize = 2000.0f) : CellSize(InCellSize) {}
+
+    // Drops every entry, keeps the memory
+    void Reset();
+    void Add(int32 Id, const FVector& Location, const FVector& Velocity);
+    // Sorts the entries added since Reset into their cells, call before querying
+    void Build();
+    // Updates a built entry in place. False if it is not in the grid or left its cell, which needs a rebuild.
+    bool Move(int32 Id, const FVector& Location, const FVector& Velocity);
+
+    int32 Num() const { return Entries.Num(); }
+    const FEntry& GetEntry(int32 EntryIndex) const { return Entries[EntryIndex]; }
+    float GetCellSize() const { return CellSize; }
+    void SetCellSize(float InCellSize) { CellSize = FMath::Max(InCellSize, 1.0f); }
+
+    // Calls Visitor(const FEntry&, float DistanceSquared) for every entry within Radius of Center
+    template <typename VisitorType>
+    void ForEachInRadius(const FVector& Center, float Radius, VisitorType&& Visitor) const
+    {
+        if (Entries.Num() == 0)
+        {
+            return;
+        }
+        Radius = FMath::Min(Radius, MaxQueryRadius);
+        const float RadiusSquared = FMath::Square(Radius);
+        // Only the cells that can hold entries, a huge radius must not walk millions of empty ones
+        FIntPoint MinCell = GetCell(Center - FVector(Radius));
+        FIntPoint MaxCell = GetCell(Center + FVector(Radius));
+        MinCell = FIntPoint(FMath::Max(MinCell.X, MinOccupiedCell.X), FMath::Max(MinCell.Y, MinOccupiedCell.Y));
+        MaxCell = FIntPoint(FMath::Min(MaxCell.X, MaxOccupiedCell.X), FMath::Min(MaxCell.Y, MaxOccupiedCell.Y));
+        for (int32 CellX = MinCell.X; CellX <= MaxCell.X; CellX++)
+        {
+            for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; CellY++)
+            {
+                for (int32 EntryIndex = FindFirstInCell(CellX, CellY); EntryIndex < Keys.Num() && Keys[EntryIndex] == MakeKey(CellX, CellY); EntryIndex++)
+                {
+                    const FEntry& Entry = Entries[EntryIndex];
+                    const float DistanceSquared = FVector::DistSquared(Entry.Location, Center);
+                    if (DistanceSquared <= RadiusSquared)
+                    {
+                        Visitor(Entry, DistanceSquared);
+                    }
+                }
+            }
+        }
+    }
+
+    // Closest entry within MaxRadius that Filter accepts, null if there is none. Searches outwards ring by ring
+    // and stops once no closer entry can exist.
+    const FEntry* FindNearest(const FVector& Center, float MaxRadius, TFunctionRef<bool(const FEntry&)> Filter) const;
+    // Up to Count closest entries within MaxRadius that Filter accepts, nearest first
+    void FindNearest(const FVector& Center, float MaxRadius, int32 Count, TFunctionRef<bool(const FEntry&)> Filter, TArray<FNearestEntry>& OutNearest) const;
+
+    // Query radii are clamped to this, 100 km is far beyond any track
+    static constexpr float MaxQueryRadius = 10000000.0f;
+
+private:
+    FIntPoint GetCell(const FVector& Location) const
+    {
+        return FIntPoint(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize));
+    }
+    static uint64 MakeKey(int32 CellX, int32 CellY)
+    {
+        return (static_cast<uint64>(static_cast<uint32>(CellX)) << 32) | static_cast<uint32>(CellY);
+    }
+    // Index of the first entry in the cell, or of the first entry after where it would be
+    int32 FindFirstInCell(int32 CellX, int32 CellY) const;
+    template <typename AllocatorType>
+    void FindNearestEntries(const FVector& Center, float MaxRadius, int32 Count, TFunctionRef<bool(const FEntry&)> Filter,
+        TArray<FNearestEntry, AllocatorType>& OutNearest) const;
+
+    float CellSize;
+    // Parallel arrays sorted by cell key after Build
+    TArray<uint64> Keys;
+    TArray<FEntry> Entries;
+    // Entry index of each Id after Build, INDEX_NONE for Ids not in the grid
+    TArray<int32> EntryIndexById;
+    // Bounds of the cells that hold entries after Build, queries never look outside them
+    FIntPoint MinOccupiedCell = FIntPoint::ZeroValue;
+    FIntPoint MaxOccupiedCell = FIntPoint::ZeroValue;
+    // Scratch for Build
+    TArray<int32> SortOrder;
+    TArray<uint64> SortedKeys;
+    TArray<FEntry> SortedEntries;
+};
@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MVehicleSpatialSubsystem.h"
+#include "Engine/World.h"
+#include "Core/Characters/MVehicleBase.h"
+#include "Core/Debug/MVehicleStats.h"
+
+static TAutoConsoleVariable<float> CVarVehicleSpatialCellSize(
+    TEXT("mp.Vehicle.Spatial.CellSize"),
+    2000.0f,
+    TEXT("Cell size of the vehicle spatial grid, in cm. Around the most common query radius works best."),
+    ECVF_Default);
+
+void UMVehicleSpatialSubsystem::Deinitialize()
+{
+    Grid.Reset();
+    Vehicles.Reset();
+    FreeIds.Reset();
+
+    Super::Deinitialize();
+}
+
+bool UMVehicleSpatialSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+    return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UMVehicleSpatialSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UMVehicleSpatialSubsystem, STATGROUP_Tickables);
+}
+
+void UMVehicleSpatialSubsystem::RegisterVehicle(AMVehicleBase* Vehicle)
+{
+    if (Vehicle == nullptr || Vehicles.Contains(Vehicle))
+    {
+        return;
+    }
+
+    if (FreeIds.Num() > 0)
+    {
+        Vehicles[FreeIds.Pop(EAllowShrinking::No)] = Vehicle;
+    }
+    else
+    {
+        Vehicles.Add(Vehicle);
+    }
+    bMembershipChanged = true;
+    RefreshedFrame = MAX_uint64;
+}
+
+void UMVehicleSpatialSubsystem::UnregisterVehicle(AMVehicleBase* Vehicle)
+{
+    const int32 Id = Vehicles.IndexOfByKey(Vehicle);
+    if (Id == INDEX_NONE)
+    {
+        return;
+    }
+
+    Vehicles[Id] = nullptr;
+    FreeIds.Add(Id);
+    bMembershipChanged = true;
+    RefreshedFrame = MAX_uint64;
+}
+
+void UMVehicleSpatialSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    Refresh();
+}
+
+void UMVehicleSpatialSubsystem::Refresh()
+{
+    if (RefreshedFrame == GFrameCounter)
+    {
+        return;
+    }
+    RefreshedFrame = GFrameCounter;
+
+    SCOPE_CYCLE_COUNTER(STAT_MPVehicleSpatialRefresh);
+
+    const float CellSize = FMath::Max(CVarVehicleSpatialCellSize.GetValueOnGameThread(), 1.0f);
+    bool bRebuild = bMembershipChanged || CellSize != Grid.GetCellSize();
+
+    // Cars that stay in their cell are moved in place, the first one to change cell makes it a full rebuild
+    if (!bRebuild)
+    {
+        for (int32 Id = 0; Id < Vehicles.Num(); Id++)
+        {
+            const AMVehicleBase* Vehicle = Vehicles[Id].Get();
+            if (Vehicle && !Grid.Move(Id, Vehicle->GetActorLocation(), Vehicle->GetVelocity()))
+            {
+                bRebuild = true;
+                break;
+            }
+        }
+    }
+
+    if (bRebuild)
+    {
+        INC_DWORD_STAT(STAT_MPVehicleSpatialRebuilds);
+        Grid.SetCellSize(CellSize);
+        Grid.Reset();
+        for (int32 Id = 0; Id < Vehicles.Num(); Id++)
+        {
+            if (const AMVehicleBase* Vehicle = Vehicles[Id].Get())
+            {
+                Grid.Add(Id, Vehicle->GetActorLocation(), Vehicle->GetVelocity());
+            }
+        }
+        Grid.Build();
+        bMembershipChanged = false;
+    }
+}
+
+// --- Blueprint Queries ---
+
+AMVehicleBase* UMVehicleSpatialSubsystem::FindNearestVehicle(FVector Location, float MaxRadius, AMVehicleBase* Ignore) const
+{
+    const FMVehicleSpatialGrid::FEntry* Nearest = Grid.FindNearest(Location, MaxRadius,
+        [this, Ignore](const FMVehicleSpatialGrid::FEntry& Entry)
+        {
+            const AMVehicleBase* Vehicle = Vehicles[Entry.Id].Get();
+            return Vehicle && Vehicle != Ignore;
+        });
+    return Nearest ? Vehicles[Nearest->Id].Get() : nullptr;
+}
+
+TArray<AMVehicleBase*> UMVehicleSpatialSubsystem::FindNearestVehicles(FVector Location, int32 Count, float MaxRadius, AMVehicleBase* Ignore) const
+{
+    TArray<FMVehicleSpatialGrid::FNearestEntry> Nearest;
+    Grid.FindNearest(Location, MaxRadius, Count,
+        [this, Ignore](const FMVehicleSpatialGrid::FEntry& Entry)
+        {
+            const AMVehicleBase* Vehicle = Vehicles[Entry.Id].Get();
+            return Vehicle && Vehicle != Ignore;
+        }, Nearest);
+
+    TArray<AMVehicleBase*> Result;
+    Result.Reserve(Nearest.Num());
+    for (const FMVehicleSpatialGrid::FNearestEntry& NearestEntry : Nearest)
+    {
+        Result.Add(Vehicles[NearestEntry.Entry->Id].Get());
+    }
+    return Result;
+}
+
+TArray<AMVehicleBase*> UMVehicleSpatialSubsystem::GetVehiclesInRadius(FVector Center, float Radius, AMVehicleBase* Ignore) const
+{
+    TArray<AMVehicleBase*> Result;
+    ForEachVehicleInRadius(Center, Radius, [&Result, Ignore](AMVehicleBase* Vehicle, const FMVehicleSpatialGrid::FEntry& Entry, float DistanceSquared)
+    {
+        if (Vehicle != Ignore)
+        {
+            Result.Add(Vehicle);
+        }
+    });
+    return Result;
+}
@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Core/Spatial/MVehicleSpatialGrid.h"
+#include "MVehicleSpatialSubsystem.generated.h"
+
+class AMVehicleBase;
+
+// Where every car is, for "nearest car" and "cars within radius" questions (item targeting, mines, oil, camera
+// framing) without iterating actors or adding overlap components. The grid is refreshed once per frame after the
+// vehicles have ticked; queries made before that in a frame see last frame's positions.
+UCLASS()
+class MASHEDPOTATOES_API UMVehicleSpatialSubsystem : public UTickableWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    // USubsystem
+    virtual void Deinitialize() override;
+    // FTickableGameObject
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+
+    void RegisterVehicle(AMVehicleBase* Vehicle);
+    void UnregisterVehicle(AMVehicleBase* Vehicle);
+
+    // Brings the grid up to date with this frame's vehicle positions, does nothing if it already is.
+    // Other tickables call it before querying, since the order they tick in relative to this one is not defined.
+    void Refresh();
+
+    // --- Blueprint Queries ---
+    // Closest car within MaxRadius, ignoring Ignore. Null if there is none.
+    UFUNCTION(BlueprintCallable, Category = "Vehicle Queries")
+    AMVehicleBase* FindNearestVehicle(FVector Location, float MaxRadius, AMVehicleBase* Ignore = nullptr) const;
+    // Up to Count closest cars within MaxRadius, nearest first
+    UFUNCTION(BlueprintCallable, Category = "Vehicle Queries")
+    TArray<AMVehicleBase*> FindNearestVehicles(FVector Location, int32 Count, float MaxRadius, AMVehicleBase* Ignore = nullptr) const;
+    // Every car within Radius, in no particular order
+    UFUNCTION(BlueprintCallable, Category = "Vehicle Queries")
+    TArray<AMVehicleBase*> GetVehiclesInRadius(FVector Center, float Radius, AMVehicleBase* Ignore = nullptr) const;
+
+    // --- C++ Queries ---
+    // The grid entries carry a location and velocity per car, the entry Id is the car's index for GetVehicle
+    const FMVehicleSpatialGrid& GetGrid() const { return Grid; }
+    AMVehicleBase* GetVehicle(int32 Id) const { return Vehicles.IsValidIndex(Id) ? Vehicles[Id].Get() : nullptr; }
+    // One past the largest Id a car can have, for arrays indexed by Id
+    int32 GetMaxVehicles() const { return Vehicles.Num(); }
+
+    // Calls Visitor(AMVehicleBase*, const FMVehicleSpatialGrid::FEntry&, float DistanceSquared) for every car within Radius
+    template <typename VisitorType>
+    void ForEachVehicleInRadius(const FVector& Center, float Radius, VisitorType&& Visitor) const
+    {
+        Grid.ForEachInRadius(Center, Radius, [this, &Visitor](const FMVehicleSpatialGrid::FEntry& Entry, float DistanceSquared)
+        {
+            if (AMVehicleBase* Vehicle = Vehicles[Entry.Id].Get())
+            {
+                Visitor(Vehicle, Entry, DistanceSquared);
+            }
+        });
+    }
+
+protected:
+    virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+    FMVehicleSpatialGrid Grid;
+    // Registered cars, the index is their Id in the grid
+    TArray<TWeakObjectPtr<AMVehicleBase>> Vehicles;
+    TArray<int32> FreeIds;
+    // A car came or went since the last rebuild
+    bool bMembershipChanged = false;
+    uint64 RefreshedFrame = MAX_uint64;
+};
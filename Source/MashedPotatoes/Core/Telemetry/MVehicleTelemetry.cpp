@@ -0,0 +1,247 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MVehicleTelemetry.h"
+#include "HAL/Event.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/RunnableThread.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMPVehicleTelemetry, Log, All);
+
+static FAutoConsoleCommandWithArgs CmdVehicleTelemetryToCsv(
+    TEXT("mp.Vehicle.Telemetry.ToCsv"),
+    TEXT("Convert a vehicle telemetry file to CSV. Arguments: file path, optional output path (defaults to the same name with .csv)."),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+    {
+        if (Args.Num() > 0)
+        {
+            FMVehicleTelemetryRecorder::ConvertToCsv(Args[0], Args.Num() > 1 ? Args[1] : FPaths::ChangeExtension(Args[0], TEXT("csv")));
+        }
+    }));
+
+namespace MVehicleTelemetry
+{
+    const TCHAR* Format = TEXT("MPVehicleTelemetry");
+    // Order and types of FMVehicleTelemetrySample's members
+    const TCHAR* Fields[] = {
+        TEXT("Step:<u4"), TEXT("Vehicle:<u2"), TEXT("Wheel:u1"), TEXT("Grounded:u1"),
+        TEXT("SpringLength:<f4"), TEXT("SpringVelocity:<f4"), TEXT("LongitudinalSlip:<f4"), TEXT("LateralSlip:<f4"),
+        TEXT("LongitudinalForce:<f4"), TEXT("LateralForce:<f4"), TEXT("SuspensionForce:<f4"), TEXT("SteerAngle:<f4"),
+    };
+    // How long the writer sleeps when the buffer is not filling up fast
+    constexpr uint32 WriterWaitMs = 100;
+}
+
+TSharedPtr<FMVehicleTelemetryRecorder> FMVehicleTelemetryRecorder::Start(const FString& FilePath, const FHeader& Header, int32 BufferSamples)
+{
+    TUniquePtr<FArchive> File(IFileManager::Get().CreateFileWriter(*FilePath));
+    if (!File.IsValid())
+    {
+        UE_LOG(LogMPVehicleTelemetry, Error, TEXT("Could not create %s"), *FilePath);
+        return nullptr;
+    }
+
+    TSharedRef<FJsonObject> HeaderObject = MakeShared<FJsonObject>();
+    HeaderObject->SetStringField(TEXT("Format"), MVehicleTelemetry::Format);
+    HeaderObject->SetNumberField(TEXT("Version"), Version);
+    HeaderObject->SetNumberField(TEXT("StepSeconds"), Header.StepSeconds);
+    HeaderObject->SetStringField(TEXT("Map"), Header.MapName);
+    TArray<TSharedPtr<FJsonValue>> VehicleNames;
+    for (const FString& VehicleName : Header.VehicleNames)
+    {
+        VehicleNames.Add(MakeShared<FJsonValueString>(VehicleName));
+    }
+    HeaderObject->SetArrayField(TEXT("Vehicles"), VehicleNames);
+    TArray<TSharedPtr<FJsonValue>> Fields;
+    for (const TCHAR* Field : MVehicleTelemetry::Fields)
+    {
+        Fields.Add(MakeShared<FJsonValueString>(Field));
+    }
+    HeaderObject->SetArrayField(TEXT("Fields"), Fields);
+
+    FString HeaderLine;
+    const TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&HeaderLine);
+    FJsonSerializer::Serialize(HeaderObject, Writer);
+    HeaderLine += TEXT("\n");
+    FTCHARToUTF8 HeaderUtf8(*HeaderLine);
+    File->Serialize(const_cast<ANSICHAR*>(HeaderUtf8.Get()), HeaderUtf8.Length());
+
+    TSharedPtr<FMVehicleTelemetryRecorder> Recorder(new FMVehicleTelemetryRecorder());
+    Recorder->FilePath = FilePath;
+    Recorder->File = MoveTemp(File);
+    const uint32 Capacity = FMath::RoundUpToPowerOfTwo(static_cast<uint32>(FMath::Max(BufferSamples, 1024)));
+    Recorder->Buffer.SetNumUninitialized(Capacity);
+    Recorder->Mask = Capacity - 1;
+    Recorder->WakeEvent = FPlatformProcess::GetSynchEventFromPool();
+    Recorder->Thread = FRunnableThread::Create(Recorder.Get(), TEXT("MPVehicleTelemetry"), 0, TPri_BelowNormal);
+
+    UE_LOG(LogMPVehicleTelemetry, Display, TEXT("Recording vehicle telemetry to %s"), *FilePath);
+    return Recorder;
+}
+
+FMVehicleTelemetryRecorder::~FMVehicleTelemetryRecorder()
+{
+    Stop();
+    FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+}
+
+void FMVehicleTelemetryRecorder::Push(const FMVehicleTelemetrySample& Sample)
+{
+    const uint64 Write = WriteIndex.load(std::memory_order_relaxed);
+    const uint64 Buffered = Write - ReadIndex.load(std::memory_order_acquire);
+    if (Buffered > Mask || bStopping.load(std::memory_order_relaxed))
+    {
+        NumDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Buffer[Write & Mask] = Sample;
+    WriteIndex.store(Write + 1, std::memory_order_release);
+
+    // Wake the writer early once half the buffer is in use, otherwise it catches up on its own schedule
+    if (Buffered == (Mask + 1) / 2)
+    {
+        WakeEvent->Trigger();
+    }
+}
+
+uint32 FMVehicleTelemetryRecorder::Run()
+{
+    while (!bStopping.load(std::memory_order_acquire))
+    {
+        WakeEvent->Wait(MVehicleTelemetry::WriterWaitMs);
+        Drain();
+    }
+    Drain();
+    return 0;
+}
+
+void FMVehicleTelemetryRecorder::Drain()
+{
+    const uint64 Write = WriteIndex.load(std::memory_order_acquire);
+    uint64 Read = ReadIndex.load(std::memory_order_relaxed);
+    while (Read < Write)
+    {
+        // At most two contiguous runs, before and after the wrap
+        const uint64 Start = Read & Mask;
+        const uint64 Count = FMath::Min(Write - Read, Mask + 1 - Start);
+        File->Serialize(&Buffer[Start], Count * sizeof(FMVehicleTelemetrySample));
+        Read += Count;
+        ReadIndex.store(Read, std::memory_order_release);
+    }
+}
+
+void FMVehicleTelemetryRecorder::Stop()
+{
+    if (bStopped)
+    {
+        return;
+    }
+    bStopped = true;
+
+    bStopping.store(true, std::memory_order_release);
+    WakeEvent->Trigger();
+    if (Thread)
+    {
+        Thread->WaitForCompletion();
+        delete Thread;
+        Thread = nullptr;
+    }
+
+    const uint64 NumWritten = ReadIndex.load(std::memory_order_relaxed);
+    File->Close();
+    File.Reset();
+
+    if (GetNumDropped() > 0)
+    {
+        UE_LOG(LogMPVehicleTelemetry, Warning, TEXT("Wrote %llu samples to %s, dropped %llu the writer could not keep up with"),
+            NumWritten, *FilePath, GetNumDropped());
+    }
+    else
+    {
+        UE_LOG(LogMPVehicleTelemetry, Display, TEXT("Wrote %llu samples to %s"), NumWritten, *FilePath);
+    }
+}
+
+bool FMVehicleTelemetryRecorder::ConvertToCsv(const FString& InFilePath, const FString& OutFilePath)
+{
+    TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*InFilePath));
+    if (!Reader.IsValid())
+    {
+        UE_LOG(LogMPVehicleTelemetry, Error, TEXT("Could not open %s"), *InFilePath);
+        return false;
+    }
+
+    // --- Header line ---
+    TArray<ANSICHAR> HeaderUtf8;
+    ANSICHAR Character = 0;
+    while (!Reader->AtEnd())
+    {
+        Reader->Serialize(&Character, 1);
+        if (Character == '\n')
+        {
+            break;
+        }
+        HeaderUtf8.Add(Character);
+    }
+    HeaderUtf8.Add('\0');
+
+    TSharedPtr<FJsonObject> Header;
+    const TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(UTF8_TO_TCHAR(HeaderUtf8.GetData()));
+    if (!FJsonSerializer::Deserialize(JsonReader, Header) || !Header.IsValid() ||
+        Header->GetStringField(TEXT("Format")) != MVehicleTelemetry::Format || Header->GetIntegerField(TEXT("Version")) != Version)
+    {
+        UE_LOG(LogMPVehicleTelemetry, Error, TEXT("%s is not a vehicle telemetry file this build can read"), *InFilePath);
+        return false;
+    }
+    const double StepSeconds = Header->GetNumberField(TEXT("StepSeconds"));
+    TArray<FString> VehicleNames;
+    Header->TryGetStringArrayField(TEXT("Vehicles"), VehicleNames);
+
+    TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*OutFilePath));
+    if (!Writer.IsValid())
+    {
+        UE_LOG(LogMPVehicleTelemetry, Error, TEXT("Could not create %s"), *OutFilePath);
+        return false;
+    }
+
+    // --- Records, a block at a time so hour long files do not have to fit in memory ---
+    auto WriteText = [&Writer](const FString& Text)
+    {
+        FTCHARToUTF8 Utf8(*Text);
+        Writer->Serialize(const_cast<ANSICHAR*>(Utf8.Get()), Utf8.Length());
+    };
+    WriteText(TEXT("Time,Step,Vehicle,Wheel,Grounded,SpringLength,SpringVelocity,LongitudinalSlip,LateralSlip,LongitudinalForce,LateralForce,SuspensionForce,SteerAngle\n"));
+
+    constexpr int32 BlockSamples = 4096;
+    TArray<FMVehicleTelemetrySample> Block;
+    FString Text;
+    int64 NumSamples = 0;
+    while (Reader->TotalSize() - Reader->Tell() >= static_cast<int64>(sizeof(FMVehicleTelemetrySample)))
+    {
+        const int32 NumBlockSamples = static_cast<int32>(FMath::Min<int64>(BlockSamples, (Reader->TotalSize() - Reader->Tell()) / sizeof(FMVehicleTelemetrySample)));
+        Block.SetNumUninitialized(NumBlockSamples);
+        Reader->Serialize(Block.GetData(), NumBlockSamples * sizeof(FMVehicleTelemetrySample));
+
+        Text.Reset();
+        for (const FMVehicleTelemetrySample& Sample : Block)
+        {
+            const FString VehicleName = VehicleNames.IsValidIndex(Sample.Vehicle) ? VehicleNames[Sample.Vehicle] : FString::Printf(TEXT("Slot%d"), Sample.Vehicle);
+            Text += FString::Printf(TEXT("%.4f,%u,%s,%d,%d,%.3f,%.3f,%.3f,%.3f,%.1f,%.1f,%.1f,%.3f\n"), Sample.Step * StepSeconds, Sample.Step, *VehicleName,
+                Sample.Wheel, Sample.bGrounded, Sample.SpringLength, Sample.SpringVelocity, Sample.LongitudinalSlip, Sample.LateralSlip,
+                Sample.LongitudinalForce, Sample.LateralForce, Sample.SuspensionForce, Sample.SteerAngle);
+        }
+        WriteText(Text);
+        NumSamples += NumBlockSamples;
+    }
+
+    Writer->Close();
+    UE_LOG(LogMPVehicleTelemetry, Display, TEXT("Converted %lld samples from %s to %s"), NumSamples, *InFilePath, *OutFilePath);
+    return true;
+}
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include <atomic>
+
+class FRunnableThread;
+
+// One wheel in one physics step. Written to disk as is, see FMVehicleTelemetryRecorder for the file layout.
+struct FMVehicleTelemetrySample
+{
+    // Physics step since the recording started
+    uint32 Step = 0;
+    // Simulation slot of the vehicle, index into the header's vehicle names
+    uint16 Vehicle = 0;
+    // 0=FL, 1=FR, 2=RL, 3=RR
+    uint8 Wheel = 0;
+    uint8 bGrounded = 0;
+    float SpringLength = 0.0f;
+    // cm/s, positive while compressing
+    float SpringVelocity = 0.0f;
+    // Contact patch velocity along and across the wheel, cm/s
+    float LongitudinalSlip = 0.0f;
+    float LateralSlip = 0.0f;
+    // Tire force along and across the wheel (drive/brake plus drag, and friction), 0 while airborne
+    float LongitudinalForce = 0.0f;
+    float LateralForce = 0.0f;
+    float SuspensionForce = 0.0f;
+    // Degrees, 0 for the rear wheels
+    float SteerAngle = 0.0f;
+};
+static_assert(sizeof(FMVehicleTelemetrySample) == 40, "Telemetry files store samples as raw 40 byte records");
+
+// Streams FMVehicleTelemetrySample from the physics thread to a file without slowing the step down: samples go into a
+// preallocated single producer, single consumer ring buffer and a background thread writes them out. If the writer falls
+// a whole buffer behind, new samples are dropped and counted rather than blocking the physics step.
+//
+// File layout: one line of UTF-8 JSON (format, version, step length, map, vehicle names and the record fields with
+// numpy style types), then raw little-endian 40 byte records until the end of the file. In Python:
+//   Header = json.loads(File.readline()); Samples = numpy.fromfile(File, dtype=[tuple(F.split(':')) for F in Header['Fields']])
+// mp.Vehicle.Telemetry.ToCsv converts a file to CSV for spreadsheets.
+class MASHEDPOTATOES_API FMVehicleTelemetryRecorder : public FRunnable
+{
+public:
+    static constexpr int32 Version = 1;
+
+    struct FHeader
+    {
+        float StepSeconds = 0.0f;
+        FString MapName;
+        // By simulation slot, as the vehicles were when the recording started
+        TArray<FString> VehicleNames;
+    };
+
+    // Creates the file, writes the header and starts the writer thread. Null if the file cannot be created.
+    static TSharedPtr<FMVehicleTelemetryRecorder> Start(const FString& FilePath, const FHeader& Header, int32 BufferSamples);
+    virtual ~FMVehicleTelemetryRecorder() override;
+
+    // Physics thread. Never blocks or allocates.
+    void Push(const FMVehicleTelemetrySample& Sample);
+    // Game thread. Writes out what is still buffered and closes the file, pushes after this are ignored.
+    void Stop();
+
+    const FString& GetFilePath() const { return FilePath; }
+    uint64 GetNumDropped() const { return NumDropped.load(std::memory_order_relaxed); }
+
+    // Converts a telemetry file to CSV, one row per sample with the vehicle name and the time in seconds
+    static bool ConvertToCsv(const FString& InFilePath, const FString& OutFilePath);
+
+    // FRunnable
+    virtual uint32 Run() override;
+
+private:
+    FMVehicleTelemetryRecorder() = default;
+
+    // Writer thread: appends everything between ReadIndex and WriteIndex to the file
+    void Drain();
+
+    FString FilePath;
+    TUniquePtr<FArchive> File;
+    FRunnableThread* Thread = nullptr;
+    FEvent* WakeEvent = nullptr;
+
+    TArray<FMVehicleTelemetrySample> Buffer;
+    uint64 Mask = 0;
+    // Total samples pushed and written, the buffer index is the count masked
+    std::atomic<uint64> WriteIndex{0};
+    std::atomic<uint64> ReadIndex{0};
+    std::atomic<uint64> NumDropped{0};
+    std::atomic<bool> bStopping{false};
+    bool bStopped = false;
+};